@@ -2,7 +2,9 @@
 #include <iostream>
 #include <chrono>
 #include <thread>
+#include <algorithm>
 #include "Game.h"
+#include "Physics.h"
 
 
 std::chrono::high_resolution_clock::time_point previousTime;
@@ -48,38 +50,70 @@ void Window::init(void* pointer, World* w)
 void Window::resetUpdateTimer()
 {
     previousTime = std::chrono::high_resolution_clock::now();
+    accumulatedTime = 0.0;
 }
 
 void Window::update()
 {
     glfwPollEvents();
+    inputSampleTime = std::chrono::high_resolution_clock::now();
+    
+    if (!isFocused)
+    {
+        player->setMovementDirection(Direction::MV_NONE);
+    }
+    
+    // every frame rather than every tick, so a key press moves the player on the very next tick
+    player->movePlayerWithInput();
     
     auto currentTime = std::chrono::high_resolution_clock::now();
-    deltaTime = std::chrono::duration<double>(currentTime - previousTime).count();
     
-    double accumulatedTime = deltaTime;
+    // a long frame is not caught up on, stepping all of it would only make the next frame longer.
+    // Below the tick rate the simulation slows down instead.
+    deltaTime = std::min(std::chrono::duration<double>(currentTime - previousTime).count(), MAX_DELTA_TIME);
+    
+    accumulatedTime += deltaTime;
 
-    while (accumulatedTime > TARGET_DELTA_TIME)
+    while (accumulatedTime >= PHYSICS_DELTA_TIME)
     {
-        world->update(TARGET_DELTA_TIME);
-        accumulatedTime -= TARGET_DELTA_TIME;
+        world->update(PHYSICS_DELTA_TIME);
+        accumulatedTime -= PHYSICS_DELTA_TIME;
     }
     
     previousTime = currentTime;
+    lateSampleTime = currentTime;
 
   
 //    std::cout << 1 / deltaTime << std::endl;
+}
+
+
+// 0 right after a tick, approaching 1 as the next one comes due, as of the late input sample
+const float Window::getInterpolation() const
+{
+    double sinceUpdate = std::chrono::duration<double>(lateSampleTime - previousTime).count();
     
+    return static_cast<float>(std::min((accumulatedTime + sinceUpdate) / PHYSICS_DELTA_TIME, 1.0));
+}
+
 
+
+// Polls again right before the frame is recorded. The simulation has already run, so the late sample
+// only moves the view: the cursor delta, and the time the camera's place between ticks is taken at.
+// inputSampleTime keeps the sample the simulation ran on, which is what the frame's latency is measured from.
+void Window::sampleLateInput()
+{
+    glfwPollEvents();
+    lateSampleTime = std::chrono::high_resolution_clock::now();
+    
     if (!isFocused)
     {
         player->setMovementDirection(Direction::MV_NONE);
     }
-
+    
     updateCursorDelta();
 }
 
-
     
 void Window::destroy()
 {
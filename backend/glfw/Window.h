@@ -5,6 +5,7 @@
 #include <GLFW/glfw3.h>
 #include "Player.h"
 #include "World.h"
+#include "Physics.h"
 #include <chrono>
 
 
@@ -17,8 +18,8 @@ struct Resolution
 
 
 const int TARGET_FPS = 60;
-const double MAX_DELTA_TIME = 0.0333;
-const double TARGET_DELTA_TIME = 0.016;
+// a long frame is cut to this many physics ticks, so a hitch never leaves a backlog to catch up
+const double MAX_DELTA_TIME = PHYSICS_DELTA_TIME * 4;
 const std::chrono::duration<double> FRAME_DURATION(1.0 / TARGET_FPS);
 extern std::chrono::high_resolution_clock::time_point previousTime;
 
@@ -26,6 +27,7 @@ extern std::chrono::high_resolution_clock::time_point previousTime;
 class Window {
 private:
     float deltaTime;
+    double accumulatedTime = 0.0;     // simulation time not yet stepped, carried between frames
     
     double deltaX = 0.0, deltaY = 0.0;
     double prevX = 0.0, prevY = 0.0;
@@ -47,6 +49,9 @@ public:
     bool isFullscreen = false;
     Resolution desiredResolution;
     
+    std::chrono::high_resolution_clock::time_point inputSampleTime;
+    std::chrono::high_resolution_clock::time_point lateSampleTime;     // the poll right before recording
+    
 public:
     Window();
     
@@ -55,6 +60,9 @@ public:
     void destroy();
     
     void resetUpdateTimer();
+    void sampleLateInput();
+    
+    const float getInterpolation() const;
     
     std::vector<Resolution> queryResolutions();
     
@@ -0,0 +1,735 @@
+#include "MeshCooker.h"
+#include "MeshSimplifier.h"
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <cfloat>
+#include <numeric>
+
+
+// Returns false if there is no cached mesh or the source changed since it was cooked
+bool MeshCooker::load(const std::string& source, CookedMesh& mesh)
+{
+    std::string path = cachePath(source);
+    std::error_code error;
+
+    if (!std::filesystem::exists(path, error) ||
+        std::filesystem::last_write_time(path, error) < std::filesystem::last_write_time(source, error))
+    {
+        return false;
+    }
+
+    std::ifstream file(path, std::ios::binary);
+
+    if (!file.is_open())
+        return false;
+
+    uint32_t header[9];
+    file.read(reinterpret_cast<char*>(header), sizeof(header));
+
+    // the layout is the in-memory Vertex, so a struct change must bump the version
+    if (!file || header[0] != COOKED_MESH_MAGIC || header[1] != COOKED_MESH_VERSION)
+        return false;
+
+    mesh.vertices.resize(header[2]);
+    mesh.indices.resize(header[3]);
+    mesh.lodIndices.resize(header[4]);
+    mesh.lods.resize(header[5]);
+    mesh.meshlets.resize(header[6]);
+    mesh.bvhNodes.resize(header[7]);
+    mesh.bvhTriangles.resize(header[8]);
+
+    file.read(reinterpret_cast<char*>(mesh.vertices.data()), sizeof(Vertex) * mesh.vertices.size());
+    file.read(reinterpret_cast<char*>(mesh.indices.data()), sizeof(uint32_t) * mesh.indices.size());
+    file.read(reinterpret_cast<char*>(mesh.lodIndices.data()), sizeof(uint32_t) * mesh.lodIndices.size());
+    file.read(reinterpret_cast<char*>(mesh.lods.data()), sizeof(MeshLod) * mesh.lods.size());
+    file.read(reinterpret_cast<char*>(mesh.meshlets.data()), sizeof(Meshlet) * mesh.meshlets.size());
+    file.read(reinterpret_cast<char*>(mesh.bvhNodes.data()), sizeof(BvhNode) * mesh.bvhNodes.size());
+    file.read(reinterpret_cast<char*>(mesh.bvhTriangles.data()), sizeof(uint32_t) * mesh.bvhTriangles.size());
+
+    return static_cast<bool>(file);
+}
+
+
+void MeshCooker::save(const std::string& path, const CookedMesh& mesh)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+
+    if (!file.is_open())
+    {
+        throw std::runtime_error("failed to open " + path + " to write the cooked mesh!");
+    }
+
+    uint32_t header[9] = {
+        COOKED_MESH_MAGIC,
+        COOKED_MESH_VERSION,
+        static_cast<uint32_t>(mesh.vertices.size()),
+        static_cast<uint32_t>(mesh.indices.size()),
+        static_cast<uint32_t>(mesh.lodIndices.size()),
+        static_cast<uint32_t>(mesh.lods.size()),
+        static_cast<uint32_t>(mesh.meshlets.size()),
+        static_cast<uint32_t>(mesh.bvhNodes.size()),
+        static_cast<uint32_t>(mesh.bvhTriangles.size())
+    };
+
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(mesh.vertices.data()), sizeof(Vertex) * mesh.vertices.size());
+    file.write(reinterpret_cast<const char*>(mesh.indices.data()), sizeof(uint32_t) * mesh.indices.size());
+    file.write(reinterpret_cast<const char*>(mesh.lodIndices.data()), sizeof(uint32_t) * mesh.lodIndices.size());
+    file.write(reinterpret_cast<const char*>(mesh.lods.data()), sizeof(MeshLod) * mesh.lods.size());
+    file.write(reinterpret_cast<const char*>(mesh.meshlets.data()), sizeof(Meshlet) * mesh.meshlets.size());
+    file.write(reinterpret_cast<const char*>(mesh.bvhNodes.data()), sizeof(BvhNode) * mesh.bvhNodes.size());
+    file.write(reinterpret_cast<const char*>(mesh.bvhTriangles.data()), sizeof(uint32_t) * mesh.bvhTriangles.size());
+}
+
+
+void MeshCooker::cook(CookedMesh& mesh)
+{
+    std::vector<uint32_t> clusters = optimizeVertexCache(mesh.indices, mesh.vertices.size());
+    optimizeOverdraw(mesh.vertices, mesh.indices, clusters);
+
+    generateLods(mesh);
+
+    // renumber over every level at once, the base mesh comes first so its order wins
+    size_t baseCount = mesh.indices.size();
+    mesh.indices.insert(mesh.indices.end(), mesh.lodIndices.begin(), mesh.lodIndices.end());
+    optimizeVertexFetch(mesh.vertices, mesh.indices);
+
+    mesh.lodIndices.assign(mesh.indices.begin() + baseCount, mesh.indices.end());
+    mesh.indices.resize(baseCount);
+
+    mesh.meshlets = buildMeshlets(mesh.vertices, mesh.indices);
+    buildBvh(mesh.vertices, mesh.indices, mesh.bvhNodes, mesh.bvhTriangles);
+}
+
+
+void MeshCooker::cookFile(const std::string& source)
+{
+    CookedMesh mesh;
+    parseObject(source.c_str(), mesh.vertices, mesh.indices);
+
+    VertexCacheStats before = measure(mesh.indices, mesh.vertices.size());
+    cook(mesh);
+    VertexCacheStats after = measure(mesh.indices, mesh.vertices.size());
+
+    std::cout << "cooked " << source << ": " << mesh.indices.size() / 3 << " triangles, "
+              << "ACMR " << before.acmr << " -> " << after.acmr << ", "
+              << "ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+
+    for (size_t l = 1; l < mesh.lods.size(); l++)
+    {
+        std::cout << "    lod " << l << ": " << mesh.lods[l].indexCount / 3 << " triangles, error " << mesh.lods[l].error << std::endl;
+    }
+
+    std::cout << "    " << mesh.meshlets.size() << " meshlets, " << mesh.bvhNodes.size() << " bvh nodes" << std::endl;
+
+    save(cachePath(source), mesh);
+}
+
+
+// Simulates a FIFO post-transform cache of the given size
+VertexCacheStats MeshCooker::measure(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize)
+{
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<bool> referenced(vertexCount, false);
+
+    uint32_t time = cacheSize + 1;
+    uint32_t misses = 0;
+    uint32_t unique = 0;
+
+    for (uint32_t index : indices)
+    {
+        if (time - cacheTime[index] > cacheSize)
+        {
+            cacheTime[index] = time++;
+            misses++;
+        }
+
+        if (!referenced[index])
+        {
+            referenced[index] = true;
+            unique++;
+        }
+    }
+
+    VertexCacheStats stats{};
+    stats.acmr = indices.empty() ? 0.f : static_cast<float>(misses) / (indices.size() / 3);
+    stats.atvr = unique == 0 ? 0.f : static_cast<float>(misses) / unique;
+
+    return stats;
+}
+
+
+// Tipsify (Sander et al. 2007). Fans around a vertex at a time, choosing the next one still likely
+// to be in the cache. Returns the first triangle of every cluster, a cluster ends where the walk
+// had to jump to a dead-end vertex, which is where the cache effectively starts cold.
+std::vector<uint32_t> MeshCooker::optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize)
+{
+    size_t triangleCount = indices.size() / 3;
+    std::vector<uint32_t> clusters;
+
+    if (triangleCount == 0)
+        return clusters;
+
+    // vertex to triangle adjacency
+    std::vector<uint32_t> liveTriangles(vertexCount, 0);
+
+    for (uint32_t index : indices)
+    {
+        liveTriangles[index]++;
+    }
+
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+    }
+
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> deadEnds;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+
+    uint32_t time = cacheSize + 1;
+    size_t cursor = 0;
+    int64_t fanning = indices[0];
+
+    clusters.push_back(0);
+
+    while (fanning >= 0)
+    {
+        candidates.clear();
+
+        for (uint32_t a = adjacencyOffsets[fanning]; a < adjacencyOffsets[fanning + 1]; a++)
+        {
+            uint32_t t = adjacency[a];
+
+            if (emitted[t])
+                continue;
+
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                uint32_t v = indices[t * 3 + k];
+
+                output.push_back(v);
+                deadEnds.push_back(v);
+                candidates.push_back(v);
+                liveTriangles[v]--;
+
+                if (time - cacheTime[v] > cacheSize)
+                {
+                    cacheTime[v] = time++;
+                }
+            }
+
+            emitted[t] = true;
+        }
+
+        // prefer the candidate that has been in the cache longest and will still be there after its fan
+        int64_t next = -1;
+        uint32_t bestPriority = 0;
+
+        for (uint32_t v : candidates)
+        {
+            if (liveTriangles[v] == 0)
+                continue;
+
+            uint32_t priority = 0;
+
+            if (time - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize)
+                priority = time - cacheTime[v];
+
+            if (next < 0 || priority > bestPriority)
+            {
+                bestPriority = priority;
+                next = v;
+            }
+        }
+
+        if (next < 0)
+        {
+            // dead end: pop recently used vertices first, then fall back to a linear scan
+            while (!deadEnds.empty() && next < 0)
+            {
+                uint32_t v = deadEnds.back();
+                deadEnds.pop_back();
+
+                if (liveTriangles[v] > 0)
+                    next = v;
+            }
+
+            while (next < 0 && cursor < vertexCount)
+            {
+                if (liveTriangles[cursor] > 0)
+                    next = static_cast<int64_t>(cursor);
+
+                cursor++;
+            }
+
+            if (next >= 0 && output.size() / 3 > clusters.back())
+            {
+                clusters.push_back(static_cast<uint32_t>(output.size() / 3));
+            }
+        }
+
+        fanning = next;
+    }
+
+    indices = std::move(output);
+    return clusters;
+}
+
+
+// Splits the Tipsify clusters further where that costs almost no cache efficiency, then sorts them
+// so clusters facing away from the mesh centre draw first (Sander et al. 2007). Those tend to
+// occlude the rest of the mesh, so later fragments fail the depth test instead of being shaded.
+void MeshCooker::optimizeOverdraw(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, const std::vector<uint32_t>& hardClusters, uint32_t cacheSize)
+{
+    size_t triangleCount = indices.size() / 3;
+
+    if (triangleCount == 0 || hardClusters.empty())
+        return;
+
+    float meshAcmr = measure(indices, vertices.size(), cacheSize).acmr;
+
+    std::vector<uint32_t> clusters;
+    std::vector<uint32_t> cacheTime(vertices.size(), 0);
+    uint32_t time = cacheSize + 1;
+
+    for (size_t c = 0; c < hardClusters.size(); c++)
+    {
+        uint32_t first = hardClusters[c];
+        uint32_t last = (c + 1 < hardClusters.size()) ? hardClusters[c + 1] : static_cast<uint32_t>(triangleCount);
+
+        uint32_t clusterStart = first;
+        uint32_t misses = 0;
+
+        // a fresh cluster starts with a cold cache
+        time += cacheSize + 1;
+        clusters.push_back(first);
+
+        for (uint32_t t = first; t < last; t++)
+        {
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                uint32_t v = indices[t * 3 + k];
+
+                if (time - cacheTime[v] > cacheSize)
+                {
+                    cacheTime[v] = time++;
+                    misses++;
+                }
+            }
+
+            uint32_t triangles = t + 1 - clusterStart;
+
+            if (t + 1 < last && static_cast<float>(misses) / triangles <= meshAcmr * OVERDRAW_THRESHOLD)
+            {
+                clusterStart = t + 1;
+                misses = 0;
+                time += cacheSize + 1;
+                clusters.push_back(clusterStart);
+            }
+        }
+    }
+
+    // area weighted centroid of the whole mesh and of every cluster
+    glm::vec3 meshCentroid(0.f);
+    float meshArea = 0.f;
+
+    std::vector<glm::vec3> clusterCentroids(clusters.size(), glm::vec3(0.f));
+    std::vector<glm::vec3> clusterNormals(clusters.size(), glm::vec3(0.f));
+    std::vector<float> clusterAreas(clusters.size(), 0.f);
+
+    for (size_t c = 0; c < clusters.size(); c++)
+    {
+        uint32_t last = (c + 1 < clusters.size()) ? clusters[c + 1] : static_cast<uint32_t>(triangleCount);
+
+        for (uint32_t t = clusters[c]; t < last; t++)
+        {
+            const glm::vec3& p0 = vertices[indices[t * 3 + 0]].pos;
+            const glm::vec3& p1 = vertices[indices[t * 3 + 1]].pos;
+            const glm::vec3& p2 = vertices[indices[t * 3 + 2]].pos;
+
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            float area = glm::length(normal);
+            glm::vec3 centroid = (p0 + p1 + p2) / 3.f;
+
+            clusterCentroids[c] += centroid * area;
+            clusterNormals[c] += normal;
+            clusterAreas[c] += area;
+
+            meshCentroid += centroid * area;
+            meshArea += area;
+        }
+    }
+
+    if (meshArea > 0.f)
+        meshCentroid /= meshArea;
+
+    std::vector<float> sortKeys(clusters.size());
+
+    for (size_t c = 0; c < clusters.size(); c++)
+    {
+        glm::vec3 centroid = clusterAreas[c] > 0.f ? clusterCentroids[c] / clusterAreas[c] : meshCentroid;
+        sortKeys[c] = glm::dot(centroid - meshCentroid, clusterNormals[c]);
+    }
+
+    std::vector<uint32_t> order(clusters.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&sortKeys](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+    std::vector<uint32_t> sorted;
+    sorted.reserve(indices.size());
+
+    for (uint32_t c : order)
+    {
+        uint32_t last = (c + 1 < clusters.size()) ? clusters[c + 1] : static_cast<uint32_t>(triangleCount);
+        sorted.insert(sorted.end(), indices.begin() + clusters[c] * 3, indices.begin() + last * 3);
+    }
+
+    indices = std::move(sorted);
+}
+
+
+// Simplifies level after level from the one before it. Each level is cache optimized on its own,
+// and the chain stops once simplification stalls against locked seams and borders.
+void MeshCooker::generateLods(CookedMesh& mesh)
+{
+    mesh.lods.clear();
+    mesh.lodIndices.clear();
+
+    mesh.lods.push_back({0, static_cast<uint32_t>(mesh.indices.size()), 0.f});
+
+    std::vector<uint32_t> previous = mesh.indices;
+    float error = 0.f;
+
+    while (mesh.lods.size() < MAX_MESH_LODS && previous.size() / 3 >= 2 * LOD_MIN_TRIANGLES)
+    {
+        size_t target = static_cast<size_t>(previous.size() / 3 * LOD_REDUCTION) * 3;
+
+        float levelError = 0.f;
+        std::vector<uint32_t> simplified = MeshSimplifier::simplify(mesh.vertices, previous, target, levelError);
+
+        // not worth a level of its own
+        if (simplified.empty() || simplified.size() > previous.size() * 0.8f)
+            break;
+
+        optimizeVertexCache(simplified, mesh.vertices.size());
+
+        // errors accumulate along the chain since each level starts from the last
+        error += levelError;
+
+        MeshLod lod{};
+        lod.indexOffset = static_cast<uint32_t>(mesh.indices.size() + mesh.lodIndices.size());
+        lod.indexCount = static_cast<uint32_t>(simplified.size());
+        lod.error = error;
+
+        mesh.lodIndices.insert(mesh.lodIndices.end(), simplified.begin(), simplified.end());
+        mesh.lods.push_back(lod);
+
+        previous = std::move(simplified);
+    }
+}
+
+
+// Renumbers vertices in first-use order so the fetch walks the buffer mostly linearly.
+// Vertices no triangle references are dropped.
+void MeshCooker::optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+    std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+    std::vector<Vertex> reordered;
+    reordered.reserve(vertices.size());
+
+    for (uint32_t& index : indices)
+    {
+        if (remap[index] == UINT32_MAX)
+        {
+            remap[index] = static_cast<uint32_t>(reordered.size());
+            reordered.push_back(vertices[index]);
+        }
+
+        index = remap[index];
+    }
+
+    vertices = std::move(reordered);
+}
+
+
+// Cuts the index list into consecutive meshlets, so each one is a plain index range any vertex
+// pipeline can draw. The cache-optimized order keeps consecutive triangles close together.
+std::vector<Meshlet> MeshCooker::buildMeshlets(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+{
+    std::vector<Meshlet> meshlets;
+    std::vector<uint32_t> stamps(vertices.size(), UINT32_MAX);
+
+    size_t first = 0;
+
+    while (first < indices.size())
+    {
+        uint32_t stamp = static_cast<uint32_t>(meshlets.size());
+        uint32_t vertexCount = 0;
+        size_t last = first;
+
+        while (last < indices.size() && (last - first) / 3 < MESHLET_MAX_TRIANGLES)
+        {
+            uint32_t added = 0;
+
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                if (stamps[indices[last + k]] != stamp)
+                    added++;
+            }
+
+            if (vertexCount + added > MESHLET_MAX_VERTICES)
+                break;
+
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                stamps[indices[last + k]] = stamp;
+            }
+
+            vertexCount += added;
+            last += 3;
+        }
+
+        Meshlet meshlet{};
+        meshlet.indexOffset = static_cast<uint32_t>(first);
+        meshlet.indexCount = static_cast<uint32_t>(last - first);
+
+        glm::vec3 min(FLT_MAX);
+        glm::vec3 max(-FLT_MAX);
+        glm::vec3 normalSum(0.f);
+
+        for (size_t i = first; i < last; i++)
+        {
+            min = glm::min(min, vertices[indices[i]].pos);
+            max = glm::max(max, vertices[indices[i]].pos);
+        }
+
+        meshlet.center = (min + max) * 0.5f;
+
+        for (size_t i = first; i < last; i++)
+        {
+            meshlet.radius = std::max(meshlet.radius, glm::length(vertices[indices[i]].pos - meshlet.center));
+        }
+
+        std::vector<glm::vec3> normals;
+
+        for (size_t t = first; t < last; t += 3)
+        {
+            const glm::vec3& p0 = vertices[indices[t + 0]].pos;
+            const glm::vec3& p1 = vertices[indices[t + 1]].pos;
+            const glm::vec3& p2 = vertices[indices[t + 2]].pos;
+
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            float length = glm::length(normal);
+
+            if (length > 0.f)
+            {
+                normals.push_back(normal / length);
+                normalSum += normal / length;
+            }
+        }
+
+        meshlet.coneAxis = glm::vec3(0.f, 1.f, 0.f);
+        meshlet.coneCutoff = 1.f;
+
+        if (glm::length(normalSum) > 0.f)
+        {
+            meshlet.coneAxis = glm::normalize(normalSum);
+
+            float minDot = 1.f;
+
+            for (const glm::vec3& normal : normals)
+            {
+                minDot = std::min(minDot, glm::dot(normal, meshlet.coneAxis));
+            }
+
+            // a cone wider than a hemisphere always has a front facing triangle
+            if (minDot > 0.f)
+                meshlet.coneCutoff = std::sqrt(1.f - minDot * minDot);
+        }
+
+        meshlets.push_back(meshlet);
+        first = last;
+    }
+
+    return meshlets;
+}
+
+
+// Binned SAH over the triangle centroids, top down with an explicit stack. A node is split along
+// whichever axis and bin boundary gives the least surface area weighted triangle count, and kept
+// as a leaf when no split beats testing its triangles directly.
+void MeshCooker::buildBvh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+                          std::vector<BvhNode>& nodes, std::vector<uint32_t>& triangles)
+{
+    nodes.clear();
+    triangles.clear();
+
+    uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+
+    if (triangleCount == 0)
+        return;
+
+    std::vector<glm::vec3> triangleMin(triangleCount);
+    std::vector<glm::vec3> triangleMax(triangleCount);
+    std::vector<glm::vec3> centroids(triangleCount);
+
+    for (uint32_t t = 0; t < triangleCount; t++)
+    {
+        const glm::vec3& p0 = vertices[indices[t * 3 + 0]].pos;
+        const glm::vec3& p1 = vertices[indices[t * 3 + 1]].pos;
+        const glm::vec3& p2 = vertices[indices[t * 3 + 2]].pos;
+
+        triangleMin[t] = glm::min(p0, glm::min(p1, p2));
+        triangleMax[t] = glm::max(p0, glm::max(p1, p2));
+        centroids[t] = (triangleMin[t] + triangleMax[t]) * 0.5f;
+    }
+
+    triangles.resize(triangleCount);
+    std::iota(triangles.begin(), triangles.end(), 0);
+
+    auto area = [](const glm::vec3& min, const glm::vec3& max) {
+        glm::vec3 size = glm::max(max - min, glm::vec3(0.f));
+        return size.x * size.y + size.y * size.z + size.z * size.x;
+    };
+
+    struct Bin
+    {
+        glm::vec3 min = glm::vec3(FLT_MAX);
+        glm::vec3 max = glm::vec3(-FLT_MAX);
+        uint32_t count = 0;
+    };
+
+    nodes.reserve(triangleCount * 2);
+    nodes.push_back({ glm::vec3(0), 0, glm::vec3(0), triangleCount });
+
+    std::vector<std::pair<uint32_t, uint32_t>> stack = { { 0, 0 } };
+
+    while (!stack.empty())
+    {
+        uint32_t n = stack.back().first;
+        uint32_t depth = stack.back().second;
+        stack.pop_back();
+
+        uint32_t first = nodes[n].leftOrFirst;
+        uint32_t count = nodes[n].count;
+
+        glm::vec3 min(FLT_MAX);
+        glm::vec3 max(-FLT_MAX);
+        glm::vec3 centroidMin(FLT_MAX);
+        glm::vec3 centroidMax(-FLT_MAX);
+
+        for (uint32_t i = first; i < first + count; i++)
+        {
+            uint32_t t = triangles[i];
+
+            min = glm::min(min, triangleMin[t]);
+            max = glm::max(max, triangleMax[t]);
+            centroidMin = glm::min(centroidMin, centroids[t]);
+            centroidMax = glm::max(centroidMax, centroids[t]);
+        }
+
+        nodes[n].min = min;
+        nodes[n].max = max;
+
+        if (count <= BVH_LEAF_TRIANGLES || depth + 1 >= BVH_MAX_DEPTH)
+            continue;
+
+        float bestCost = count * area(min, max);
+        int bestAxis = -1;
+        uint32_t bestSplit = 0;
+
+        for (int axis = 0; axis < 3; axis++)
+        {
+            float extent = centroidMax[axis] - centroidMin[axis];
+
+            if (extent <= 0.f)
+                continue;
+
+            Bin bins[BVH_SAH_BINS];
+            float scale = BVH_SAH_BINS / extent;
+
+            for (uint32_t i = first; i < first + count; i++)
+            {
+                uint32_t t = triangles[i];
+                uint32_t b = std::min(static_cast<uint32_t>((centroids[t][axis] - centroidMin[axis]) * scale), BVH_SAH_BINS - 1u);
+
+                bins[b].min = glm::min(bins[b].min, triangleMin[t]);
+                bins[b].max = glm::max(bins[b].max, triangleMax[t]);
+                bins[b].count++;
+            }
+
+            // areas and counts left of every boundary, then one sweep back from the right
+            float leftArea[BVH_SAH_BINS - 1];
+            uint32_t leftCount[BVH_SAH_BINS - 1];
+            Bin left;
+
+            for (uint32_t b = 0; b < BVH_SAH_BINS - 1; b++)
+            {
+                left.min = glm::min(left.min, bins[b].min);
+                left.max = glm::max(left.max, bins[b].max);
+                left.count += bins[b].count;
+
+                leftArea[b] = area(left.min, left.max);
+                leftCount[b] = left.count;
+            }
+
+            Bin right;
+
+            for (uint32_t b = BVH_SAH_BINS - 1; b > 0; b--)
+            {
+                right.min = glm::min(right.min, bins[b].min);
+                right.max = glm::max(right.max, bins[b].max);
+                right.count += bins[b].count;
+
+                if (leftCount[b - 1] == 0 || right.count == 0)
+                    continue;
+
+                float cost = leftCount[b - 1] * leftArea[b - 1] + right.count * area(right.min, right.max);
+
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = b;
+                }
+            }
+        }
+
+        if (bestAxis < 0)
+            continue;
+
+        float scale = BVH_SAH_BINS / (centroidMax[bestAxis] - centroidMin[bestAxis]);
+
+        auto middle = std::partition(triangles.begin() + first, triangles.begin() + first + count, [&](uint32_t t) {
+            uint32_t b = std::min(static_cast<uint32_t>((centroids[t][bestAxis] - centroidMin[bestAxis]) * scale), BVH_SAH_BINS - 1u);
+            return b < bestSplit;
+        });
+
+        uint32_t leftCountSplit = static_cast<uint32_t>(middle - (triangles.begin() + first));
+        uint32_t child = static_cast<uint32_t>(nodes.size());
+
+        nodes.push_back({ glm::vec3(0), first, glm::vec3(0), leftCountSplit });
+        nodes.push_back({ glm::vec3(0), first + leftCountSplit, glm::vec3(0), count - leftCountSplit });
+
+        nodes[n].leftOrFirst = child;
+        nodes[n].count = 0;
+
+        stack.push_back({ child, depth + 1 });
+        stack.push_back({ child + 1, depth + 1 });
+    }
+}
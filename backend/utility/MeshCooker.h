@@ -0,0 +1,86 @@
+#ifndef MESHCOOKER_H
+#define MESHCOOKER_H
+
+#include "VulkanUtils.h"
+#include <string>
+
+
+#define COOKED_MESH_MAGIC 0x48534D43    // "CMSH"
+#define COOKED_MESH_VERSION 4
+#define COOKED_MESH_EXTENSION ".mesh"
+
+// post-transform cache size assumed by the optimizer and the reported stats
+#define VERTEX_CACHE_SIZE 16
+
+// a cluster may be split for overdraw ordering while its cold-cache ACMR stays within this factor of the mesh's
+#define OVERDRAW_THRESHOLD 1.05f
+
+// each level keeps about half the triangles of the one before
+#define MAX_MESH_LODS 4
+#define LOD_REDUCTION 0.5f
+#define LOD_MIN_TRIANGLES 32
+
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+
+// a node with this few triangles is never split, nor is one this deep, which bounds a traversal's stack
+#define BVH_LEAF_TRIANGLES 4
+#define BVH_MAX_DEPTH 48
+#define BVH_SAH_BINS 12
+
+
+struct VertexCacheStats
+{
+    float acmr;     // transformed vertices per triangle
+    float atvr;     // transformed vertices per referenced vertex, 1.0 is ideal
+};
+
+
+struct CookedMesh
+{
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<uint32_t> lodIndices;
+    std::vector<MeshLod> lods;
+    std::vector<Meshlet> meshlets;
+    std::vector<BvhNode> bvhNodes;
+    std::vector<uint32_t> bvhTriangles;
+};
+
+
+/**
+ * @class MeshCooker
+ * @brief Offline optimization of loaded meshes, cached as a binary file next to the source model.
+ *
+ * Cooking reorders triangles for the post-transform cache (Tipsify), reorders the resulting
+ * clusters so outward-facing ones draw first to cut overdraw, and finally renumbers vertices
+ * in first-use order for fetch locality. A chain of simplified levels of detail is generated
+ * over the same vertices and stored alongside, as are the base level's meshlets and a BVH over
+ * its triangles for mesh colliders. Cache files are only written by the cook step, a build with
+ * -DCOOK_MESHES, which also reports what cooking gained. The game loads them and cooks a missing
+ * or stale mesh in memory, without writing anything next to its assets.
+ */
+class MeshCooker {
+public:
+    static bool load(const std::string& source, CookedMesh& mesh);
+    static void cook(CookedMesh& mesh);
+
+    // the cook step for one model, parses, cooks, reports and writes its cache
+    static void cookFile(const std::string& source);
+
+    static VertexCacheStats measure(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize = VERTEX_CACHE_SIZE);
+
+    static std::vector<uint32_t> optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize = VERTEX_CACHE_SIZE);
+    static void optimizeOverdraw(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, const std::vector<uint32_t>& clusters, uint32_t cacheSize = VERTEX_CACHE_SIZE);
+    static void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+    static void generateLods(CookedMesh& mesh);
+    static std::vector<Meshlet> buildMeshlets(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+    static void buildBvh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+                         std::vector<BvhNode>& nodes, std::vector<uint32_t>& triangles);
+
+private:
+    static void save(const std::string& path, const CookedMesh& mesh);
+    static std::string cachePath(const std::string& source) { return source + COOKED_MESH_EXTENSION; }
+};
+
+#endif
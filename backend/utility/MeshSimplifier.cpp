@@ -0,0 +1,290 @@
+#include "MeshSimplifier.h"
+#include <unordered_map>
+#include <algorithm>
+
+
+// symmetric 4x4 plane quadric, upper triangle only
+struct Quadric
+{
+    double a2, ab, ac, ad;
+    double b2, bc, bd;
+    double c2, cd;
+    double d2;
+    double weight;      // planes accumulated, so the error can be reported as a mean distance
+
+    static Quadric fromPlane(const glm::vec3& normal, double d)
+    {
+        double a = normal.x, b = normal.y, c = normal.z;
+        
+        return { a * a, a * b, a * c, a * d,
+                 b * b, b * c, b * d,
+                 c * c, c * d,
+                 d * d,
+                 1.0 };
+    }
+
+    Quadric& operator+=(const Quadric& q)
+    {
+        a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+        b2 += q.b2; bc += q.bc; bd += q.bd;
+        c2 += q.c2; cd += q.cd;
+        d2 += q.d2;
+        weight += q.weight;
+        return *this;
+    }
+
+    // mean squared distance from p to the accumulated planes
+    double evaluate(const glm::vec3& p) const
+    {
+        double x = p.x, y = p.y, z = p.z;
+        
+        double result = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+                      + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+                      + c2 * z * z + 2 * cd * z
+                      + d2;
+
+        return weight > 0.0 ? std::max(result, 0.0) / weight : 0.0;
+    }
+};
+
+
+struct Collapse
+{
+    uint32_t from;
+    uint32_t to;
+    double cost;
+};
+
+
+std::vector<uint32_t> MeshSimplifier::simplify(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, size_t targetIndexCount, float& error)
+{
+    std::vector<uint32_t> result = indices;
+    double maxCost = 0.0;
+
+    // vertices sharing a position but not attributes sit on a UV seam
+    std::unordered_map<glm::vec3, uint32_t> positions;
+    std::vector<uint32_t> positionIds(vertices.size());
+    std::vector<uint32_t> positionUses;
+
+    for (size_t v = 0; v < vertices.size(); v++)
+    {
+        auto [it, inserted] = positions.try_emplace(vertices[v].pos, static_cast<uint32_t>(positionUses.size()));
+
+        if (inserted)
+            positionUses.push_back(0);
+
+        positionIds[v] = it->second;
+        positionUses[it->second]++;
+    }
+
+    std::vector<bool> locked(vertices.size(), false);
+
+    for (size_t v = 0; v < vertices.size(); v++)
+    {
+        locked[v] = positionUses[positionIds[v]] > 1;
+    }
+
+    // edges used by a single triangle lie on an open border
+    std::unordered_map<uint64_t, uint32_t> edgeUses;
+
+    for (size_t t = 0; t < result.size(); t += 3)
+    {
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            uint64_t a = positionIds[result[t + k]];
+            uint64_t b = positionIds[result[t + (k + 1) % 3]];
+            edgeUses[(std::min(a, b) << 32) | std::max(a, b)]++;
+        }
+    }
+
+    std::vector<bool> borderPositions(positionUses.size(), false);
+
+    for (const auto& [edge, uses] : edgeUses)
+    {
+        if (uses == 1)
+        {
+            borderPositions[edge >> 32] = true;
+            borderPositions[edge & 0xFFFFFFFF] = true;
+        }
+    }
+
+    for (size_t v = 0; v < vertices.size(); v++)
+    {
+        if (borderPositions[positionIds[v]])
+            locked[v] = true;
+    }
+
+    std::vector<Quadric> quadrics(vertices.size(), Quadric{});
+
+    for (size_t t = 0; t < result.size(); t += 3)
+    {
+        const glm::vec3& p0 = vertices[result[t + 0]].pos;
+        const glm::vec3& p1 = vertices[result[t + 1]].pos;
+        const glm::vec3& p2 = vertices[result[t + 2]].pos;
+
+        glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        float length = glm::length(normal);
+
+        if (length == 0.f)
+            continue;
+
+        normal /= length;
+        Quadric q = Quadric::fromPlane(normal, -glm::dot(normal, p0));
+
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            quadrics[result[t + k]] += q;
+        }
+    }
+
+    std::vector<uint32_t> remap(vertices.size());
+    std::vector<bool> touched(vertices.size());
+    std::vector<uint32_t> adjacencyOffsets(vertices.size() + 1);
+    std::vector<uint32_t> adjacency;
+    std::vector<Collapse> collapses;
+
+    while (result.size() > targetIndexCount)
+    {
+        // vertex to triangle adjacency for this pass
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+
+        for (uint32_t index : result)
+        {
+            adjacencyOffsets[index + 1]++;
+        }
+
+        for (size_t v = 0; v < vertices.size(); v++)
+        {
+            adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+        }
+
+        adjacency.resize(result.size());
+        std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+
+        for (size_t i = 0; i < result.size(); i++)
+        {
+            adjacency[fill[result[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        collapses.clear();
+
+        for (size_t t = 0; t < result.size(); t += 3)
+        {
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                uint32_t a = result[t + k];
+                uint32_t b = result[t + (k + 1) % 3];
+
+                // both directions, each is only legal if the moving vertex is free
+                if (!locked[a])
+                    collapses.push_back({a, b, 0.0});
+
+                if (!locked[b])
+                    collapses.push_back({b, a, 0.0});
+            }
+        }
+
+        for (Collapse& c : collapses)
+        {
+            Quadric q = quadrics[c.from];
+            q += quadrics[c.to];
+            c.cost = q.evaluate(vertices[c.to].pos);
+        }
+
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+        for (size_t v = 0; v < vertices.size(); v++)
+        {
+            remap[v] = static_cast<uint32_t>(v);
+        }
+
+        std::fill(touched.begin(), touched.end(), false);
+
+        // every collapse removes about two triangles
+        size_t wanted = (result.size() - targetIndexCount) / 6 + 1;
+        size_t performed = 0;
+
+        for (const Collapse& c : collapses)
+        {
+            if (performed >= wanted)
+                break;
+
+            if (touched[c.from] || touched[c.to])
+                continue;
+
+            // reject collapses that would fold a surviving triangle over
+            bool flips = false;
+
+            for (uint32_t a = adjacencyOffsets[c.from]; a < adjacencyOffsets[c.from + 1] && !flips; a++)
+            {
+                size_t t = adjacency[a] * 3;
+
+                uint32_t i0 = result[t + 0];
+                uint32_t i1 = result[t + 1];
+                uint32_t i2 = result[t + 2];
+
+                if (i0 == c.to || i1 == c.to || i2 == c.to)
+                    continue;
+
+                glm::vec3 p0 = vertices[i0].pos;
+                glm::vec3 p1 = vertices[i1].pos;
+                glm::vec3 p2 = vertices[i2].pos;
+
+                glm::vec3 before = glm::cross(p1 - p0, p2 - p0);
+
+                if (i0 == c.from) p0 = vertices[c.to].pos;
+                if (i1 == c.from) p1 = vertices[c.to].pos;
+                if (i2 == c.from) p2 = vertices[c.to].pos;
+
+                glm::vec3 after = glm::cross(p1 - p0, p2 - p0);
+
+                flips = glm::dot(before, after) <= 0.f;
+            }
+
+            if (flips)
+                continue;
+
+            remap[c.from] = c.to;
+            quadrics[c.to] += quadrics[c.from];
+            maxCost = std::max(maxCost, c.cost);
+
+            // neighbours of both ends keep their adjacency valid for the rest of the pass
+            for (uint32_t end : {c.from, c.to})
+            {
+                for (uint32_t a = adjacencyOffsets[end]; a < adjacencyOffsets[end + 1]; a++)
+                {
+                    size_t t = adjacency[a] * 3;
+                    touched[result[t + 0]] = true;
+                    touched[result[t + 1]] = true;
+                    touched[result[t + 2]] = true;
+                }
+            }
+
+            performed++;
+        }
+
+        if (performed == 0)
+            break;
+
+        size_t write = 0;
+
+        for (size_t t = 0; t < result.size(); t += 3)
+        {
+            uint32_t i0 = remap[result[t + 0]];
+            uint32_t i1 = remap[result[t + 1]];
+            uint32_t i2 = remap[result[t + 2]];
+
+            if (i0 == i1 || i1 == i2 || i0 == i2)
+                continue;
+
+            result[write++] = i0;
+            result[write++] = i1;
+            result[write++] = i2;
+        }
+
+        result.resize(write);
+    }
+
+    error = static_cast<float>(std::sqrt(maxCost));
+    return result;
+}
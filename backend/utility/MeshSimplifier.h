@@ -0,0 +1,21 @@
+#ifndef MESHSIMPLIFIER_H
+#define MESHSIMPLIFIER_H
+
+#include "VulkanUtils.h"
+
+
+/**
+ * @class MeshSimplifier
+ * @brief Quadric error edge collapse (Garland and Heckbert) over an existing vertex buffer.
+ *
+ * Collapses always move a vertex onto one of its neighbours, so every level of detail can index
+ * the same vertices. Vertices on UV seams or open borders are locked, which keeps texture
+ * charts and silhouettes intact at the cost of reaching the target less often on small meshes.
+ */
+class MeshSimplifier {
+public:
+    // Returns the simplified index list. error receives the largest collapse distance in object space.
+    static std::vector<uint32_t> simplify(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, size_t targetIndexCount, float& error);
+};
+
+#endif
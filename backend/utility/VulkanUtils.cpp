@@ -1,4 +1,5 @@
 #include "VulkanUtils.h"
+#include "MeshCooker.h"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEFAULT_ALIGNED_GENTYPES
@@ -11,15 +12,12 @@
 
 
 size_t MAX_TEX_ID = 0;
+uint32_t MAX_OBJECT_ID = 0;
 
 
-Object loadObject(const char* model, const char* texture)
+// Indices come out in OBJ face order and vertices in first-seen order, MeshCooker reorders both
+void parseObject(const char* model, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
 {
-    std::vector<Vertex> vertices;
-    std::vector<uint32_t> indices;
-    
-    Object obj{};
-    
     tinyobj::attrib_t attrib;
     std::vector<tinyobj::shape_t> shapes;
     std::vector<tinyobj::material_t> materials;
@@ -60,8 +58,6 @@ Object loadObject(const char* model, const char* texture)
 //                attrib.normals[3 * index.normal_index + 2]
 //            };
             
-            vertex.texIndex = MAX_TEX_ID;
-
             if (uniqueVertices.count(vertex) == 0)
             {
                 uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
@@ -73,13 +69,40 @@ Object loadObject(const char* model, const char* texture)
 //            indices.push_back(static_cast<uint32_t>(vertices.size() - 1));
         }
     }
+}
+
+
+Object loadObject(const char* model, const char* texture)
+{
+    Object obj{};
+    CookedMesh mesh;
+    
+    // the cook step writes the cache, a load only cooks what it is missing for itself
+    if (!MeshCooker::load(model, mesh))
+    {
+        parseObject(model, mesh.vertices, mesh.indices);
+        MeshCooker::cook(mesh);
+    }
+    
+    // texture slots are assigned in load order, so they are never part of the cooked mesh
+    for (Vertex& vertex : mesh.vertices)
+    {
+        vertex.texIndex = MAX_TEX_ID;
+    }
     
     MAX_TEX_ID++;
     
-    obj.vertices = vertices;
-    obj.indices = indices;
+    obj.id = MAX_OBJECT_ID++;
+    obj.vertices = std::move(mesh.vertices);
+    obj.indices = std::move(mesh.indices);
+    obj.lodIndices = std::move(mesh.lodIndices);
+    obj.lods = std::move(mesh.lods);
+    obj.meshlets = std::move(mesh.meshlets);
+    obj.bvhNodes = std::move(mesh.bvhNodes);
+    obj.bvhTriangles = std::move(mesh.bvhTriangles);
     obj.texture = texture;
-    obj.boundingBox = generateBoundingBox(vertices);
+    obj.boundingBox = generateBoundingBox(obj.vertices);
+    obj.uvDensity = computeUvDensity(obj.vertices, obj.indices);
     
     return obj;
 };
@@ -112,6 +135,35 @@ BoundingBox generateBoundingBox(const std::vector<Vertex>& vertices)
 }
 
 
+// Square root of the ratio of texture coordinate area to surface area, used to turn on-screen
+// size into the mip level a texture is sampled at.
+float computeUvDensity(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+{
+    double surfaceArea = 0.0;
+    double uvArea = 0.0;
+    
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        const Vertex& a = vertices[indices[i]];
+        const Vertex& b = vertices[indices[i + 1]];
+        const Vertex& c = vertices[indices[i + 2]];
+        
+        surfaceArea += glm::length(glm::cross(b.pos - a.pos, c.pos - a.pos));
+        
+        glm::vec2 u = b.texCoord - a.texCoord;
+        glm::vec2 v = c.texCoord - a.texCoord;
+        uvArea += std::abs(u.x * v.y - u.y * v.x);
+    }
+    
+    if (surfaceArea <= 0.0)
+    {
+        return 0.f;
+    }
+    
+    return static_cast<float>(std::sqrt(uvArea / surfaceArea));
+}
+
+
 bool checkValidationLayerSupport()
 {
     uint32_t layerCount;
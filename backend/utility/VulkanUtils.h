@@ -104,13 +104,62 @@ struct BoundingBox {
 };
 
 
+struct MeshLod
+{
+    uint32_t indexOffset;   // into indices followed by lodIndices
+    uint32_t indexCount;
+    float error;            // largest simplification error, in object space
+};
+
+
+struct Meshlet
+{
+    uint32_t indexOffset;   // into the base indices
+    uint32_t indexCount;
+    
+    glm::vec3 center;
+    float radius;
+    
+    // sine of the normal cone's half angle, 1 or more when the cone is too wide to ever be backfacing
+    glm::vec3 coneAxis;
+    float coneCutoff;
+};
+
+
+// 32 bytes, so two nodes share a cache line and a node's bounds load as two aligned vec4s
+struct BvhNode
+{
+    glm::vec3 min;
+    uint32_t leftOrFirst;   // first child when count is 0, the right child follows it, else first of bvhTriangles
+    glm::vec3 max;
+    uint32_t count;         // triangles in a leaf, 0 for an inner node
+};
+
+
 struct Object
 {
+    // numbered in load order, actors built from the same load keep the number with their copy
+    uint32_t id = 0;
+    
     std::vector<Vertex> vertices;
     std::vector<uint32_t> indices;
+    
+    // coarser levels share the vertices, lods[0] is always indices itself
+    std::vector<uint32_t> lodIndices;
+    std::vector<MeshLod> lods;
+    
+    // clusters of the base level in index order, for culling below object granularity
+    std::vector<Meshlet> meshlets;
+    
+    // bounding volume hierarchy over the base level, leaves hold triangle numbers into indices
+    std::vector<BvhNode> bvhNodes;
+    std::vector<uint32_t> bvhTriangles;
     const char* texture;
     BoundingBox boundingBox;
     
+    // texture coordinate units per object-space unit, averaged over triangle area
+    float uvDensity = 0.f;
+    
     bool operator==(const Object& other) const
     {
         if (vertices != other.vertices)
@@ -177,8 +226,10 @@ const std::vector<const char*> deviceExtensions =
     VK_KHR_SWAPCHAIN_EXTENSION_NAME
 };
 
+void parseObject(const char* model, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
 Object loadObject(const char* model, const char* texture);
 BoundingBox generateBoundingBox(const std::vector<Vertex>& vertices);
+float computeUvDensity(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
 
 bool checkValidationLayerSupport();
 
@@ -25,6 +25,12 @@ void VulkanManager::init(Window* window, World* w)
 }
 
 
+void VulkanManager::beginFrame()
+{
+    renderPipeline.beginFrame();
+}
+
+
 void VulkanManager::draw()
 {
     renderPipeline.drawFrame();
@@ -109,8 +115,6 @@ void VulkanManager::createInstance()
 
 void VulkanManager::destroy()
 {
-    renderPipeline.destroyColorResources();
-    renderPipeline.destroyDepthBuffer();
     swapChain.destroy();
     renderPipeline.destroy();
     deviceManager.destroy();
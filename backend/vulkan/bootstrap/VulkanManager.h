@@ -27,6 +27,7 @@ public:
     void init(Window* window, World* w);
 
     void destroy();
+    void beginFrame();
     void draw();
     void idle();
     
@@ -0,0 +1,233 @@
+#include "CommandRecorder.h"
+#include <chrono>
+
+
+#define RECORD_TIME_SMOOTHING 0.05
+
+
+CommandRecorder::CommandRecorder()
+{
+}
+
+
+void CommandRecorder::init(DeviceManager* d, uint32_t frames, uint32_t threadCount)
+{
+    device = d->device;
+    queueFamilyIndex = d->findQueueFamilies(d->physicalDevice).graphicsFamily.value();
+    frameCount = frames;
+
+    setThreadCount(threadCount);
+}
+
+
+// the caller must make sure none of the recorded buffers are still pending on the GPU
+void CommandRecorder::setThreadCount(uint32_t threadCount)
+{
+    threadCount = std::max(threadCount, 1u);
+
+    stopWorkers();
+    destroySlots();
+
+    createSlots(threadCount);
+    startWorkers(threadCount - 1);
+
+    recordTime = 0.0;
+}
+
+
+void CommandRecorder::createSlots(uint32_t count)
+{
+    slots.resize(count);
+
+    for (RecordSlot& slot : slots)
+    {
+        slot.commandPools.resize(frameCount);
+        slot.commandBuffers.resize(frameCount);
+
+        for (uint32_t i = 0; i < frameCount; i++)
+        {
+            VkCommandPoolCreateInfo poolInfo{};
+            poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+            poolInfo.queueFamilyIndex = queueFamilyIndex;
+
+            if (vkCreateCommandPool(device, &poolInfo, nullptr, &slot.commandPools[i]) != VK_SUCCESS)
+                throw std::runtime_error("failed to create secondary command pool!");
+
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool = slot.commandPools[i];
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            allocInfo.commandBufferCount = 1;
+
+            if (vkAllocateCommandBuffers(device, &allocInfo, &slot.commandBuffers[i]) != VK_SUCCESS)
+                throw std::runtime_error("failed to allocate secondary command buffers!");
+        }
+    }
+}
+
+
+void CommandRecorder::destroySlots()
+{
+    for (RecordSlot& slot : slots)
+    {
+        for (VkCommandPool pool : slot.commandPools)
+        {
+            vkDestroyCommandPool(device, pool, nullptr);
+        }
+    }
+
+    slots.clear();
+}
+
+
+void CommandRecorder::startWorkers(uint32_t count)
+{
+    running = true;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        workers.emplace_back(&CommandRecorder::run, this);
+    }
+}
+
+
+void CommandRecorder::stopWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        running = false;
+    }
+    taskCondition.notify_all();
+
+    for (std::thread& worker : workers)
+    {
+        if (worker.joinable())
+            worker.join();
+    }
+
+    workers.clear();
+}
+
+
+const std::vector<VkCommandBuffer>& CommandRecorder::record(uint32_t frame, const VkCommandBufferInheritanceInfo& inheritanceInfo, size_t drawCount,
+                                                            const std::function<void(VkCommandBuffer, size_t, size_t)>& recordRange)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    size_t chunks = std::max<size_t>(drawCount / MIN_DRAWS_PER_THREAD, 1);
+    activeSlots = static_cast<uint32_t>(std::min(chunks, slots.size()));
+
+    recordedBuffers.clear();
+    recordFailed = false;
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        pendingTasks = activeSlots - 1;
+    }
+
+    // draws are split evenly and executed in slot order, so submission order matches the draw list
+    for (uint32_t i = 1; i < activeSlots; i++)
+    {
+        size_t first = drawCount * i / activeSlots;
+        size_t last = drawCount * (i + 1) / activeSlots;
+
+        enqueueTask([this, i, frame, first, last, &inheritanceInfo, &recordRange]()
+        {
+            recordSlot(slots[i], frame, inheritanceInfo, first, last, recordRange);
+        });
+    }
+
+    recordSlot(slots[0], frame, inheritanceInfo, 0, drawCount / activeSlots, recordRange);
+
+    {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        doneCondition.wait(lock, [this]() { return pendingTasks == 0; });
+    }
+
+    if (recordFailed)
+    {
+        throw std::runtime_error("failed to record secondary command buffer!");
+    }
+
+    for (uint32_t i = 0; i < activeSlots; i++)
+    {
+        recordedBuffers.push_back(slots[i].commandBuffers[frame]);
+    }
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+    recordTime = (recordTime == 0.0) ? elapsed.count() : recordTime + (elapsed.count() - recordTime) * RECORD_TIME_SMOOTHING;
+
+    return recordedBuffers;
+}
+
+
+void CommandRecorder::recordSlot(RecordSlot& slot, uint32_t frame, const VkCommandBufferInheritanceInfo& inheritanceInfo, size_t first, size_t last,
+                                 const std::function<void(VkCommandBuffer, size_t, size_t)>& recordRange)
+{
+    VkCommandBuffer commandBuffer = slot.commandBuffers[frame];
+
+    vkResetCommandPool(device, slot.commandPools[frame], 0);
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+    {
+        recordFailed = true;
+        return;
+    }
+
+    recordRange(commandBuffer, first, last);
+
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+    {
+        recordFailed = true;
+    }
+}
+
+
+void CommandRecorder::enqueueTask(const std::function<void()>& task)
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    taskQueue.push(task);
+    taskCondition.notify_one();
+}
+
+
+void CommandRecorder::run()
+{
+    while (running)
+    {
+        std::function<void()> task;
+
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+
+            taskCondition.wait(lock, [this]() { return !taskQueue.empty() || !running; });
+
+            if (!running && taskQueue.empty())
+                return;
+
+            task = std::move(taskQueue.front());
+            taskQueue.pop();
+        }
+
+        task();
+
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            pendingTasks--;
+        }
+        doneCondition.notify_one();
+    }
+}
+
+
+void CommandRecorder::destroy()
+{
+    stopWorkers();
+    destroySlots();
+}
@@ -0,0 +1,88 @@
+#ifndef COMMANDRECORDER_H
+#define COMMANDRECORDER_H
+
+#include "VulkanUtils.h"
+#include "DeviceManager.h"
+
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+#include <atomic>
+
+
+// Below this many draws per thread the hand-off costs more than it saves. Every extra slot pays a
+// pool reset, a secondary begin/end and a worker wake-up, which is worth tens of draws. Build with
+// BENCHMARK_RENDERING to see where the split starts paying off on a given driver.
+#define MIN_DRAWS_PER_THREAD 64
+
+
+struct RecordSlot
+{
+    std::vector<VkCommandPool> commandPools;        // one per frame in flight
+    std::vector<VkCommandBuffer> commandBuffers;    // secondary, one per frame in flight
+};
+
+
+/**
+ * @class CommandRecorder
+ * @brief Records a draw range into secondary command buffers across a pool of worker threads.
+ *
+ * Every slot owns its own command pools, so no pool is ever touched by two threads at once.
+ * Slot 0 is always recorded by the calling thread, the remaining slots are handed to workers.
+ */
+class CommandRecorder {
+private:
+    VkDevice device;
+    uint32_t queueFamilyIndex;
+    uint32_t frameCount;
+
+    std::vector<RecordSlot> slots;
+    std::vector<VkCommandBuffer> recordedBuffers;
+
+    std::vector<std::thread> workers;
+    std::atomic<bool> running = false;
+
+    std::queue<std::function<void()>> taskQueue;
+    std::mutex queueMutex;
+    std::condition_variable taskCondition;
+
+    uint32_t pendingTasks = 0;
+    std::condition_variable doneCondition;
+    std::atomic<bool> recordFailed = false;
+
+    double recordTime = 0.0;
+    uint32_t activeSlots = 0;
+
+public:
+    CommandRecorder();
+
+    void init(DeviceManager* d, uint32_t frames, uint32_t threadCount);
+    void destroy();
+
+    void setThreadCount(uint32_t threadCount);
+
+    const std::vector<VkCommandBuffer>& record(uint32_t frame, const VkCommandBufferInheritanceInfo& inheritanceInfo, size_t drawCount,
+                                               const std::function<void(VkCommandBuffer, size_t, size_t)>& recordRange);
+
+    const bool shouldSplit(size_t drawCount) const { return slots.size() > 1 && drawCount >= 2 * MIN_DRAWS_PER_THREAD; }
+    const uint32_t getThreadCount() const { return static_cast<uint32_t>(slots.size()); }
+    const uint32_t getActiveSlots() const { return activeSlots; }
+    const double getRecordTime() const { return recordTime; }
+
+private:
+    void createSlots(uint32_t count);
+    void destroySlots();
+
+    void startWorkers(uint32_t count);
+    void stopWorkers();
+
+    void recordSlot(RecordSlot& slot, uint32_t frame, const VkCommandBufferInheritanceInfo& inheritanceInfo, size_t first, size_t last,
+                    const std::function<void(VkCommandBuffer, size_t, size_t)>& recordRange);
+
+    void enqueueTask(const std::function<void()>& task);
+    void run();
+};
+
+#endif
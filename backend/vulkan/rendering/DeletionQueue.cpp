@@ -0,0 +1,47 @@
+#include "DeletionQueue.h"
+
+
+DeletionQueue::DeletionQueue()
+{
+}
+
+
+void DeletionQueue::push(uint64_t lastSubmission, const std::function<void()>& destroy)
+{
+    pending.push_back({lastSubmission, destroy});
+}
+
+
+void DeletionQueue::retire(uint64_t completedSubmission)
+{
+    size_t kept = 0;
+    
+    for (size_t i = 0; i < pending.size(); i++)
+    {
+        if (pending[i].lastSubmission <= completedSubmission)
+        {
+            pending[i].destroy();
+        }
+        else
+        {
+            if (kept != i)
+                pending[kept] = std::move(pending[i]);
+            
+            kept++;
+        }
+    }
+    
+    pending.resize(kept);
+}
+
+
+// only valid once the device is idle
+void DeletionQueue::flush()
+{
+    for (PendingDeletion& deletion : pending)
+    {
+        deletion.destroy();
+    }
+    
+    pending.clear();
+}
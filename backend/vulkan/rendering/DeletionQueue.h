@@ -0,0 +1,38 @@
+#ifndef DELETIONQUEUE_H
+#define DELETIONQUEUE_H
+
+#include <functional>
+#include <vector>
+#include <stdint.h>
+
+
+struct PendingDeletion
+{
+    uint64_t lastSubmission;
+    std::function<void()> destroy;
+};
+
+
+/**
+ * @class DeletionQueue
+ * @brief Defers destruction of GPU objects until the last submission that may use them has retired.
+ *
+ * Deletions are tagged with the submission index current at the time they are queued.
+ * Fence signals cover every earlier submission on the queue, so once any fence for a
+ * submission at or past that index has been waited on the object is no longer in use.
+ */
+class DeletionQueue {
+private:
+    std::vector<PendingDeletion> pending;
+    
+public:
+    DeletionQueue();
+    
+    void push(uint64_t lastSubmission, const std::function<void()>& destroy);
+    void retire(uint64_t completedSubmission);
+    void flush();
+    
+    const size_t size() const { return pending.size(); }
+};
+
+#endif
@@ -0,0 +1,77 @@
+#include "DrawList.h"
+#include <algorithm>
+#include <array>
+
+
+DrawList::DrawList()
+{
+}
+
+
+void DrawList::clear()
+{
+    commands.clear();
+    ranges.clear();
+}
+
+
+void DrawList::add(uint64_t key, uint32_t actorIndex, uint16_t pipelineId, uint32_t firstRange, uint32_t rangeCount)
+{
+    commands.push_back({key, actorIndex, pipelineId, firstRange, rangeCount});
+}
+
+
+uint64_t DrawList::makeKey(uint8_t pass, uint16_t pipeline, uint16_t texture, uint16_t mesh, float normalizedDepth)
+{
+    const uint64_t depthMax = (1ull << DRAW_KEY_DEPTH_BITS) - 1;
+    uint64_t depth = static_cast<uint64_t>(std::clamp(normalizedDepth, 0.f, 1.f) * depthMax);
+    
+    return (static_cast<uint64_t>(pass & 0xF) << DRAW_KEY_PASS_SHIFT) |
+           (static_cast<uint64_t>(pipeline & 0x3FF) << DRAW_KEY_PIPELINE_SHIFT) |
+           (static_cast<uint64_t>(texture & 0x3FF) << DRAW_KEY_TEXTURE_SHIFT) |
+           (static_cast<uint64_t>(mesh) << DRAW_KEY_MESH_SHIFT) |
+           depth;
+}
+
+
+// LSD radix sort, one byte per pass. Stable, and passes where every key shares the
+// same byte are skipped, which is common for the high (pass/pipeline) bytes.
+void DrawList::sort()
+{
+    if (commands.size() < 2)
+    {
+        return;
+    }
+    
+    scratch.resize(commands.size());
+    
+    for (uint32_t shift = 0; shift < 64; shift += 8)
+    {
+        std::array<size_t, 256> counts{};
+        
+        for (const DrawCommand& command : commands)
+        {
+            counts[(command.key >> shift) & 0xFF]++;
+        }
+        
+        if (counts[(commands[0].key >> shift) & 0xFF] == commands.size())
+        {
+            continue;
+        }
+        
+        size_t offset = 0;
+        for (size_t& count : counts)
+        {
+            size_t c = count;
+            count = offset;
+            offset += c;
+        }
+        
+        for (const DrawCommand& command : commands)
+        {
+            scratch[counts[(command.key >> shift) & 0xFF]++] = command;
+        }
+        
+        commands.swap(scratch);
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef DRAWLIST_H
+#define DRAWLIST_H
+
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+
+// Sort key layout, most significant first:
+// pass (4) | pipeline (10) | texture (10) | mesh (16) | depth (24)
+#define DRAW_KEY_PASS_SHIFT 60
+#define DRAW_KEY_PIPELINE_SHIFT 50
+#define DRAW_KEY_TEXTURE_SHIFT 40
+#define DRAW_KEY_MESH_SHIFT 24
+
+#define DRAW_KEY_DEPTH_BITS 24
+
+// set on DrawCommand::actorIndex when the draw is a static batch, the low bits are the batch index
+#define DRAW_BATCH_BIT 0x80000000u
+
+
+// relative to the first index of the draw's mesh
+struct IndexRange
+{
+    uint32_t firstIndex;
+    uint32_t indexCount;
+};
+
+
+struct DrawCommand
+{
+    uint64_t key;
+    uint32_t actorIndex;
+    uint16_t pipelineId;
+    
+    // ranges in the owning list that replace the whole mesh, none means the whole mesh is drawn
+    uint32_t firstRange;
+    uint32_t rangeCount;
+};
+
+
+struct DrawStats
+{
+    uint32_t draws = 0;
+    uint32_t pipelineBinds = 0;
+    uint32_t textureChanges = 0;
+    uint32_t meshChanges = 0;
+    
+    DrawStats& operator+=(const DrawStats& other)
+    {
+        draws += other.draws;
+        pipelineBinds += other.pipelineBinds;
+        textureChanges += other.textureChanges;
+        meshChanges += other.meshChanges;
+        return *this;
+    }
+};
+
+
+/**
+ * @class DrawList
+ * @brief Per-frame list of draws ordered by a packed 64-bit state key.
+ *
+ * Sorting groups draws by pass, then pipeline, texture and mesh so state only changes
+ * at group boundaries, with depth last so each group is drawn front-to-back.
+ */
+class DrawList {
+private:
+    std::vector<DrawCommand> commands;
+    std::vector<DrawCommand> scratch;
+    std::vector<IndexRange> ranges;
+    
+public:
+    DrawList();
+    
+    void clear();
+    void add(uint64_t key, uint32_t actorIndex, uint16_t pipelineId, uint32_t firstRange = 0, uint32_t rangeCount = 0);
+    void sort();
+    
+    static uint64_t makeKey(uint8_t pass, uint16_t pipeline, uint16_t texture, uint16_t mesh, float normalizedDepth);
+    
+    const size_t size() const { return commands.size(); }
+    const bool empty() const { return commands.empty(); }
+    const DrawCommand& operator[](size_t i) const { return commands[i]; }
+    
+    std::vector<IndexRange>& getRanges() { return ranges; }
+    const IndexRange& getRange(size_t i) const { return ranges[i]; }
+};
+
+#endif
@@ -0,0 +1,82 @@
+#include "DynamicResolution.h"
+#include <cmath>
+
+
+DynamicResolution::DynamicResolution()
+{
+}
+
+
+void DynamicResolution::init(double budgetMilliseconds, float floorScale)
+{
+    frameBudget = budgetMilliseconds;
+    minScale = glm::clamp(floorScale, 0.1f, maxScale);
+    scale = maxScale;
+    
+    smoothedFrameTime = 0.0;
+    cooldown = COOLDOWN_FRAMES;
+}
+
+
+void DynamicResolution::update(double gpuMilliseconds)
+{
+    if (!enabled)
+        return;
+    
+    if (smoothedFrameTime == 0.0)
+    {
+        smoothedFrameTime = gpuMilliseconds;
+    }
+    
+    smoothedFrameTime += (gpuMilliseconds - smoothedFrameTime) * SMOOTHING;
+    
+    if (cooldown > 0)
+    {
+        cooldown--;
+        return;
+    }
+    
+    const bool overBudget = smoothedFrameTime > frameBudget * UPPER_THRESHOLD;
+    const bool underBudget = smoothedFrameTime < frameBudget * LOWER_THRESHOLD;
+    
+    if (!overBudget && !(underBudget && scale < maxScale))
+        return;
+    
+    // aim for the middle of the band, GPU cost scales with pixel count (scale squared)
+    const double target = frameBudget * (UPPER_THRESHOLD + LOWER_THRESHOLD) * 0.5;
+    float desired = scale * static_cast<float>(std::sqrt(target / smoothedFrameTime));
+    
+    desired = std::round(desired / SCALE_GRANULARITY) * SCALE_GRANULARITY;
+    desired = glm::clamp(desired, minScale, maxScale);
+    
+    if (desired == scale)
+        return;
+    
+    // assume the new cost follows the pixel count until fresh samples arrive
+    smoothedFrameTime *= (desired * desired) / (scale * scale);
+    
+    scale = desired;
+    cooldown = COOLDOWN_FRAMES;
+}
+
+
+VkExtent2D DynamicResolution::scaleExtent(const VkExtent2D& maxExtent) const
+{
+    VkExtent2D extent;
+    
+    extent.width = std::max(1u, static_cast<uint32_t>(maxExtent.width * scale));
+    extent.height = std::max(1u, static_cast<uint32_t>(maxExtent.height * scale));
+    
+    return extent;
+}
+
+
+void DynamicResolution::setEnabled(const bool e)
+{
+    enabled = e;
+    
+    if (!enabled)
+    {
+        scale = maxScale;
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef DYNAMICRESOLUTION_H
+#define DYNAMICRESOLUTION_H
+
+#include "VulkanUtils.h"
+
+
+/**
+ * @class DynamicResolution
+ * @brief Picks the internal render resolution from measured GPU frame time.
+ *
+ * The controller keeps a smoothed GPU time and only changes the scale when that
+ * time leaves a band around the frame budget. After every change it waits a few
+ * frames before reacting again so a single spike cannot make it oscillate.
+ * Scale is applied per axis, so pixel cost grows with its square.
+ */
+class DynamicResolution {
+private:
+    bool enabled = true;
+    
+    double frameBudget = 16.6;
+    float minScale = 0.5f;
+    float maxScale = 1.f;
+    float scale = 1.f;
+    
+    double smoothedFrameTime = 0.0;
+    uint32_t cooldown = 0;
+    
+    // fraction of the budget above which we drop resolution, and below which we raise it
+    const double UPPER_THRESHOLD = 0.95;
+    const double LOWER_THRESHOLD = 0.75;
+    
+    const double SMOOTHING = 0.1;
+    const uint32_t COOLDOWN_FRAMES = 30;
+    const float SCALE_GRANULARITY = 0.05f;
+    
+public:
+    DynamicResolution();
+    
+    void init(double budgetMilliseconds, float floorScale);
+    void update(double gpuMilliseconds);
+    
+    VkExtent2D scaleExtent(const VkExtent2D& maxExtent) const;
+    
+    void setEnabled(const bool e);
+    
+    const bool getEnabled() const { return enabled; }
+    const float getScale() const { return scale; }
+    const double getSmoothedFrameTime() const { return smoothedFrameTime; }
+};
+
+#endif
@@ -0,0 +1,119 @@
+#include "FramePacer.h"
+#include <thread>
+
+
+FramePacer::FramePacer()
+{
+}
+
+
+void FramePacer::init(uint16_t refreshRate)
+{
+    refreshInterval = 1000.0 / std::max<uint16_t>(refreshRate, 1);
+    
+    lastFrameReady = Clock::now();
+    
+    setMode(mode);
+}
+
+
+LatencySettings FramePacer::settingsFor(const LatencyMode m)
+{
+    switch (m)
+    {
+        case LatencyMode::LM_LOW_LATENCY:
+            return {VK_PRESENT_MODE_FIFO_KHR, true};
+            
+        case LatencyMode::LM_UNCAPPED:
+            return {VK_PRESENT_MODE_IMMEDIATE_KHR, false};
+            
+        case LatencyMode::LM_THROUGHPUT:
+        default:
+            return {VK_PRESENT_MODE_MAILBOX_KHR, false};
+    }
+}
+
+
+void FramePacer::setMode(const LatencyMode m)
+{
+    mode = m;
+    settings = settingsFor(m);
+    
+    resetLatencyStats();
+}
+
+
+// called once the fence for this frame slot has been waited on
+void FramePacer::frameReady()
+{
+    lastFrameReady = Clock::now();
+    cpuWorkStart = lastFrameReady;
+}
+
+
+// Sleeps so that input is sampled as late as possible while the frame still finishes
+// before the next refresh. Only the predicted CPU and GPU work is left in front of the deadline.
+void FramePacer::pace()
+{
+    if (!settings.paceCpu)
+    {
+        return;
+    }
+    
+    double predictedWork = smoothedCpuTime + smoothedGpuTime + PACING_MARGIN;
+    double sleepTime = std::min(refreshInterval - predictedWork, refreshInterval);
+    
+    if (sleepTime <= 0.0)
+    {
+        return;
+    }
+    
+    std::this_thread::sleep_until(lastFrameReady + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(sleepTime)));
+    
+    // simulation and recording that follow are the work being predicted
+    cpuWorkStart = Clock::now();
+}
+
+
+void FramePacer::markInputSampled(const Clock::time_point& sampleTime)
+{
+    inputSampleTime = sampleTime;
+    pendingSample = true;
+}
+
+
+void FramePacer::markSubmitted()
+{
+    std::chrono::duration<double, std::milli> cpuTime = Clock::now() - cpuWorkStart;
+    smoothedCpuTime = (smoothedCpuTime == 0.0) ? cpuTime.count() : smoothedCpuTime + (cpuTime.count() - smoothedCpuTime) * SMOOTHING;
+}
+
+
+// called once the present for the frame input was last sampled for has been queued
+void FramePacer::markPresented()
+{
+    if (!pendingSample)
+    {
+        return;
+    }
+    
+    pendingSample = false;
+    
+    std::chrono::duration<double, std::milli> latency = Clock::now() - inputSampleTime;
+    
+    inputLatency = (inputLatency == 0.0) ? latency.count() : inputLatency + (latency.count() - inputLatency) * SMOOTHING;
+    worstInputLatency = std::max(worstInputLatency, latency.count());
+}
+
+
+void FramePacer::setGpuTime(double gpuMilliseconds)
+{
+    smoothedGpuTime = (smoothedGpuTime == 0.0) ? gpuMilliseconds : smoothedGpuTime + (gpuMilliseconds - smoothedGpuTime) * SMOOTHING;
+}
+
+
+void FramePacer::resetLatencyStats()
+{
+    inputLatency = 0.0;
+    worstInputLatency = 0.0;
+}
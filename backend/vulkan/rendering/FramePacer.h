@@ -0,0 +1,81 @@
+#ifndef FRAMEPACER_H
+#define FRAMEPACER_H
+
+#include "VulkanUtils.h"
+#include <chrono>
+
+
+// frames in flight are chosen separately, see RenderPipeline::setFramesInFlight
+enum LatencyMode
+{
+    LM_THROUGHPUT = 0,      // mailbox, no CPU wait
+    LM_LOW_LATENCY = 1,     // vsync, CPU sleeps until just before the frame is needed
+    LM_UNCAPPED = 2         // immediate present (may tear)
+};
+
+
+struct LatencySettings
+{
+    VkPresentModeKHR presentMode;
+    bool paceCpu;
+};
+
+
+/**
+ * @class FramePacer
+ * @brief Applies a latency mode and measures input-to-present latency per frame.
+ *
+ * Latency is measured from the moment input was last sampled for a frame until that frame
+ * was handed to presentation, so it does not depend on when the CPU next comes back to the
+ * frame's slot and does not grow with the frames in flight.
+ */
+class FramePacer {
+private:
+    typedef std::chrono::high_resolution_clock Clock;
+    
+    LatencyMode mode = LM_THROUGHPUT;
+    LatencySettings settings;
+    
+    double refreshInterval = 16.6;
+    double smoothedCpuTime = 0.0;
+    double smoothedGpuTime = 0.0;
+    
+    Clock::time_point lastFrameReady;
+    Clock::time_point cpuWorkStart;
+    
+    Clock::time_point inputSampleTime;
+    bool pendingSample = false;
+    
+    double inputLatency = 0.0;
+    double worstInputLatency = 0.0;
+    
+    const double SMOOTHING = 0.1;
+    
+    // slack left between the predicted end of work and the moment the frame is needed
+    const double PACING_MARGIN = 1.5;
+    
+public:
+    FramePacer();
+    
+    void init(uint16_t refreshRate);
+    
+    void setMode(const LatencyMode m);
+    static LatencySettings settingsFor(const LatencyMode m);
+    
+    void frameReady();
+    void pace();
+    
+    void markInputSampled(const Clock::time_point& sampleTime);
+    void markSubmitted();
+    void markPresented();
+    void setGpuTime(double gpuMilliseconds);
+    
+    const LatencyMode getMode() const { return mode; }
+    const LatencySettings& getSettings() const { return settings; }
+    const double getInputLatency() const { return inputLatency; }
+    const double getWorstInputLatency() const { return worstInputLatency; }
+    
+    void resetLatencyStats();
+};
+
+#endif
@@ -0,0 +1,306 @@
+#include "GeometryHeap.h"
+
+
+void RangeAllocator::init(uint32_t c)
+{
+    capacity = c;
+    used = 0;
+    freeRanges = {{0, c}};
+}
+
+
+void RangeAllocator::grow(uint32_t newCapacity)
+{
+    free(capacity, newCapacity - capacity);
+    
+    // the new tail was never allocated, undo the bookkeeping free() did for it
+    used += newCapacity - capacity;
+    capacity = newCapacity;
+}
+
+
+bool RangeAllocator::allocate(uint32_t size, uint32_t& offset)
+{
+    if (size == 0)
+    {
+        offset = 0;
+        return true;
+    }
+    
+    for (size_t i = 0; i < freeRanges.size(); i++)
+    {
+        HeapRange& range = freeRanges[i];
+        
+        if (range.size < size)
+        {
+            continue;
+        }
+        
+        offset = range.offset;
+        range.offset += size;
+        range.size -= size;
+        
+        if (range.size == 0)
+        {
+            freeRanges.erase(freeRanges.begin() + i);
+        }
+        
+        used += size;
+        return true;
+    }
+    
+    return false;
+}
+
+
+void RangeAllocator::free(uint32_t offset, uint32_t size)
+{
+    if (size == 0)
+    {
+        return;
+    }
+    
+    auto it = std::lower_bound(freeRanges.begin(), freeRanges.end(), offset,
+        [](const HeapRange& range, uint32_t o) { return range.offset < o; });
+    
+    it = freeRanges.insert(it, {offset, size});
+    used -= size;
+    
+    // merge with the following range, then with the preceding one
+    auto next = it + 1;
+    if (next != freeRanges.end() && it->offset + it->size == next->offset)
+    {
+        it->size += next->size;
+        freeRanges.erase(next);
+    }
+    
+    if (it != freeRanges.begin())
+    {
+        auto prev = it - 1;
+        if (prev->offset + prev->size == it->offset)
+        {
+            prev->size += it->size;
+            freeRanges.erase(it);
+        }
+    }
+}
+
+
+/*-------------------------------------------------*/
+
+
+GeometryHeap::GeometryHeap()
+{
+}
+
+
+void GeometryHeap::init(DeviceManager* d)
+{
+    deviceManager = d;
+    
+    vertexRanges.init(GEOMETRY_HEAP_VERTICES);
+    indexRanges.init(GEOMETRY_HEAP_INDICES);
+    
+    createBuffer(deviceManager->device, deviceManager->physicalDevice, sizeof(Vertex) * GEOMETRY_HEAP_VERTICES,
+                 VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferMemory);
+    
+    createBuffer(deviceManager->device, deviceManager->physicalDevice, sizeof(uint32_t) * GEOMETRY_HEAP_INDICES,
+                 VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferMemory);
+}
+
+
+uint32_t GeometryHeap::upload(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+{
+    MeshAllocation mesh{};
+    mesh.vertexCount = static_cast<uint32_t>(vertices.size());
+    mesh.indexCount = static_cast<uint32_t>(indices.size());
+    mesh.live = true;
+    
+    if (!vertexRanges.allocate(mesh.vertexCount, mesh.vertexOffset))
+    {
+        growVertices(mesh.vertexCount);
+        vertexRanges.allocate(mesh.vertexCount, mesh.vertexOffset);
+    }
+    
+    if (!indexRanges.allocate(mesh.indexCount, mesh.indexOffset))
+    {
+        growIndices(mesh.indexCount);
+        indexRanges.allocate(mesh.indexCount, mesh.indexOffset);
+    }
+    
+    VkDeviceSize vertexBytes = sizeof(Vertex) * vertices.size();
+    VkDeviceSize indexBytes = sizeof(uint32_t) * indices.size();
+    
+    if (vertexBytes + indexBytes > 0)
+    {
+        VkBuffer stagingBuffer;
+        VkDeviceMemory stagingBufferMemory;
+        createBuffer(deviceManager->device, deviceManager->physicalDevice, vertexBytes + indexBytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+        
+        char* data;
+        vkMapMemory(deviceManager->device, stagingBufferMemory, 0, vertexBytes + indexBytes, 0, reinterpret_cast<void**>(&data));
+        memcpy(data, vertices.data(), (size_t) vertexBytes);
+        memcpy(data + vertexBytes, indices.data(), (size_t) indexBytes);
+        vkUnmapMemory(deviceManager->device, stagingBufferMemory);
+        
+        if (vertexBytes > 0)
+            pendingUploads.push_back({stagingBuffer, vertexBuffer, {0, sizeof(Vertex) * mesh.vertexOffset, vertexBytes}});
+        
+        if (indexBytes > 0)
+            pendingUploads.push_back({stagingBuffer, indexBuffer, {vertexBytes, sizeof(uint32_t) * mesh.indexOffset, indexBytes}});
+        
+        retiredBuffers.push_back({stagingBuffer, stagingBufferMemory});
+    }
+    
+    if (!freeMeshIds.empty())
+    {
+        uint32_t meshId = freeMeshIds.back();
+        freeMeshIds.pop_back();
+        
+        meshes[meshId] = mesh;
+        return meshId;
+    }
+    
+    meshes.push_back(mesh);
+    return static_cast<uint32_t>(meshes.size() - 1);
+}
+
+
+void GeometryHeap::release(uint32_t meshId)
+{
+    MeshAllocation& mesh = meshes[meshId];
+    
+    if (!mesh.live)
+    {
+        return;
+    }
+    
+    vertexRanges.free(mesh.vertexOffset, mesh.vertexCount);
+    indexRanges.free(mesh.indexOffset, mesh.indexCount);
+    
+    mesh.live = false;
+    freeMeshIds.push_back(meshId);
+}
+
+
+void GeometryHeap::growVertices(uint32_t required)
+{
+    uint32_t oldCapacity = vertexRanges.getCapacity();
+    uint32_t newCapacity = std::max(oldCapacity * 2, oldCapacity + required);
+    
+    growBuffer(vertexBuffer, vertexBufferMemory, sizeof(Vertex) * oldCapacity, sizeof(Vertex) * newCapacity, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+    vertexRanges.grow(newCapacity);
+}
+
+
+void GeometryHeap::growIndices(uint32_t required)
+{
+    uint32_t oldCapacity = indexRanges.getCapacity();
+    uint32_t newCapacity = std::max(oldCapacity * 2, oldCapacity + required);
+    
+    growBuffer(indexBuffer, indexBufferMemory, sizeof(uint32_t) * oldCapacity, sizeof(uint32_t) * newCapacity, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+    indexRanges.grow(newCapacity);
+}
+
+
+void GeometryHeap::growBuffer(VkBuffer& buffer, VkDeviceMemory& memory, VkDeviceSize oldSize, VkDeviceSize newSize, VkBufferUsageFlags usage)
+{
+    VkBuffer newBuffer;
+    VkDeviceMemory newMemory;
+    createBuffer(deviceManager->device, deviceManager->physicalDevice, newSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, newBuffer, newMemory);
+    
+    pendingGrowth.push_back({buffer, newBuffer, {0, 0, oldSize}});
+    
+    // uploads already staged for the old buffer are redirected, they would land after the growth copy otherwise
+    for (PendingCopy& upload : pendingUploads)
+    {
+        if (upload.dstBuffer == buffer)
+            upload.dstBuffer = newBuffer;
+    }
+    
+    retiredBuffers.push_back({buffer, memory});
+    
+    buffer = newBuffer;
+    memory = newMemory;
+    generation++;
+}
+
+
+// Records pending copies ahead of the render pass. Returns true if the buffers were replaced,
+// in which case anything that captured the old handles has to be re-recorded.
+bool GeometryHeap::recordUploads(VkCommandBuffer commandBuffer, DeletionQueue& deletionQueue, uint64_t lastSubmission)
+{
+    if (pendingGrowth.empty() && pendingUploads.empty())
+    {
+        return false;
+    }
+    
+    bool grew = !pendingGrowth.empty();
+    
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    
+    for (const PendingCopy& copy : pendingGrowth)
+    {
+        // earlier transfers into the source must be visible before it is read
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+        
+        vkCmdCopyBuffer(commandBuffer, copy.srcBuffer, copy.dstBuffer, 1, &copy.region);
+    }
+    
+    if (grew)
+    {
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+    
+    for (const PendingCopy& copy : pendingUploads)
+    {
+        vkCmdCopyBuffer(commandBuffer, copy.srcBuffer, copy.dstBuffer, 1, &copy.region);
+    }
+    
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    
+    pendingGrowth.clear();
+    pendingUploads.clear();
+    
+    VkDevice device = deviceManager->device;
+    std::vector<std::pair<VkBuffer, VkDeviceMemory>> retired = std::move(retiredBuffers);
+    retiredBuffers.clear();
+    
+    deletionQueue.push(lastSubmission, [device, retired]()
+    {
+        for (const auto& [buffer, memory] : retired)
+        {
+            vkDestroyBuffer(device, buffer, nullptr);
+            vkFreeMemory(device, memory, nullptr);
+        }
+    });
+    
+    return grew;
+}
+
+
+void GeometryHeap::destroy()
+{
+    for (const auto& [buffer, memory] : retiredBuffers)
+    {
+        vkDestroyBuffer(deviceManager->device, buffer, nullptr);
+        vkFreeMemory(deviceManager->device, memory, nullptr);
+    }
+    
+    retiredBuffers.clear();
+    
+    vkDestroyBuffer(deviceManager->device, indexBuffer, nullptr);
+    vkFreeMemory(deviceManager->device, indexBufferMemory, nullptr);
+    
+    vkDestroyBuffer(deviceManager->device, vertexBuffer, nullptr);
+    vkFreeMemory(deviceManager->device, vertexBufferMemory, nullptr);
+}
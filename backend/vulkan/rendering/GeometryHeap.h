@@ -0,0 +1,115 @@
+#ifndef GEOMETRYHEAP_H
+#define GEOMETRYHEAP_H
+
+#include "VulkanUtils.h"
+#include "DeviceManager.h"
+#include "DeletionQueue.h"
+
+
+// initial capacity in elements, the heap doubles when an allocation does not fit
+#define GEOMETRY_HEAP_VERTICES (1 << 16)
+#define GEOMETRY_HEAP_INDICES (1 << 18)
+
+
+struct HeapRange
+{
+    uint32_t offset;
+    uint32_t size;
+};
+
+
+/**
+ * @class RangeAllocator
+ * @brief First-fit free list over a linear range of elements, coalescing on free.
+ */
+class RangeAllocator {
+private:
+    std::vector<HeapRange> freeRanges;     // sorted by offset
+    uint32_t capacity = 0;
+    uint32_t used = 0;
+    
+public:
+    void init(uint32_t c);
+    void grow(uint32_t newCapacity);
+    
+    bool allocate(uint32_t size, uint32_t& offset);
+    void free(uint32_t offset, uint32_t size);
+    
+    const uint32_t getCapacity() const { return capacity; }
+    const uint32_t getUsed() const { return used; }
+};
+
+
+struct MeshAllocation
+{
+    uint32_t vertexOffset;
+    uint32_t vertexCount;
+    uint32_t indexOffset;
+    uint32_t indexCount;
+    bool live = false;
+};
+
+
+struct PendingCopy
+{
+    VkBuffer srcBuffer;
+    VkBuffer dstBuffer;
+    VkBufferCopy region;
+};
+
+
+/**
+ * @class GeometryHeap
+ * @brief Sub-allocated device-local vertex and index storage for every mesh in the scene.
+ *
+ * Meshes are referred to by handle. Uploads are staged on the CPU and copied at the start of the
+ * next recorded frame, so spawning never stalls the queue. Growing the heap allocates larger
+ * buffers and copies the old contents at the same offsets, so existing handles stay valid.
+ * Releasing a mesh must be deferred by the caller until no in-flight frame can still read it.
+ */
+class GeometryHeap {
+public:
+    VkBuffer vertexBuffer = VK_NULL_HANDLE;
+    VkBuffer indexBuffer = VK_NULL_HANDLE;
+
+private:
+    VkDeviceMemory vertexBufferMemory;
+    VkDeviceMemory indexBufferMemory;
+    
+    DeviceManager* deviceManager;
+    
+    RangeAllocator vertexRanges;
+    RangeAllocator indexRanges;
+    
+    std::vector<MeshAllocation> meshes;
+    std::vector<uint32_t> freeMeshIds;
+    
+    // growth copies have to land before any upload into the new buffers
+    std::vector<PendingCopy> pendingGrowth;
+    std::vector<PendingCopy> pendingUploads;
+    std::vector<std::pair<VkBuffer, VkDeviceMemory>> retiredBuffers;
+    
+    uint32_t generation = 0;
+    
+public:
+    GeometryHeap();
+    void init(DeviceManager* d);
+    void destroy();
+    
+    uint32_t upload(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+    void release(uint32_t meshId);
+    
+    bool recordUploads(VkCommandBuffer commandBuffer, DeletionQueue& deletionQueue, uint64_t lastSubmission);
+    
+    const MeshAllocation& getMesh(uint32_t meshId) const { return meshes[meshId]; }
+    const uint32_t getGeneration() const { return generation; }
+    const uint32_t getUsedVertices() const { return vertexRanges.getUsed(); }
+    const uint32_t getUsedIndices() const { return indexRanges.getUsed(); }
+    
+private:
+    void growVertices(uint32_t required);
+    void growIndices(uint32_t required);
+    void growBuffer(VkBuffer& buffer, VkDeviceMemory& memory, VkDeviceSize oldSize, VkDeviceSize newSize, VkBufferUsageFlags usage);
+};
+
+#endif
@@ -0,0 +1,90 @@
+#include "GpuTimer.h"
+
+
+GpuTimer::GpuTimer()
+{
+}
+
+
+void GpuTimer::init(DeviceManager* d, uint32_t frameCount)
+{
+    device = d->device;
+    
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(d->physicalDevice, &properties);
+    
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(d->physicalDevice, &queueFamilyCount, nullptr);
+    
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(d->physicalDevice, &queueFamilyCount, queueFamilies.data());
+    
+    uint32_t validBits = queueFamilies[d->findQueueFamilies(d->physicalDevice).graphicsFamily.value()].timestampValidBits;
+    
+    supported = properties.limits.timestampComputeAndGraphics && validBits > 0;
+    
+    if (!supported)
+    {
+        return;
+    }
+    
+    timestampPeriod = properties.limits.timestampPeriod;
+    timestampMask = (validBits >= 64) ? UINT64_MAX : ((1ull << validBits) - 1);
+    
+    VkQueryPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    poolInfo.queryCount = frameCount * 2;
+    
+    if (vkCreateQueryPool(device, &poolInfo, nullptr, &queryPool) != VK_SUCCESS)
+        throw std::runtime_error("failed to create timestamp query pool!");
+    
+    pendingResults.assign(frameCount, false);
+}
+
+
+void GpuTimer::begin(VkCommandBuffer commandBuffer, uint32_t frame)
+{
+    if (!supported)
+        return;
+    
+    vkCmdResetQueryPool(commandBuffer, queryPool, frame * 2, 2);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, frame * 2);
+}
+
+
+void GpuTimer::end(VkCommandBuffer commandBuffer, uint32_t frame)
+{
+    if (!supported)
+        return;
+    
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, frame * 2 + 1);
+    pendingResults[frame] = true;
+}
+
+
+// call only after the fence guarding this frame slot has signalled
+bool GpuTimer::collect(uint32_t frame, double& milliseconds)
+{
+    if (!supported || !pendingResults[frame])
+        return false;
+    
+    uint64_t timestamps[2];
+    
+    if (vkGetQueryPoolResults(device, queryPool, frame * 2, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+        return false;
+    
+    pendingResults[frame] = false;
+    
+    uint64_t ticks = (timestamps[1] - timestamps[0]) & timestampMask;
+    milliseconds = static_cast<double>(ticks) * timestampPeriod / 1e6;
+    
+    return true;
+}
+
+
+void GpuTimer::destroy()
+{
+    if (queryPool != VK_NULL_HANDLE)
+        vkDestroyQueryPool(device, queryPool, nullptr);
+}
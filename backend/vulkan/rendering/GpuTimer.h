@@ -0,0 +1,41 @@
+#ifndef GPUTIMER_H
+#define GPUTIMER_H
+
+#include "VulkanUtils.h"
+#include "DeviceManager.h"
+
+
+/**
+ * @class GpuTimer
+ * @brief Measures GPU execution time per frame in flight using timestamp queries.
+ *
+ * Each frame slot owns a pair of timestamps written around the recorded work.
+ * Results are read back without stalling once the slot's fence has signalled,
+ * so the value returned by collect() always describes the previous use of that slot.
+ */
+class GpuTimer {
+private:
+    VkDevice device;
+    VkQueryPool queryPool = VK_NULL_HANDLE;
+    
+    bool supported = false;
+    float timestampPeriod = 1.f;
+    uint64_t timestampMask = UINT64_MAX;
+    
+    std::vector<bool> pendingResults;
+    
+public:
+    GpuTimer();
+    
+    void init(DeviceManager* d, uint32_t frameCount);
+    void destroy();
+    
+    void begin(VkCommandBuffer commandBuffer, uint32_t frame);
+    void end(VkCommandBuffer commandBuffer, uint32_t frame);
+    
+    bool collect(uint32_t frame, double& milliseconds);
+    
+    const bool isSupported() const { return supported; }
+};
+
+#endif
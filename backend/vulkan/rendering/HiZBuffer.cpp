@@ -0,0 +1,550 @@
+#include "HiZBuffer.h"
+#include "IOUtils.h"
+#include <algorithm>
+#include <cfloat>
+
+
+struct HiZPushConstants
+{
+    glm::ivec2 sourceSize;
+    glm::ivec2 destinationSize;
+    int32_t fromDepth;
+    int32_t samples;
+};
+
+
+HiZBuffer::HiZBuffer()
+{
+}
+
+
+void HiZBuffer::init(DeviceManager* d, VkFormat depthFormat, VkSampleCountFlagBits sampleCount, uint32_t frameCount)
+{
+    device = d->device;
+    physicalDevice = d->physicalDevice;
+    samples = static_cast<uint32_t>(sampleCount);
+
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, depthFormat, &formatProperties);
+
+    supported = (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT)
+             && (properties.limits.sampledImageDepthSampleCounts & sampleCount);
+
+    if (!supported)
+    {
+        return;
+    }
+
+    std::array<VkDescriptorSetLayoutBinding, 3> bindings{};
+
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[0].descriptorCount = 1;
+    bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    for (uint32_t b = 1; b < 3; b++)
+    {
+        bindings[b].binding = b;
+        bindings[b].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        bindings[b].descriptorCount = 1;
+        bindings[b].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
+        throw std::runtime_error("failed to create hi-z descriptor set layout!");
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(HiZPushConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+        throw std::runtime_error("failed to create hi-z pipeline layout!");
+
+    std::vector<char> code = readFile(HIZ_SHADER);
+
+    VkShaderModuleCreateInfo moduleInfo{};
+    moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    moduleInfo.codeSize = code.size();
+    moduleInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+
+    VkShaderModule shaderModule;
+    if (vkCreateShaderModule(device, &moduleInfo, nullptr, &shaderModule) != VK_SUCCESS)
+        throw std::runtime_error("failed to create hi-z shader module!");
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderModule;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = pipelineLayout;
+
+    VkResult result = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline);
+    vkDestroyShaderModule(device, shaderModule, nullptr);
+
+    if (result != VK_SUCCESS)
+        throw std::runtime_error("failed to create hi-z pipeline!");
+
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+
+    if (vkCreateSampler(device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
+        throw std::runtime_error("failed to create hi-z sampler!");
+
+    VkDeviceSize readbackSize = HIZ_READBACK_MAX * HIZ_READBACK_MAX * sizeof(float);
+
+    readbackBuffers.resize(frameCount);
+    readbackMemory.resize(frameCount);
+    readbackMapped.resize(frameCount);
+    captures.assign(frameCount, HiZCapture{});
+
+    for (uint32_t i = 0; i < frameCount; i++)
+    {
+        createBuffer(device, physicalDevice, readbackSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, readbackBuffers[i], readbackMemory[i]);
+
+        vkMapMemory(device, readbackMemory[i], 0, readbackSize, 0, &readbackMapped[i]);
+    }
+}
+
+
+// Level 0 is half the depth buffer, the chain stops at the first level small enough to read back
+void HiZBuffer::createResources(VkImageView depthImageView, VkExtent2D extent)
+{
+    if (!supported)
+    {
+        return;
+    }
+
+    uint32_t width = std::max(extent.width / 2, 1u);
+    uint32_t height = std::max(extent.height / 2, 1u);
+    uint32_t levelCount = 1;
+
+    for (uint32_t w = width, h = height; w > HIZ_READBACK_MAX || h > HIZ_READBACK_MAX; levelCount++)
+    {
+        w = std::max(w / 2, 1u);
+        h = std::max(h / 2, 1u);
+    }
+
+    createImage(device, physicalDevice, width, height, static_cast<uint8_t>(levelCount), VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R32_SFLOAT, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, pyramidImage, pyramidMemory);
+
+    levelViews.resize(levelCount);
+
+    for (uint32_t level = 0; level < levelCount; level++)
+    {
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = pyramidImage;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = VK_FORMAT_R32_SFLOAT;
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.baseMipLevel = level;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        if (vkCreateImageView(device, &viewInfo, nullptr, &levelViews[level]) != VK_SUCCESS)
+            throw std::runtime_error("failed to create hi-z level view!");
+    }
+
+    std::array<VkDescriptorPoolSize, 2> poolSizes{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[0].descriptorCount = levelCount;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    poolSizes[1].descriptorCount = levelCount * 2;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = levelCount;
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+        throw std::runtime_error("failed to create hi-z descriptor pool!");
+
+    std::vector<VkDescriptorSetLayout> layouts(levelCount, descriptorSetLayout);
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.descriptorSetCount = levelCount;
+    allocInfo.pSetLayouts = layouts.data();
+
+    levelSets.resize(levelCount);
+    if (vkAllocateDescriptorSets(device, &allocInfo, levelSets.data()) != VK_SUCCESS)
+        throw std::runtime_error("failed to allocate hi-z descriptor sets!");
+
+    for (uint32_t level = 0; level < levelCount; level++)
+    {
+        VkDescriptorImageInfo depthInfo{};
+        depthInfo.sampler = sampler;
+        depthInfo.imageView = depthImageView;
+        depthInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+        // level 0 reads the depth buffer, its source binding only has to be valid
+        VkDescriptorImageInfo sourceInfo{};
+        sourceInfo.imageView = levelViews[level > 0 ? level - 1 : 0];
+        sourceInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+        VkDescriptorImageInfo destinationInfo{};
+        destinationInfo.imageView = levelViews[level];
+        destinationInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+        std::array<VkWriteDescriptorSet, 3> writes{};
+        std::array<const VkDescriptorImageInfo*, 3> infos = {&depthInfo, &sourceInfo, &destinationInfo};
+
+        for (uint32_t b = 0; b < 3; b++)
+        {
+            writes[b].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[b].dstSet = levelSets[level];
+            writes[b].dstBinding = b;
+            writes[b].descriptorCount = 1;
+            writes[b].descriptorType = b == 0 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+            writes[b].pImageInfo = infos[b];
+        }
+
+        vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+    }
+
+    pyramidInitialized = false;
+}
+
+
+void HiZBuffer::retireResources(DeletionQueue& deletionQueue, uint64_t lastSubmission)
+{
+    if (!supported || pyramidImage == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    VkDevice d = device;
+    VkImage image = pyramidImage;
+    VkDeviceMemory memory = pyramidMemory;
+    std::vector<VkImageView> views = levelViews;
+    VkDescriptorPool pool = descriptorPool;
+
+    deletionQueue.push(lastSubmission, [d, image, memory, views, pool]()
+    {
+        vkDestroyDescriptorPool(d, pool, nullptr);
+
+        for (VkImageView view : views)
+            vkDestroyImageView(d, view, nullptr);
+
+        vkDestroyImage(d, image, nullptr);
+        vkFreeMemory(d, memory, nullptr);
+    });
+
+    pyramidImage = VK_NULL_HANDLE;
+    pyramidMemory = VK_NULL_HANDLE;
+    descriptorPool = VK_NULL_HANDLE;
+    levelViews.clear();
+    levelSets.clear();
+}
+
+
+void HiZBuffer::destroy()
+{
+    if (!supported)
+    {
+        return;
+    }
+
+    vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+
+    for (VkImageView view : levelViews)
+        vkDestroyImageView(device, view, nullptr);
+
+    vkDestroyImage(device, pyramidImage, nullptr);
+    vkFreeMemory(device, pyramidMemory, nullptr);
+
+    for (size_t i = 0; i < readbackBuffers.size(); i++)
+    {
+        vkDestroyBuffer(device, readbackBuffers[i], nullptr);
+        vkFreeMemory(device, readbackMemory[i], nullptr);
+    }
+
+    vkDestroySampler(device, sampler, nullptr);
+    vkDestroyPipeline(device, pipeline, nullptr);
+    vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+}
+
+
+// Recorded as the render graph's hi-z pass, which has already made the depth attachment
+// readable by compute.
+void HiZBuffer::record(VkCommandBuffer commandBuffer, uint32_t frame, VkExtent2D renderExtent, const glm::mat4& viewProjection, double time)
+{
+    if (!supported || !enabled || pyramidImage == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    // the previous frame's copy may still be reading the pyramid
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.oldLayout = pyramidInitialized ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = pyramidImage;
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, static_cast<uint32_t>(levelViews.size()), 0, 1};
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    pyramidInitialized = true;
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+
+    // only the rendered region of the attachments holds this frame's depth
+    glm::ivec2 sourceSize(renderExtent.width, renderExtent.height);
+    uint32_t level = 0;
+
+    VkMemoryBarrier levelBarrier{};
+    levelBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    levelBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    levelBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    while (true)
+    {
+        HiZPushConstants constants{};
+        constants.sourceSize = sourceSize;
+        constants.destinationSize = glm::ivec2(std::max(sourceSize.x / 2, 1), std::max(sourceSize.y / 2, 1));
+        constants.fromDepth = level == 0;
+        constants.samples = static_cast<int32_t>(samples);
+
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &levelSets[level], 0, nullptr);
+        vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+        vkCmdDispatch(commandBuffer, (constants.destinationSize.x + 7) / 8, (constants.destinationSize.y + 7) / 8, 1);
+
+        sourceSize = constants.destinationSize;
+
+        if ((sourceSize.x <= HIZ_READBACK_MAX && sourceSize.y <= HIZ_READBACK_MAX) || level + 1 == levelViews.size())
+        {
+            break;
+        }
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0, 1, &levelBarrier, 0, nullptr, 0, nullptr);
+
+        level++;
+    }
+
+    levelBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0, 1, &levelBarrier, 0, nullptr, 0, nullptr);
+
+    VkBufferImageCopy region{};
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1};
+    region.imageOffset = {0, 0, 0};
+    region.imageExtent = {static_cast<uint32_t>(sourceSize.x), static_cast<uint32_t>(sourceSize.y), 1};
+
+    vkCmdCopyImageToBuffer(commandBuffer, pyramidImage, VK_IMAGE_LAYOUT_GENERAL, readbackBuffers[frame], 1, &region);
+
+    VkBufferMemoryBarrier readbackBarrier{};
+    readbackBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    readbackBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    readbackBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    readbackBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    readbackBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    readbackBarrier.buffer = readbackBuffers[frame];
+    readbackBarrier.offset = 0;
+    readbackBarrier.size = VK_WHOLE_SIZE;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+        0, 0, nullptr, 1, &readbackBarrier, 0, nullptr);
+
+    // a level that still does not fit would overrun the readback buffer, the copy is simply not used
+    HiZCapture& capture = captures[frame];
+    capture.viewProjection = viewProjection;
+    capture.extent = renderExtent;
+    capture.level = level;
+    capture.width = static_cast<uint32_t>(sourceSize.x);
+    capture.height = static_cast<uint32_t>(sourceSize.y);
+    capture.time = time;
+    capture.valid = sourceSize.x <= HIZ_READBACK_MAX && sourceSize.y <= HIZ_READBACK_MAX;
+}
+
+
+// Must be called once the slot's fence has signalled
+void HiZBuffer::collect(uint32_t frame)
+{
+    if (!supported || !captures[frame].valid)
+    {
+        return;
+    }
+
+    current = captures[frame];
+    captures[frame].valid = false;
+
+    buildDepthLevels(static_cast<const float*>(readbackMapped[frame]));
+}
+
+
+// Coarser levels are reduced on the CPU with the same rule as the shader, so large boxes
+// only ever touch a few texels
+void HiZBuffer::buildDepthLevels(const float* depths)
+{
+    depthLevels.resize(1);
+    depthLevels[0].width = current.width;
+    depthLevels[0].height = current.height;
+    depthLevels[0].depths.assign(depths, depths + current.width * current.height);
+
+    while (depthLevels.back().width > 1 || depthLevels.back().height > 1)
+    {
+        const DepthLevel source = depthLevels.back();
+
+        DepthLevel level;
+        level.width = std::max(source.width / 2, 1u);
+        level.height = std::max(source.height / 2, 1u);
+        level.depths.assign(level.width * level.height, 0.f);
+
+        for (uint32_t y = 0; y < source.height; y++)
+        {
+            uint32_t ty = std::min(y / 2, level.height - 1);
+
+            for (uint32_t x = 0; x < source.width; x++)
+            {
+                uint32_t tx = std::min(x / 2, level.width - 1);
+                float& depth = level.depths[ty * level.width + tx];
+                depth = std::max(depth, source.depths[y * source.width + x]);
+            }
+        }
+
+        depthLevels.push_back(std::move(level));
+    }
+}
+
+
+// Camera translation does not change what occludes what under the orthographic projection,
+// but occluders may have moved since the depth was drawn. Growing every box by the farthest
+// any of them could have travelled keeps the test conservative.
+void HiZBuffer::beginTests(float occluderSpeed, double time)
+{
+    stats = OcclusionStats{};
+    dilation = current.valid ? occluderSpeed * static_cast<float>(time - current.time) : 0.f;
+}
+
+
+bool HiZBuffer::isOccluded(const BoundingBox& box)
+{
+    if (!isActive())
+    {
+        return false;
+    }
+
+    stats.tested++;
+
+    glm::vec3 min = box.min - glm::vec3(dilation);
+    glm::vec3 max = box.max + glm::vec3(dilation);
+
+    float lowX = FLT_MAX, lowY = FLT_MAX;
+    float highX = -FLT_MAX, highY = -FLT_MAX;
+    float nearest = FLT_MAX;
+
+    for (uint32_t c = 0; c < 8; c++)
+    {
+        glm::vec3 corner((c & 1) ? max.x : min.x, (c & 2) ? max.y : min.y, (c & 4) ? max.z : min.z);
+        glm::vec4 clip = current.viewProjection * glm::vec4(corner, 1.f);
+
+        if (clip.w <= 0.f)
+        {
+            return false;
+        }
+
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+
+        lowX = std::min(lowX, ndc.x);
+        lowY = std::min(lowY, ndc.y);
+        highX = std::max(highX, ndc.x);
+        highY = std::max(highY, ndc.y);
+        nearest = std::min(nearest, ndc.z);
+    }
+
+    // anything reaching past the captured view may be visible through what the capture missed
+    if (nearest < 0.f || lowX < -1.f || lowY < -1.f || highX > 1.f || highY > 1.f)
+    {
+        return false;
+    }
+
+    // render pixels to readback texels, each of which covers 2^(level + 1) pixels
+    float texelsPerPixel = 1.f / static_cast<float>(2u << current.level);
+    float scaleX = 0.5f * current.extent.width * texelsPerPixel;
+    float scaleY = 0.5f * current.extent.height * texelsPerPixel;
+
+    glm::uvec2 first(static_cast<uint32_t>((lowX + 1.f) * scaleX), static_cast<uint32_t>((lowY + 1.f) * scaleY));
+    glm::uvec2 last(static_cast<uint32_t>((highX + 1.f) * scaleX), static_cast<uint32_t>((highY + 1.f) * scaleY));
+
+    size_t l = 0;
+
+    while (l + 1 < depthLevels.size() && ((last.x >> l) - (first.x >> l) >= HIZ_TEST_TEXELS || (last.y >> l) - (first.y >> l) >= HIZ_TEST_TEXELS))
+    {
+        l++;
+    }
+
+    const DepthLevel& level = depthLevels[l];
+
+    uint32_t x0 = std::min(first.x >> l, level.width - 1);
+    uint32_t x1 = std::min(last.x >> l, level.width - 1);
+    uint32_t y0 = std::min(first.y >> l, level.height - 1);
+    uint32_t y1 = std::min(last.y >> l, level.height - 1);
+
+    float farthest = 0.f;
+
+    for (uint32_t y = y0; y <= y1; y++)
+    {
+        for (uint32_t x = x0; x <= x1; x++)
+        {
+            farthest = std::max(farthest, level.depths[y * level.width + x]);
+        }
+    }
+
+    if (nearest > farthest)
+    {
+        stats.occluded++;
+        return true;
+    }
+
+    return false;
+}
+
+
+void HiZBuffer::setEnabled(const bool enable)
+{
+    enabled = enable;
+
+    // stale depth must not be tested against once recording resumes
+    if (!enabled)
+    {
+        current.valid = false;
+
+        for (HiZCapture& capture : captures)
+            capture.valid = false;
+    }
+}
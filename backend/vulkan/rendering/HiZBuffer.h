@@ -0,0 +1,114 @@
+#ifndef HIZBUFFER_H
+#define HIZBUFFER_H
+
+#include "VulkanUtils.h"
+#include "DeviceManager.h"
+#include "DeletionQueue.h"
+
+
+#define HIZ_SHADER "res/shaders/hiz.spv"
+
+// the pyramid is read back from the first level no larger than this in either dimension
+#define HIZ_READBACK_MAX 128
+
+// a tested box is compared against at most this many texels per axis
+#define HIZ_TEST_TEXELS 4
+
+
+struct OcclusionStats
+{
+    uint32_t tested = 0;
+    uint32_t occluded = 0;
+};
+
+
+// what one frame slot's readback describes
+struct HiZCapture
+{
+    glm::mat4 viewProjection;
+    VkExtent2D extent;          // render extent the depth was drawn at
+    uint32_t level;             // pyramid level that was copied
+    uint32_t width;
+    uint32_t height;
+    double time;
+    bool valid = false;
+};
+
+
+struct DepthLevel
+{
+    uint32_t width;
+    uint32_t height;
+    std::vector<float> depths;
+};
+
+
+/**
+ * @class HiZBuffer
+ * @brief Farthest-depth pyramid built from the scene depth buffer, read back for CPU occlusion tests.
+ *
+ * After the scene pass a compute shader reduces the multisampled depth into a mip chain. A small
+ * level is copied into a host-visible buffer per frame slot and collected once the slot's fence
+ * has signalled, so tests run against depth that is one frame in flight old. Boxes are projected
+ * with the matrix the depth was drawn with. Unsupported devices leave the buffer disabled and
+ * every test passes, a missing shader binary fails like any other pipeline.
+ */
+class HiZBuffer {
+private:
+    VkDevice device;
+    VkPhysicalDevice physicalDevice;
+
+    bool supported = false;
+    bool enabled = true;
+    uint32_t samples = 1;
+
+    VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkSampler sampler = VK_NULL_HANDLE;
+
+    // sized to the swap chain, rebuilt with the depth attachment
+    VkImage pyramidImage = VK_NULL_HANDLE;
+    VkDeviceMemory pyramidMemory = VK_NULL_HANDLE;
+    std::vector<VkImageView> levelViews;
+    VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSet> levelSets;
+    bool pyramidInitialized = false;
+
+    std::vector<VkBuffer> readbackBuffers;
+    std::vector<VkDeviceMemory> readbackMemory;
+    std::vector<void*> readbackMapped;
+    std::vector<HiZCapture> captures;
+
+    HiZCapture current;
+    std::vector<DepthLevel> depthLevels;
+    float dilation = 0.f;
+
+    OcclusionStats stats;
+
+public:
+    HiZBuffer();
+
+    void init(DeviceManager* d, VkFormat depthFormat, VkSampleCountFlagBits sampleCount, uint32_t frameCount);
+    void createResources(VkImageView depthImageView, VkExtent2D extent);
+    void retireResources(DeletionQueue& deletionQueue, uint64_t lastSubmission);
+    void destroy();
+
+    void record(VkCommandBuffer commandBuffer, uint32_t frame, VkExtent2D renderExtent, const glm::mat4& viewProjection, double time);
+    void collect(uint32_t frame);
+
+    void beginTests(float occluderSpeed, double time);
+    bool isOccluded(const BoundingBox& box);
+
+    void setEnabled(const bool enable);
+
+    const bool isSupported() const { return supported; }
+    const bool isEnabled() const { return supported && enabled; }
+    const bool isActive() const { return supported && enabled && current.valid; }
+    const OcclusionStats& getStats() const { return stats; }
+
+private:
+    void buildDepthLevels(const float* depths);
+};
+
+#endif
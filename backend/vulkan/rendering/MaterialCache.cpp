@@ -0,0 +1,295 @@
+#include "MaterialCache.h"
+#include <functional>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <cstddef>
+
+
+const uint64_t PipelineState::hash() const
+{
+    uint64_t h = std::hash<std::string>()(vertexShader);
+    h = h * 31 + std::hash<std::string>()(fragmentShader);
+    h = h * 31 + cullMode;
+    h = h * 31 + ((depthTest << 2) | (depthWrite << 1) | blend);
+    
+    return h;
+}
+
+
+const uint64_t ShaderVariant::key() const
+{
+    uint32_t timeBits;
+    std::memcpy(&timeBits, &timeOfDay, sizeof(timeBits));
+    
+    uint64_t h = maxTextures;
+    h = h * 31 + ditherSteps;
+    h = h * 31 + grain;
+    h = h * 31 + timeBits;
+    
+    return h;
+}
+
+
+// matches the layout of the constants in VkSpecializationMapEntry order
+struct SpecializationData
+{
+    int32_t maxTextures;
+    int32_t ditherSteps;
+    VkBool32 grain;
+    float timeOfDay;
+};
+
+
+MaterialCache::MaterialCache()
+{
+}
+
+
+void MaterialCache::init(VkDevice d, VkPipelineLayout layout, VkRenderPass rp, VkSampleCountFlagBits samples)
+{
+    device = d;
+    pipelineLayout = layout;
+    renderPass = rp;
+    msaaSamples = samples;
+}
+
+
+uint16_t MaterialCache::createMaterial(const MaterialPass pass, const PipelineState& state)
+{
+    Material material{};
+    material.pass = pass;
+    material.state = state;
+    
+    materials.push_back(material);
+    
+    return static_cast<uint16_t>(materials.size() - 1);
+}
+
+
+uint16_t MaterialCache::prepare(uint16_t materialId)
+{
+    Material& material = materials[materialId];
+    
+    if (material.pipelineId >= 0)
+    {
+        return static_cast<uint16_t>(material.pipelineId);
+    }
+    
+    uint64_t key = material.state.hash() * 31 + variant.key();
+    auto it = pipelineIndices.find(key);
+    
+    if (it == pipelineIndices.end())
+    {
+        pipelines.push_back(createPipeline(material.state));
+        it = pipelineIndices.emplace(key, static_cast<uint16_t>(pipelines.size() - 1)).first;
+    }
+    
+    material.pipelineId = it->second;
+    
+    return it->second;
+}
+
+
+// Materials resolve their pipeline again on their next prepare, pipelines already built for the
+// new variant are found in the cache.
+void MaterialCache::setVariant(const ShaderVariant& shaderVariant)
+{
+    if (shaderVariant.key() == variant.key())
+    {
+        return;
+    }
+    
+    variant = shaderVariant;
+    
+    for (Material& material : materials)
+    {
+        material.pipelineId = -1;
+    }
+}
+
+
+VkPipeline MaterialCache::createPipeline(const PipelineState& state)
+{
+    auto vertShaderCode = readFile(state.vertexShader);
+    auto fragShaderCode = readFile(state.fragmentShader);
+    
+    VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
+    VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
+    
+    
+    VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
+    vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+    vertShaderStageInfo.module = vertShaderModule;
+    vertShaderStageInfo.pName = "main";
+
+    VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
+    fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    fragShaderStageInfo.module = fragShaderModule;
+    fragShaderStageInfo.pName = "main";
+    
+    SpecializationData specializationData{};
+    specializationData.maxTextures = static_cast<int32_t>(std::max(variant.maxTextures, 1u));
+    specializationData.ditherSteps = static_cast<int32_t>(variant.ditherSteps);
+    specializationData.grain = variant.grain ? VK_TRUE : VK_FALSE;
+    specializationData.timeOfDay = variant.timeOfDay;
+    
+    std::array<VkSpecializationMapEntry, 4> specializationEntries{};
+    specializationEntries[0] = {SPEC_MAX_TEXTURES, offsetof(SpecializationData, maxTextures), sizeof(int32_t)};
+    specializationEntries[1] = {SPEC_DITHER_STEPS, offsetof(SpecializationData, ditherSteps), sizeof(int32_t)};
+    specializationEntries[2] = {SPEC_GRAIN, offsetof(SpecializationData, grain), sizeof(VkBool32)};
+    specializationEntries[3] = {SPEC_TIME_OF_DAY, offsetof(SpecializationData, timeOfDay), sizeof(float)};
+    
+    VkSpecializationInfo specializationInfo{};
+    specializationInfo.mapEntryCount = static_cast<uint32_t>(specializationEntries.size());
+    specializationInfo.pMapEntries = specializationEntries.data();
+    specializationInfo.dataSize = sizeof(specializationData);
+    specializationInfo.pData = &specializationData;
+    
+    fragShaderStageInfo.pSpecializationInfo = &specializationInfo;
+    
+
+    VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
+    
+    
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    
+    auto bindingDescription = Vertex::getBindingDescription();
+    auto attributeDescriptions = Vertex::getAttributeDescriptions();
+
+    vertexInputInfo.vertexBindingDescriptionCount = 1;
+    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
+    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+    
+    
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    inputAssembly.primitiveRestartEnable = VK_FALSE;
+    
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+    
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.depthClampEnable = VK_FALSE;
+    rasterizer.rasterizerDiscardEnable = VK_FALSE;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.cullMode = state.cullMode;
+    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    rasterizer.depthBiasEnable = VK_FALSE;
+    
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.sampleShadingEnable = VK_FALSE;
+    multisampling.rasterizationSamples = msaaSamples;
+    
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = state.depthTest ? VK_TRUE : VK_FALSE;
+    depthStencil.depthWriteEnable = state.depthWrite ? VK_TRUE : VK_FALSE;
+    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+    depthStencil.depthBoundsTestEnable = VK_FALSE;
+    depthStencil.stencilTestEnable = VK_FALSE;
+    
+    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachment.blendEnable = state.blend ? VK_TRUE : VK_FALSE;
+    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.logicOpEnable = VK_FALSE;
+    colorBlending.logicOp = VK_LOGIC_OP_COPY;
+    colorBlending.attachmentCount = 1;
+    colorBlending.pAttachments = &colorBlendAttachment;
+    colorBlending.blendConstants[0] = 0.0f;
+    colorBlending.blendConstants[1] = 0.0f;
+    colorBlending.blendConstants[2] = 0.0f;
+    colorBlending.blendConstants[3] = 0.0f;
+    
+    
+    std::vector<VkDynamicState> dynamicStates = {
+        VK_DYNAMIC_STATE_VIEWPORT,
+        VK_DYNAMIC_STATE_SCISSOR
+    };
+
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+    dynamicState.pDynamicStates = dynamicStates.data();
+    
+    
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages  = shaderStages;
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pDepthStencilState = &depthStencil;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = pipelineLayout;
+    pipelineInfo.renderPass = renderPass;
+    pipelineInfo.subpass = 0;
+    
+    VkPipeline pipeline;
+    if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create graphics pipeline!");
+    }
+    
+    
+    // cleanup
+    vkDestroyShaderModule(device, fragShaderModule, nullptr);
+    vkDestroyShaderModule(device, vertShaderModule, nullptr);
+    
+    return pipeline;
+}
+
+
+VkShaderModule MaterialCache::createShaderModule(const std::vector<char>& code)
+{
+    VkShaderModuleCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = code.size();
+    createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+    
+    VkShaderModule shaderModule;
+    if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create shader module!");
+    }
+    
+    return shaderModule;
+}
+
+
+void MaterialCache::destroy()
+{
+    for (VkPipeline pipeline : pipelines)
+    {
+        vkDestroyPipeline(device, pipeline, nullptr);
+    }
+    
+    pipelines.clear();
+    pipelineIndices.clear();
+    
+    for (Material& material : materials)
+    {
+        material.pipelineId = -1;
+    }
+}
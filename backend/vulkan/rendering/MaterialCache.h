@@ -0,0 +1,112 @@
+#ifndef MATERIALCACHE_H
+#define MATERIALCACHE_H
+
+#include "VulkanUtils.h"
+#include "IOUtils.h"
+#include <unordered_map>
+#include <string>
+
+
+// default materials, created in this order by RenderPipeline
+#define MATERIAL_OPAQUE 0
+#define MATERIAL_ALPHA_TESTED 1
+#define MATERIAL_HUD 2
+
+
+// fragment shader specialization constant ids, matching the constant_id layouts in the .frag sources
+#define SPEC_MAX_TEXTURES 0
+#define SPEC_DITHER_STEPS 1
+#define SPEC_GRAIN 2
+#define SPEC_TIME_OF_DAY 3
+
+
+// passes are drawn in this order
+enum MaterialPass
+{
+    MP_OPAQUE = 0,
+    MP_ALPHA_TESTED = 1,
+    MP_HUD = 2
+};
+
+
+struct PipelineState
+{
+    std::string vertexShader;
+    std::string fragmentShader;
+    
+    VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+    bool depthTest = true;
+    bool depthWrite = true;
+    bool blend = false;
+    
+    const uint64_t hash() const;
+};
+
+
+// Specialization shared by every material's fragment shader. Shaders that do not declare a
+// constant ignore it.
+struct ShaderVariant
+{
+    uint32_t maxTextures = 4;
+    uint32_t ditherSteps = 6;       // 0 disables dithering
+    bool grain = true;
+    float timeOfDay = 2.5f;         // negative follows the clock
+    
+    const uint64_t key() const;
+};
+
+
+struct Material
+{
+    MaterialPass pass;
+    PipelineState state;
+    
+    // resolved the first time the material is drawn under the current variant
+    int32_t pipelineId = -1;
+};
+
+
+/**
+ * @class MaterialCache
+ * @brief Owns all graphics pipelines, deduplicated by a hash of their fixed-function and shader state.
+ *
+ * Pipelines are only built when a material is first prepared for drawing, so shaders for
+ * materials nothing in the level uses are never loaded. Preparation must happen on the
+ * main thread, after that pipeline handles may be read from any recording thread.
+ * Switching the shader variant keeps the pipelines of earlier variants, so toggling back
+ * does not rebuild anything.
+ */
+class MaterialCache {
+private:
+    VkDevice device;
+    VkPipelineLayout pipelineLayout;
+    VkRenderPass renderPass;
+    VkSampleCountFlagBits msaaSamples;
+    ShaderVariant variant;
+    
+    std::vector<Material> materials;
+    std::vector<VkPipeline> pipelines;
+    std::unordered_map<uint64_t, uint16_t> pipelineIndices;
+    
+public:
+    MaterialCache();
+    
+    void init(VkDevice d, VkPipelineLayout layout, VkRenderPass rp, VkSampleCountFlagBits samples);
+    void destroy();
+    
+    uint16_t createMaterial(const MaterialPass pass, const PipelineState& state);
+    uint16_t prepare(uint16_t materialId);
+    
+    void setVariant(const ShaderVariant& shaderVariant);
+    const ShaderVariant& getVariant() const { return variant; }
+    
+    const Material& getMaterial(uint16_t materialId) const { return materials[materialId]; }
+    const VkPipeline getPipeline(uint16_t pipelineId) const { return pipelines[pipelineId]; }
+    const size_t getPipelineCount() const { return pipelines.size(); }
+    
+private:
+    VkPipeline createPipeline(const PipelineState& state);
+    VkShaderModule createShaderModule(const std::vector<char>& code);
+};
+
+#endif
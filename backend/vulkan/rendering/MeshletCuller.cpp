@@ -0,0 +1,105 @@
+#include "MeshletCuller.h"
+
+
+MeshletCuller::MeshletCuller()
+{
+}
+
+
+// Planes point inwards. Zero-to-one depth range, so the near plane is row 2 alone.
+std::array<glm::vec4, 6> MeshletCuller::extractPlanes(const glm::mat4& viewProjection)
+{
+    std::array<glm::vec4, 6> planes;
+    
+    glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+    glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+    glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+    glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+    
+    planes[0] = row3 + row0;
+    planes[1] = row3 - row0;
+    planes[2] = row3 + row1;
+    planes[3] = row3 - row1;
+    planes[4] = row2;
+    planes[5] = row3 - row2;
+    
+    for (glm::vec4& plane : planes)
+    {
+        plane /= glm::length(glm::vec3(plane));
+    }
+    
+    return planes;
+}
+
+
+void MeshletCuller::begin(const glm::mat4& viewProjection, const glm::vec3& direction)
+{
+    planes = extractPlanes(viewProjection);
+    viewDirection = direction;
+    stats = MeshletStats{};
+}
+
+
+// Appends the visible meshlets to ranges, merging neighbours that are contiguous in the index buffer.
+// Returns false if every meshlet was culled.
+bool MeshletCuller::cull(const std::vector<Meshlet>& meshlets, const glm::mat4& model, bool cullBackfaces, std::vector<IndexRange>& ranges)
+{
+    // plane(M * x) = (transpose(M) * plane)(x), still a world distance for any affine model
+    std::array<glm::vec4, 6> localPlanes;
+    std::array<float, 6> radiusScales;
+    
+    glm::mat4 planeTransform = glm::transpose(model);
+    
+    for (size_t p = 0; p < planes.size(); p++)
+    {
+        localPlanes[p] = planeTransform * planes[p];
+        radiusScales[p] = glm::length(glm::vec3(localPlanes[p]));
+    }
+    
+    // n' = inverse(transpose(M)) * n, so dot(n', d) has the sign of dot(n, inverse(M) * d)
+    glm::vec3 localDirection = glm::vec3(glm::inverse(model) * glm::vec4(viewDirection, 0.f));
+    float directionLength = glm::length(localDirection);
+    
+    if (directionLength > 0.f)
+        localDirection /= directionLength;
+    else
+        cullBackfaces = false;
+    
+    size_t firstRange = ranges.size();
+    
+    for (const Meshlet& meshlet : meshlets)
+    {
+        stats.tested++;
+        
+        bool outside = false;
+        
+        for (size_t p = 0; p < localPlanes.size() && !outside; p++)
+        {
+            outside = glm::dot(glm::vec3(localPlanes[p]), meshlet.center) + localPlanes[p].w < -meshlet.radius * radiusScales[p];
+        }
+        
+        if (outside)
+        {
+            stats.frustumCulled++;
+            continue;
+        }
+        
+        // every normal in the cone points away from the camera
+        if (cullBackfaces && glm::dot(meshlet.coneAxis, localDirection) > meshlet.coneCutoff)
+        {
+            stats.backfaceCulled++;
+            continue;
+        }
+        
+        if (ranges.size() > firstRange && ranges.back().firstIndex + ranges.back().indexCount == meshlet.indexOffset)
+        {
+            ranges.back().indexCount += meshlet.indexCount;
+        }
+        else
+        {
+            ranges.push_back({meshlet.indexOffset, meshlet.indexCount});
+        }
+    }
+    
+    return ranges.size() > firstRange;
+}
@@ -0,0 +1,42 @@
+#ifndef MESHLETCULLER_H
+#define MESHLETCULLER_H
+
+#include "VulkanUtils.h"
+#include "DrawList.h"
+#include <array>
+
+
+struct MeshletStats
+{
+    uint32_t tested = 0;
+    uint32_t frustumCulled = 0;
+    uint32_t backfaceCulled = 0;
+};
+
+
+/**
+ * @class MeshletCuller
+ * @brief CPU frustum and normal cone culling of meshlets, emitting the survivors as index ranges.
+ *
+ * Tests happen in the mesh's object space so a single transform per mesh is enough. The projection
+ * is orthographic, so the view direction is the same for every meshlet and the cones need no apex.
+ */
+class MeshletCuller {
+private:
+    std::array<glm::vec4, 6> planes;
+    glm::vec3 viewDirection;
+    
+    MeshletStats stats;
+    
+public:
+    MeshletCuller();
+    
+    void begin(const glm::mat4& viewProjection, const glm::vec3& direction);
+    bool cull(const std::vector<Meshlet>& meshlets, const glm::mat4& model, bool cullBackfaces, std::vector<IndexRange>& ranges);
+    
+    const MeshletStats& getStats() const { return stats; }
+    
+    static std::array<glm::vec4, 6> extractPlanes(const glm::mat4& viewProjection);
+};
+
+#endif
@@ -0,0 +1,851 @@
+#include "RenderGraph.h"
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+
+
+#define GRAPH_WRITE_ACCESS (VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT)
+
+
+struct AccessInfo
+{
+    VkImageLayout layout;
+    VkPipelineStageFlags stages;
+    VkAccessFlags access;
+    VkImageUsageFlags usage;
+    bool write;
+    bool attachment;
+};
+
+
+// where a resource stands between passes while barriers are planned
+struct ResourceState
+{
+    VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkPipelineStageFlags writeStages = 0;
+    VkAccessFlags writeAccess = 0;
+    VkPipelineStageFlags readStages = 0;
+    VkPipelineStageFlags visibleStages = 0;     // stages the last write has already been made visible to
+};
+
+
+static AccessInfo describeAccess(GraphAccess access)
+{
+    switch (access)
+    {
+        case GA_COLOR_ATTACHMENT:
+        case GA_RESOLVE_ATTACHMENT:
+            return {VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                    VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, true, true};
+
+        case GA_DEPTH_ATTACHMENT:
+            return {VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, true, true};
+
+        case GA_COMPUTE_READ:
+            return {VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                    VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_USAGE_SAMPLED_BIT, false, false};
+
+        case GA_TRANSFER_READ:
+            return {VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                    VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_USAGE_TRANSFER_SRC_BIT, false, false};
+
+        case GA_TRANSFER_WRITE:
+            return {VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                    VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_USAGE_TRANSFER_DST_BIT, true, false};
+    }
+
+    throw std::runtime_error("unknown render graph access!");
+}
+
+
+static bool isDepthFormat(VkFormat format)
+{
+    return format == VK_FORMAT_D16_UNORM || format == VK_FORMAT_D32_SFLOAT || hasStencilComponent(format);
+}
+
+
+RenderGraph::RenderGraph()
+{
+}
+
+
+void RenderGraph::init(DeviceManager* d)
+{
+    device = d->device;
+    physicalDevice = d->physicalDevice;
+}
+
+
+void RenderGraph::destroy()
+{
+    collectGarbage();
+    destroyGarbage(device, garbage);
+    garbage = GraphGarbage{};
+
+    for (const auto& [key, renderPass] : renderPassCache)
+    {
+        vkDestroyRenderPass(device, renderPass, nullptr);
+    }
+
+    renderPassCache.clear();
+}
+
+
+void RenderGraph::reset()
+{
+    collectGarbage();
+
+    resources.clear();
+    passes.clear();
+    blocks.clear();
+    finalBarrier = GraphBarrier{};
+    report = GraphMemoryReport{};
+}
+
+
+uint32_t RenderGraph::createImage(const std::string& name, const GraphImageDesc& desc)
+{
+    GraphResource resource;
+    resource.name = name;
+    resource.desc = desc;
+
+    resources.push_back(resource);
+    return static_cast<uint32_t>(resources.size() - 1);
+}
+
+
+uint32_t RenderGraph::importImage(const std::string& name, VkFormat format, VkImageLayout finalLayout, VkPipelineStageFlags availableStage)
+{
+    GraphResource resource;
+    resource.name = name;
+    resource.desc.format = format;
+    resource.imported = true;
+    resource.finalLayout = finalLayout;
+    resource.availableStage = availableStage;
+
+    resources.push_back(resource);
+    return static_cast<uint32_t>(resources.size() - 1);
+}
+
+
+uint32_t RenderGraph::addPass(const std::string& name, const std::function<void(VkCommandBuffer)>& record, bool sideEffect)
+{
+    GraphPass pass;
+    pass.name = name;
+    pass.record = record;
+    pass.sideEffect = sideEffect;
+
+    passes.push_back(pass);
+    return static_cast<uint32_t>(passes.size() - 1);
+}
+
+
+void RenderGraph::read(uint32_t pass, uint32_t resource, GraphAccess access)
+{
+    if (describeAccess(access).write)
+        throw std::runtime_error("render graph read declared with a write access!");
+
+    GraphUse use;
+    use.resource = resource;
+    use.access = access;
+
+    passes[pass].uses.push_back(use);
+}
+
+
+void RenderGraph::write(uint32_t pass, uint32_t resource, GraphAccess access, const VkClearValue* clear)
+{
+    if (!describeAccess(access).write)
+        throw std::runtime_error("render graph write declared with a read access!");
+
+    GraphUse use;
+    use.resource = resource;
+    use.access = access;
+    use.clear = clear != nullptr;
+
+    if (clear)
+    {
+        use.clearValue = *clear;
+    }
+
+    passes[pass].uses.push_back(use);
+}
+
+
+// Objects built by the previous compile may still be used by frames in flight
+void RenderGraph::compile(VkExtent2D imageExtent, DeletionQueue& deletionQueue, uint64_t lastSubmission)
+{
+    VkDevice d = device;
+    GraphGarbage stale = garbage;
+    garbage = GraphGarbage{};
+
+    deletionQueue.push(lastSubmission, [d, stale]()
+    {
+        destroyGarbage(d, stale);
+    });
+
+    extent = imageExtent;
+
+    cullPasses();
+    createImages();
+    createRenderPasses();
+    planBarriers();
+}
+
+
+// Walks the passes backwards from the ones with side effects or imported outputs. A pass survives
+// if something downstream consumes what it writes.
+void RenderGraph::cullPasses()
+{
+    std::vector<bool> written(resources.size(), false);
+
+    for (GraphPass& pass : passes)
+    {
+        for (GraphUse& use : pass.uses)
+        {
+            AccessInfo info = describeAccess(use.access);
+
+            if (!info.write && !written[use.resource] && !resources[use.resource].imported)
+                throw std::runtime_error("render graph pass '" + pass.name + "' reads '" + resources[use.resource].name + "' before it is written!");
+
+            if (info.write)
+            {
+                use.loads = info.attachment && !use.clear && written[use.resource];
+                written[use.resource] = true;
+            }
+        }
+    }
+
+    std::vector<bool> needed(resources.size(), false);
+
+    for (size_t p = passes.size(); p-- > 0;)
+    {
+        GraphPass& pass = passes[p];
+        bool live = pass.sideEffect;
+
+        for (const GraphUse& use : pass.uses)
+        {
+            if (describeAccess(use.access).write && (needed[use.resource] || resources[use.resource].imported))
+                live = true;
+        }
+
+        pass.culled = !live;
+
+        if (!live)
+        {
+            continue;
+        }
+
+        // a full overwrite ends the earlier contents' lifetime, reads and loads extend it
+        for (const GraphUse& use : pass.uses)
+        {
+            if (describeAccess(use.access).write && !use.loads)
+                needed[use.resource] = false;
+        }
+
+        for (const GraphUse& use : pass.uses)
+        {
+            if (!describeAccess(use.access).write || use.loads)
+                needed[use.resource] = true;
+        }
+    }
+}
+
+
+// Images used by a single pass purely as attachments never leave tile memory on tiled GPUs and
+// go into lazily allocated memory when there is any. The rest share blocks greedily, largest first,
+// with any block none of whose occupants is alive at the same time.
+void RenderGraph::createImages()
+{
+    for (size_t p = 0; p < passes.size(); p++)
+    {
+        if (passes[p].culled)
+            continue;
+
+        for (const GraphUse& use : passes[p].uses)
+        {
+            GraphResource& resource = resources[use.resource];
+
+            if (resource.firstPass < 0)
+                resource.firstPass = static_cast<int32_t>(p);
+
+            resource.lastPass = static_cast<int32_t>(p);
+            resource.usage |= describeAccess(use.access).usage;
+        }
+    }
+
+    std::vector<uint32_t> aliased;
+    std::vector<VkMemoryRequirements> requirements(resources.size());
+
+    for (uint32_t r = 0; r < resources.size(); r++)
+    {
+        GraphResource& resource = resources[r];
+
+        if (resource.imported || resource.firstPass < 0)
+            continue;
+
+        bool attachmentOnly = true;
+
+        for (const GraphPass& pass : passes)
+        {
+            for (const GraphUse& use : pass.uses)
+            {
+                if (!pass.culled && use.resource == r && !describeAccess(use.access).attachment)
+                    attachmentOnly = false;
+            }
+        }
+
+        bool transient = attachmentOnly && resource.firstPass == resource.lastPass;
+
+        resource.usage |= resource.desc.usage;
+
+        if (transient)
+        {
+            resource.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+        }
+
+        resource.aspect = isDepthFormat(resource.desc.format) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+
+        if (hasStencilComponent(resource.desc.format))
+        {
+            resource.aspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+        }
+
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent.width = extent.width;
+        imageInfo.extent.height = extent.height;
+        imageInfo.extent.depth = 1;
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = resource.desc.format;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = resource.usage;
+        imageInfo.samples = resource.desc.samples;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        if (vkCreateImage(device, &imageInfo, nullptr, &resource.image) != VK_SUCCESS)
+            throw std::runtime_error("failed to create render graph image!");
+
+        vkGetImageMemoryRequirements(device, resource.image, &requirements[r]);
+        resource.size = requirements[r].size;
+        report.requested += resource.size;
+
+        int32_t lazyType = transient ? findLazyMemoryType(requirements[r].memoryTypeBits) : -1;
+
+        if (lazyType >= 0)
+        {
+            VkMemoryAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+            allocInfo.allocationSize = resource.size;
+            allocInfo.memoryTypeIndex = static_cast<uint32_t>(lazyType);
+
+            GraphMemoryBlock block;
+            block.size = resource.size;
+            block.resources.push_back(r);
+
+            if (vkAllocateMemory(device, &allocInfo, nullptr, &block.memory) != VK_SUCCESS)
+                throw std::runtime_error("failed to allocate lazy render graph memory!");
+
+            resource.lazy = true;
+            resource.block = static_cast<int32_t>(blocks.size());
+            report.lazy += resource.size;
+
+            blocks.push_back(block);
+            continue;
+        }
+
+        aliased.push_back(r);
+    }
+
+    std::sort(aliased.begin(), aliased.end(), [&](uint32_t a, uint32_t b) { return resources[a].size > resources[b].size; });
+
+    size_t firstShared = blocks.size();
+
+    for (uint32_t r : aliased)
+    {
+        GraphResource& resource = resources[r];
+
+        for (size_t b = firstShared; b < blocks.size() && resource.block < 0; b++)
+        {
+            GraphMemoryBlock& block = blocks[b];
+
+            if (!(block.memoryTypeBits & requirements[r].memoryTypeBits))
+                continue;
+
+            bool overlaps = false;
+
+            for (uint32_t other : block.resources)
+            {
+                overlaps |= resources[other].firstPass <= resource.lastPass && resource.firstPass <= resources[other].lastPass;
+            }
+
+            if (!overlaps)
+            {
+                resource.block = static_cast<int32_t>(b);
+            }
+        }
+
+        if (resource.block < 0)
+        {
+            resource.block = static_cast<int32_t>(blocks.size());
+            blocks.push_back(GraphMemoryBlock{});
+        }
+
+        GraphMemoryBlock& block = blocks[resource.block];
+        block.size = std::max(block.size, resource.size);
+        block.alignment = std::max(block.alignment, requirements[r].alignment);
+        block.memoryTypeBits &= requirements[r].memoryTypeBits;
+        block.resources.push_back(r);
+    }
+
+    for (size_t b = firstShared; b < blocks.size(); b++)
+    {
+        GraphMemoryBlock& block = blocks[b];
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = block.size;
+        allocInfo.memoryTypeIndex = findMemoryType(physicalDevice, block.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        if (vkAllocateMemory(device, &allocInfo, nullptr, &block.memory) != VK_SUCCESS)
+            throw std::runtime_error("failed to allocate render graph memory!");
+
+        report.allocated += block.size;
+    }
+
+    for (GraphResource& resource : resources)
+    {
+        if (resource.block < 0)
+            continue;
+
+        // every occupant starts at offset 0, the block is as large and as aligned as its largest
+        vkBindImageMemory(device, resource.image, blocks[resource.block].memory, 0);
+        resource.view = createImageView(device, resource.image, resource.desc.format, 1, isDepthFormat(resource.desc.format) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT);
+    }
+}
+
+
+// Attachments keep the layout the graph transitioned them to, so the render passes themselves
+// need no layout changes or external dependencies
+void RenderGraph::createRenderPasses()
+{
+    for (size_t p = 0; p < passes.size(); p++)
+    {
+        GraphPass& pass = passes[p];
+
+        if (pass.culled)
+            continue;
+
+        std::vector<VkImageView> views;
+        pass.clearValues.clear();
+
+        for (const GraphUse& use : pass.uses)
+        {
+            if (describeAccess(use.access).attachment)
+            {
+                views.push_back(resources[use.resource].view);
+                pass.clearValues.push_back(use.clearValue);
+            }
+        }
+
+        if (views.empty())
+            continue;
+
+        pass.renderPass = getCachedRenderPass(pass, p);
+
+        VkFramebufferCreateInfo framebufferInfo{};
+        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferInfo.renderPass = pass.renderPass;
+        framebufferInfo.attachmentCount = static_cast<uint32_t>(views.size());
+        framebufferInfo.pAttachments = views.data();
+        framebufferInfo.width = extent.width;
+        framebufferInfo.height = extent.height;
+        framebufferInfo.layers = 1;
+
+        if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &pass.framebuffer) != VK_SUCCESS)
+            throw std::runtime_error("failed to create render graph framebuffer!");
+    }
+}
+
+
+VkRenderPass RenderGraph::getCachedRenderPass(const GraphPass& pass, size_t passIndex)
+{
+    std::vector<VkAttachmentDescription> attachments;
+    std::vector<VkAttachmentReference> colorRefs;
+    std::vector<VkAttachmentReference> resolveRefs;
+    VkAttachmentReference depthRef{};
+    bool hasDepth = false;
+
+    uint64_t key = 14695981039346656037ull;
+
+    for (const GraphUse& use : pass.uses)
+    {
+        AccessInfo info = describeAccess(use.access);
+
+        if (!info.attachment)
+            continue;
+
+        const GraphResource& resource = resources[use.resource];
+
+        // stored only if a later pass reads or loads it
+        bool stored = resource.imported;
+
+        for (size_t later = passIndex + 1; later < passes.size(); later++)
+        {
+            for (const GraphUse& next : passes[later].uses)
+            {
+                if (!passes[later].culled && next.resource == use.resource && (!describeAccess(next.access).write || next.loads))
+                    stored = true;
+            }
+        }
+
+        VkAttachmentDescription attachment{};
+        attachment.format = resource.desc.format;
+        attachment.samples = resource.desc.samples;
+        attachment.loadOp = use.clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : (use.loads ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_DONT_CARE);
+        attachment.storeOp = stored ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachment.initialLayout = info.layout;
+        attachment.finalLayout = info.layout;
+
+        VkAttachmentReference reference{};
+        reference.attachment = static_cast<uint32_t>(attachments.size());
+        reference.layout = info.layout;
+
+        if (use.access == GA_COLOR_ATTACHMENT)
+            colorRefs.push_back(reference);
+        else if (use.access == GA_RESOLVE_ATTACHMENT)
+            resolveRefs.push_back(reference);
+        else
+        {
+            depthRef = reference;
+            hasDepth = true;
+        }
+
+        attachments.push_back(attachment);
+
+        for (uint64_t value : {static_cast<uint64_t>(use.access), static_cast<uint64_t>(attachment.format), static_cast<uint64_t>(attachment.samples),
+                               static_cast<uint64_t>(attachment.loadOp), static_cast<uint64_t>(attachment.storeOp)})
+        {
+            key = (key ^ value) * 1099511628211ull;
+        }
+    }
+
+    auto cached = renderPassCache.find(key);
+
+    if (cached != renderPassCache.end())
+    {
+        return cached->second;
+    }
+
+    if (!resolveRefs.empty() && resolveRefs.size() != colorRefs.size())
+        throw std::runtime_error("render graph pass '" + pass.name + "' must resolve every color attachment or none!");
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = static_cast<uint32_t>(colorRefs.size());
+    subpass.pColorAttachments = colorRefs.data();
+    subpass.pResolveAttachments = resolveRefs.empty() ? nullptr : resolveRefs.data();
+    subpass.pDepthStencilAttachment = hasDepth ? &depthRef : nullptr;
+
+    VkRenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+    renderPassInfo.pAttachments = attachments.data();
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+
+    VkRenderPass renderPass;
+    if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS)
+        throw std::runtime_error("failed to create render graph render pass!");
+
+    renderPassCache[key] = renderPass;
+    return renderPass;
+}
+
+
+// Simulates the frame twice. The first run finds the state every image is left in, the second
+// starts each transient image from the state its memory was left in by the previous frame,
+// including other images aliasing it, and records the barriers.
+void RenderGraph::planBarriers()
+{
+    std::vector<ResourceState> states(resources.size());
+
+    auto simulate = [&](bool emit)
+    {
+        for (GraphPass& pass : passes)
+        {
+            if (pass.culled)
+                continue;
+
+            GraphBarrier barrier;
+
+            for (const GraphUse& use : pass.uses)
+            {
+                AccessInfo info = describeAccess(use.access);
+                ResourceState& state = states[use.resource];
+
+                bool layoutChange = state.layout != info.layout;
+                bool unsynchronizedWrite = state.writeStages && (state.visibleStages & info.stages) != info.stages;
+                bool writeAfterRead = info.write && state.readStages;
+
+                if (layoutChange || unsynchronizedWrite || writeAfterRead)
+                {
+                    // layout transitions write the image, so they wait on earlier reads too
+                    barrier.srcStages |= state.writeStages | ((info.write || layoutChange) ? state.readStages : 0);
+                    barrier.dstStages |= info.stages;
+                    barrier.transitions.push_back({use.resource, state.layout, info.layout, state.writeAccess, info.access});
+
+                    state.visibleStages |= info.stages;
+                }
+
+                if (info.write)
+                {
+                    state = ResourceState{};
+                    state.layout = info.layout;
+                    state.writeStages = info.stages;
+                    state.writeAccess = info.access & GRAPH_WRITE_ACCESS;
+                }
+                else
+                {
+                    if (layoutChange)
+                        state.readStages = 0;
+
+                    state.layout = info.layout;
+                    state.readStages |= info.stages;
+                }
+            }
+
+            if (emit)
+            {
+                pass.barrier = barrier;
+            }
+        }
+    };
+
+    simulate(false);
+
+    std::vector<ResourceState> endStates = states;
+
+    for (size_t r = 0; r < resources.size(); r++)
+    {
+        const GraphResource& resource = resources[r];
+        states[r] = ResourceState{};
+
+        if (resource.imported)
+        {
+            states[r].readStages = resource.availableStage;
+            continue;
+        }
+
+        if (resource.block < 0)
+            continue;
+
+        // contents are discarded, only the previous users of the memory have to be waited on
+        for (uint32_t other : blocks[resource.block].resources)
+        {
+            states[r].writeStages |= endStates[other].writeStages;
+            states[r].writeAccess |= endStates[other].writeAccess;
+            states[r].readStages |= endStates[other].readStages;
+        }
+    }
+
+    simulate(true);
+
+    finalBarrier = GraphBarrier{};
+
+    for (size_t r = 0; r < resources.size(); r++)
+    {
+        const GraphResource& resource = resources[r];
+        const ResourceState& state = states[r];
+
+        if (resource.imported && resource.firstPass >= 0 && state.layout != resource.finalLayout)
+        {
+            finalBarrier.srcStages |= state.writeStages | state.readStages;
+            finalBarrier.dstStages |= VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+            finalBarrier.transitions.push_back({static_cast<uint32_t>(r), state.layout, resource.finalLayout, state.writeAccess, 0});
+        }
+    }
+
+    report.passes = static_cast<uint32_t>(passes.size());
+
+    for (const GraphPass& pass : passes)
+    {
+        report.culledPasses += pass.culled;
+        report.barriers += !pass.barrier.transitions.empty();
+        report.transitions += static_cast<uint32_t>(pass.barrier.transitions.size());
+    }
+
+    report.barriers += !finalBarrier.transitions.empty();
+    report.transitions += static_cast<uint32_t>(finalBarrier.transitions.size());
+}
+
+
+void RenderGraph::execute(VkCommandBuffer commandBuffer)
+{
+    auto recordBarrier = [&](const GraphBarrier& barrier)
+    {
+        if (barrier.transitions.empty())
+            return;
+
+        std::vector<VkImageMemoryBarrier> imageBarriers(barrier.transitions.size());
+
+        for (size_t i = 0; i < barrier.transitions.size(); i++)
+        {
+            const GraphTransition& transition = barrier.transitions[i];
+            const GraphResource& resource = resources[transition.resource];
+
+            VkImageMemoryBarrier& imageBarrier = imageBarriers[i];
+            imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            imageBarrier.srcAccessMask = transition.srcAccess;
+            imageBarrier.dstAccessMask = transition.dstAccess;
+            imageBarrier.oldLayout = transition.oldLayout;
+            imageBarrier.newLayout = transition.newLayout;
+            imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            imageBarrier.image = resource.image;
+            imageBarrier.subresourceRange = {resource.aspect, 0, 1, 0, 1};
+        }
+
+        vkCmdPipelineBarrier(commandBuffer,
+            barrier.srcStages ? barrier.srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+            barrier.dstStages ? barrier.dstStages : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+            0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+    };
+
+    for (const GraphPass& pass : passes)
+    {
+        if (pass.culled)
+            continue;
+
+        recordBarrier(pass.barrier);
+        pass.record(commandBuffer);
+    }
+
+    recordBarrier(finalBarrier);
+}
+
+
+void RenderGraph::setImportedImage(uint32_t resource, VkImage image)
+{
+    resources[resource].image = image;
+}
+
+
+void RenderGraph::beginRenderPass(VkCommandBuffer commandBuffer, uint32_t pass, VkExtent2D renderArea, VkSubpassContents contents)
+{
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = passes[pass].renderPass;
+    renderPassInfo.framebuffer = passes[pass].framebuffer;
+    renderPassInfo.renderArea.offset = {0, 0};
+    renderPassInfo.renderArea.extent = renderArea;
+    renderPassInfo.clearValueCount = static_cast<uint32_t>(passes[pass].clearValues.size());
+    renderPassInfo.pClearValues = passes[pass].clearValues.data();
+
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, contents);
+}
+
+
+void RenderGraph::printMemoryReport() const
+{
+    auto megabytes = [](VkDeviceSize bytes) { return bytes / (1024.0 * 1024.0); };
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "render graph: " << report.passes << " passes (" << report.culledPasses << " culled), "
+              << report.barriers << " barriers, " << report.transitions << " transitions" << std::endl;
+
+    for (const GraphPass& pass : passes)
+    {
+        std::cout << "  pass " << pass.name << (pass.culled ? " (culled)" : "") << std::endl;
+    }
+
+    for (const GraphResource& resource : resources)
+    {
+        if (resource.imported || resource.image == VK_NULL_HANDLE)
+            continue;
+
+        std::cout << "  image " << resource.name << ": " << megabytes(resource.size) << " MB, passes "
+                  << resource.firstPass << "-" << resource.lastPass
+                  << (resource.lazy ? ", lazily allocated" : ", block " + std::to_string(resource.block)) << std::endl;
+    }
+
+    VkDeviceSize aliasedRequest = report.requested - report.lazy;
+
+    std::cout << "  transient memory: " << megabytes(report.requested) << " MB requested, "
+              << megabytes(report.allocated) << " MB allocated, "
+              << megabytes(aliasedRequest - report.allocated) << " MB saved by aliasing, "
+              << megabytes(report.lazy) << " MB lazily allocated" << std::endl;
+}
+
+
+int32_t RenderGraph::findLazyMemoryType(uint32_t memoryTypeBits) const
+{
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
+    {
+        if ((memoryTypeBits & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT))
+            return static_cast<int32_t>(i);
+    }
+
+    return -1;
+}
+
+
+// Moves everything the current declaration compiled into the garbage list
+void RenderGraph::collectGarbage()
+{
+    for (GraphResource& resource : resources)
+    {
+        if (resource.imported)
+            continue;
+
+        if (resource.view != VK_NULL_HANDLE)
+            garbage.views.push_back(resource.view);
+
+        if (resource.image != VK_NULL_HANDLE)
+            garbage.images.push_back(resource.image);
+
+        resource.view = VK_NULL_HANDLE;
+        resource.image = VK_NULL_HANDLE;
+    }
+
+    for (GraphMemoryBlock& block : blocks)
+    {
+        if (block.memory != VK_NULL_HANDLE)
+            garbage.memory.push_back(block.memory);
+
+        block.memory = VK_NULL_HANDLE;
+    }
+
+    for (GraphPass& pass : passes)
+    {
+        if (pass.framebuffer != VK_NULL_HANDLE)
+            garbage.framebuffers.push_back(pass.framebuffer);
+
+        pass.framebuffer = VK_NULL_HANDLE;
+    }
+}
+
+
+void RenderGraph::destroyGarbage(VkDevice device, const GraphGarbage& garbage)
+{
+    for (VkFramebuffer framebuffer : garbage.framebuffers)
+        vkDestroyFramebuffer(device, framebuffer, nullptr);
+
+    for (VkImageView view : garbage.views)
+        vkDestroyImageView(device, view, nullptr);
+
+    for (VkImage image : garbage.images)
+        vkDestroyImage(device, image, nullptr);
+
+    for (VkDeviceMemory memory : garbage.memory)
+        vkFreeMemory(device, memory, nullptr);
+}
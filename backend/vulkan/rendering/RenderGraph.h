@@ -0,0 +1,205 @@
+#ifndef RENDERGRAPH_H
+#define RENDERGRAPH_H
+
+#include "VulkanUtils.h"
+#include "DeviceManager.h"
+#include "DeletionQueue.h"
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+
+// how a pass touches an image, which fixes its layout, pipeline stage and access mask
+enum GraphAccess
+{
+    GA_COLOR_ATTACHMENT = 0,
+    GA_DEPTH_ATTACHMENT = 1,
+    GA_RESOLVE_ATTACHMENT = 2,
+    GA_COMPUTE_READ = 3,
+    GA_TRANSFER_READ = 4,
+    GA_TRANSFER_WRITE = 5
+};
+
+
+struct GraphImageDesc
+{
+    VkFormat format;
+    VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+    VkImageUsageFlags usage = 0;    // on top of what the declared accesses need
+};
+
+
+struct GraphUse
+{
+    uint32_t resource;
+    GraphAccess access;
+    bool clear = false;
+    VkClearValue clearValue{};
+    bool loads = false;             // attachment write that keeps earlier contents
+};
+
+
+struct GraphTransition
+{
+    uint32_t resource;
+    VkImageLayout oldLayout;
+    VkImageLayout newLayout;
+    VkAccessFlags srcAccess;
+    VkAccessFlags dstAccess;
+};
+
+
+// one pipeline barrier, recorded ahead of a pass or after the last one
+struct GraphBarrier
+{
+    VkPipelineStageFlags srcStages = 0;
+    VkPipelineStageFlags dstStages = 0;
+    std::vector<GraphTransition> transitions;
+};
+
+
+struct GraphResource
+{
+    std::string name;
+    GraphImageDesc desc;
+
+    bool imported = false;
+    VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;     // imported images are left in this layout
+    VkPipelineStageFlags availableStage = 0;                    // and become usable at this stage
+
+    // compiled
+    VkImage image = VK_NULL_HANDLE;
+    VkImageView view = VK_NULL_HANDLE;
+    VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+    VkImageUsageFlags usage = 0;
+    VkDeviceSize size = 0;
+    int32_t firstPass = -1;
+    int32_t lastPass = -1;
+    int32_t block = -1;
+    bool lazy = false;
+};
+
+
+struct GraphPass
+{
+    std::string name;
+    std::function<void(VkCommandBuffer)> record;
+    std::vector<GraphUse> uses;
+    bool sideEffect = false;        // kept even if nothing reads what it writes
+
+    // compiled
+    bool culled = false;
+    GraphBarrier barrier;
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    VkFramebuffer framebuffer = VK_NULL_HANDLE;
+    std::vector<VkClearValue> clearValues;
+};
+
+
+// device memory shared by transient images whose lifetimes do not overlap
+struct GraphMemoryBlock
+{
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize size = 0;
+    VkDeviceSize alignment = 1;
+    uint32_t memoryTypeBits = ~0u;
+    std::vector<uint32_t> resources;
+};
+
+
+// compiled objects of an earlier declaration, destroyed once the frames using them have retired
+struct GraphGarbage
+{
+    std::vector<VkFramebuffer> framebuffers;
+    std::vector<VkImageView> views;
+    std::vector<VkImage> images;
+    std::vector<VkDeviceMemory> memory;
+};
+
+
+struct GraphMemoryReport
+{
+    uint32_t passes = 0;
+    uint32_t culledPasses = 0;
+    uint32_t barriers = 0;
+    uint32_t transitions = 0;
+    VkDeviceSize requested = 0;     // what one allocation per transient image would take
+    VkDeviceSize allocated = 0;     // what aliasing actually allocated
+    VkDeviceSize lazy = 0;          // backed by lazily allocated memory, possibly never committed
+};
+
+
+/**
+ * @class RenderGraph
+ * @brief Frame graph of passes that declare the images they read and write.
+ *
+ * Passes are declared in execution order. Compiling culls passes whose outputs nothing consumes,
+ * creates the transient images with exactly the usage their accesses need, lets images with
+ * disjoint lifetimes share memory, and plans the barriers and layout transitions between passes.
+ * Attachment accesses turn a pass into a render pass, built by the graph with load and store ops
+ * derived from the surrounding passes. Render passes are cached and outlive recompiles, so
+ * pipelines built against them stay valid. Transient images are reused by every frame in flight,
+ * the first barrier of a frame waits on the previous frame's last use.
+ */
+class RenderGraph {
+private:
+    VkDevice device;
+    VkPhysicalDevice physicalDevice;
+
+    std::vector<GraphResource> resources;
+    std::vector<GraphPass> passes;
+    std::vector<GraphMemoryBlock> blocks;
+    GraphBarrier finalBarrier;
+    VkExtent2D extent{};
+
+    std::unordered_map<uint64_t, VkRenderPass> renderPassCache;
+    GraphGarbage garbage;
+
+    GraphMemoryReport report;
+
+public:
+    RenderGraph();
+
+    void init(DeviceManager* d);
+    void destroy();
+
+    // drops every declaration, compiled objects stay alive until the next compile retires them
+    void reset();
+
+    uint32_t createImage(const std::string& name, const GraphImageDesc& desc);
+    uint32_t importImage(const std::string& name, VkFormat format, VkImageLayout finalLayout, VkPipelineStageFlags availableStage);
+
+    uint32_t addPass(const std::string& name, const std::function<void(VkCommandBuffer)>& record, bool sideEffect = false);
+    void read(uint32_t pass, uint32_t resource, GraphAccess access);
+    void write(uint32_t pass, uint32_t resource, GraphAccess access, const VkClearValue* clear = nullptr);
+
+    void compile(VkExtent2D imageExtent, DeletionQueue& deletionQueue, uint64_t lastSubmission);
+    void execute(VkCommandBuffer commandBuffer);
+
+    void setImportedImage(uint32_t resource, VkImage image);
+    void beginRenderPass(VkCommandBuffer commandBuffer, uint32_t pass, VkExtent2D renderArea, VkSubpassContents contents);
+
+    const VkImage getImage(uint32_t resource) const { return resources[resource].image; }
+    const VkImageView getImageView(uint32_t resource) const { return resources[resource].view; }
+    const VkRenderPass getRenderPass(uint32_t pass) const { return passes[pass].renderPass; }
+    const VkFramebuffer getFramebuffer(uint32_t pass) const { return passes[pass].framebuffer; }
+    const bool isCulled(uint32_t pass) const { return passes[pass].culled; }
+
+    const GraphMemoryReport& getMemoryReport() const { return report; }
+    void printMemoryReport() const;
+
+private:
+    void cullPasses();
+    void createImages();
+    void createRenderPasses();
+    void planBarriers();
+
+    VkRenderPass getCachedRenderPass(const GraphPass& pass, size_t passIndex);
+    int32_t findLazyMemoryType(uint32_t memoryTypeBits) const;
+    
+    void collectGarbage();
+    static void destroyGarbage(VkDevice device, const GraphGarbage& garbage);
+};
+
+#endif
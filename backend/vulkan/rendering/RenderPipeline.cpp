@@ -1,13 +1,24 @@
 #include "RenderPipeline.h"
-#include "VertexBuffer.h"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <chrono>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
 
 #define ORTHO_HEIGHT 5.f
+#define MIN_RENDER_SCALE 0.5f
+
+// a coarser LOD is used once its error projects below this many pixels, and only
+// dropped to when it is under the threshold by the hysteresis margin
+#define LOD_ERROR_PIXELS 1.f
+#define LOD_HYSTERESIS 0.25f
+
+// view depth mapped onto the sort key's depth bits, matches the projection's far plane
+#define DEPTH_SORT_RANGE 200.f
 
 
 RenderPipeline::RenderPipeline()
@@ -26,16 +37,31 @@ void RenderPipeline::init(DeviceManager* d, SwapChain* s, World* w)
     msaaSamples = VK_SAMPLE_COUNT_2_BIT;
 //    msaaSamples = getMaxUsableSampleCount();
     
-    createRenderPass();
-    createCommandPool();
+    // fixed for the lifetime of the pipeline, swap chain recreation may pick a different format
+    sceneFormat = swapChain->swapChainImageFormat;
+    frameSubmissions.resize(maxFramesInFlight, 0);
+    
+    framePacer.init(swapChain->window->desiredResolution.refreshRate);
+    
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(deviceManager->physicalDevice, sceneFormat, &formatProperties);
+    
+    if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_SRC_BIT))
+    {
+        throw std::runtime_error("scene image format does not support blitting!");
+    }
     
-    createColorResources();
-    createDepthResources();
+    // decides whether the Hi-Z pass is declared, which changes how the depth attachment is stored
+    hiZBuffer.init(deviceManager, findDepthFormat(deviceManager->physicalDevice), msaaSamples, maxFramesInFlight);
     
-    createFramebuffers();
+    renderGraph.init(deviceManager);
+    buildRenderGraph();
+    
+    createCommandPool();
     
     textureBuffer.init(deviceManager, commandPool, w);
-    vertexBuffer.init(deviceManager, commandPool, w);
+    geometryHeap.init(deviceManager);
+    staticBatcher.build(w->getWorldActors(), geometryHeap);
     
     createUniformBuffers();
     
@@ -48,24 +74,36 @@ void RenderPipeline::init(DeviceManager* d, SwapChain* s, World* w)
     createCommandBuffers();
     
     createSyncObjects();
+    
+    gpuTimer.init(deviceManager, maxFramesInFlight);
+    frameVariants.resize(maxFramesInFlight, 0);
+    framePixels.resize(maxFramesInFlight, 0);
+    
+    dynamicResolution.init(FRAME_DURATION.count() * 1000.0, MIN_RENDER_SCALE);
+    dynamicResolution.setEnabled(gpuTimer.isSupported());
+    
+    commandRecorder.init(deviceManager, maxFramesInFlight, std::max(std::thread::hardware_concurrency(), 2u) - 1);
+    
+    renderExtent = swapChain->swapChainExtent;
 }
 
 
 void RenderPipeline::createDescriptorSets()
 {
-    std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, descriptorSetLayout);
+    std::vector<VkDescriptorSetLayout> layouts(maxFramesInFlight, descriptorSetLayout);
     VkDescriptorSetAllocateInfo allocInfo{};
     
     allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
     allocInfo.descriptorPool = descriptorPool;
-    allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+    allocInfo.descriptorSetCount = maxFramesInFlight;
     allocInfo.pSetLayouts = layouts.data();
     
-    descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
+    descriptorSets.resize(maxFramesInFlight);
+    boundTextureViews.assign(maxFramesInFlight, textureBuffer.textureImageView);
     if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS)
         throw std::runtime_error("failed to allocate descriptor sets!");
     
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    for (size_t i = 0; i < maxFramesInFlight; i++)
     {
         VkDescriptorBufferInfo bufferInfo{};
         bufferInfo.buffer = uniformBuffers[i];
@@ -118,19 +156,19 @@ void RenderPipeline::createDescriptorPool()
     std::array<VkDescriptorPoolSize, 3> poolSizes{};
     
     poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSizes[0].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+    poolSizes[0].descriptorCount = maxFramesInFlight;
     
     poolSizes[1].type = VK_DESCRIPTOR_TYPE_SAMPLER;
-    poolSizes[1].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+    poolSizes[1].descriptorCount = maxFramesInFlight;
     
     poolSizes[2].type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-    poolSizes[2].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT * textureBuffer.loadedTextures);
+    poolSizes[2].descriptorCount = static_cast<uint32_t>(maxFramesInFlight * textureBuffer.loadedTextures);
 
     VkDescriptorPoolCreateInfo poolInfo{};
     poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
     poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
     poolInfo.pPoolSizes = poolSizes.data();
-    poolInfo.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+    poolInfo.maxSets = maxFramesInFlight;
 
     if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
         throw std::runtime_error("failed to create descriptor pool!");
@@ -184,13 +222,16 @@ void RenderPipeline::updateUniformBuffer(uint32_t currentImage)
 //        glm::vec3(0.0f, 1.0f, 0.0f)
 //    );
     
+    // interpolated to the late input sample, taken after acquire
+    glm::vec3 location = player->getRenderLocation(interpolation);
+    
     ubo.view = glm::lookAt(
-        world->getPlayerAsRef()->getWorldLocation() + player->calculateProjectionOffset(),
-        world->getPlayerAsRef()->getWorldLocation(),
+        location + player->calculateProjectionOffset(),
+        location,
         glm::vec3(0.0f, 1.0f, 0.0f)
     );
     
-    ubo.cameraPos = world->getPlayerAsRef()->getWorldLocation();
+    ubo.cameraPos = location;
         
 //    ubo.proj = glm::perspective(glm::radians(45.f), swapChain->swapChainExtent.width / (float)
 //                                                    swapChain->swapChainExtent.height, 0.02f, 200.f);
@@ -207,13 +248,16 @@ void RenderPipeline::updateUniformBuffer(uint32_t currentImage)
     
     ubo.proj[1][1] *= -1;
     
+    // orthographic, so projected size depends only on the zoom and not on distance
+    lodPixelsPerUnit = renderExtent.height / (2.f * ORTHO_HEIGHT);
+    
     player->setProjectionMatrix(ubo.proj);
     player->setViewMatrix(ubo.view);
     
     ubo.time = glfwGetTime();
     
-    ubo.screenResolution.x = swapChain->window->desiredResolution.width;
-    ubo.screenResolution.y = swapChain->window->desiredResolution.height;
+    ubo.screenResolution.x = renderExtent.width;
+    ubo.screenResolution.y = renderExtent.height;
 
     memcpy(uniformBuffersMapped[currentImage], &ubo, sizeof(ubo));
 }
@@ -223,11 +267,11 @@ void RenderPipeline::createUniformBuffers()
 {
     VkDeviceSize bufferSize = sizeof(UniformBufferObject);
 
-    uniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-    uniformBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
-    uniformBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
+    uniformBuffers.resize(maxFramesInFlight);
+    uniformBuffersMemory.resize(maxFramesInFlight);
+    uniformBuffersMapped.resize(maxFramesInFlight);
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    for (size_t i = 0; i < maxFramesInFlight; i++)
     {
         createBuffer(device, deviceManager->physicalDevice, bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffers[i], uniformBuffersMemory[i]);
 
@@ -238,9 +282,9 @@ void RenderPipeline::createUniformBuffers()
 
 void RenderPipeline::createSyncObjects()
 {
-    imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+    imageAvailableSemaphores.resize(maxFramesInFlight);
+    renderFinishedSemaphores.resize(maxFramesInFlight);
+    inFlightFences.resize(maxFramesInFlight);
     
     VkSemaphoreCreateInfo semaphoreInfo{};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -249,7 +293,7 @@ void RenderPipeline::createSyncObjects()
     fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
     fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
     
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    for (size_t i = 0; i < maxFramesInFlight; i++)
     {
         if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
             vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS ||
@@ -262,26 +306,44 @@ void RenderPipeline::createSyncObjects()
 }
 
 
-void RenderPipeline::drawFrame()
+// Waits for the frame slot, then paces the CPU according to the latency mode. Called before
+// the simulation update so everything after it works on input sampled as late as possible.
+void RenderPipeline::beginFrame()
 {
     vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
     
+    framePacer.frameReady();
+    deletionQueue.retire(frameSubmissions[currentFrame]);
+    
+    double gpuFrameTime;
+    if (gpuTimer.collect(currentFrame, gpuFrameTime))
+    {
+        dynamicResolution.update(gpuFrameTime);
+        framePacer.setGpuTime(gpuFrameTime);
+        
+        // attributed to the variant the slot's last frame was recorded with
+        VariantTiming& timing = variantTimings[frameVariants[currentFrame]];
+        timing.frames++;
+        timing.milliseconds += gpuFrameTime;
+        timing.pixels += framePixels[currentFrame];
+    }
+    
+    hiZBuffer.collect(currentFrame);
+    
+    renderExtent = dynamicResolution.scaleExtent(swapChain->swapChainExtent);
+    
+    framePacer.pace();
+}
+
+
+void RenderPipeline::drawFrame()
+{
     uint32_t imageIndex;
     VkResult result = vkAcquireNextImageKHR(device, swapChain->swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
     
     if (result == VK_ERROR_OUT_OF_DATE_KHR)
     {
-        destroyColorResources();
-        destroyDepthBuffer();
-        
-        swapChain->reconstructChain();
-        swapChain->createSwapChain();
-        swapChain->createImageViews();
-        
-        createColorResources();
-        createDepthResources();
-        
-        createFramebuffers();
+        recreateSwapChain();
         return;
     }
     else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
@@ -293,6 +355,12 @@ void RenderPipeline::drawFrame()
     // Only reset the fence if we are submitting work
     vkResetFences(device, 1, &inFlightFences[currentFrame]);
     
+    // acquire may have blocked on presentation, resample before the camera is built. Latency is
+    // still counted from the sample the simulation ran on.
+    swapChain->window->sampleLateInput();
+    framePacer.markInputSampled(swapChain->window->inputSampleTime);
+    interpolation = swapChain->window->getInterpolation();
+    
     updateUniformBuffer(currentFrame);
     
     vkResetCommandBuffer(commandBuffers[currentFrame], 0);
@@ -304,7 +372,8 @@ void RenderPipeline::drawFrame()
     
 
     VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
-    VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+    // the swap chain image is first touched by the upscale blit
+    VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_TRANSFER_BIT};
     submitInfo.waitSemaphoreCount = 1;
     submitInfo.pWaitSemaphores = waitSemaphores;
     submitInfo.pWaitDstStageMask = waitStages;
@@ -319,6 +388,9 @@ void RenderPipeline::drawFrame()
     if (vkQueueSubmit(deviceManager->graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS)
         throw std::runtime_error("failed to submit draw command buffer!");
     
+    frameSubmissions[currentFrame] = ++submissionCount;
+    framePacer.markSubmitted();
+    
     VkPresentInfoKHR presentInfo{};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
@@ -332,34 +404,63 @@ void RenderPipeline::drawFrame()
     
     presentInfo.pResults = nullptr;
     result = vkQueuePresentKHR(deviceManager->presentQueue, &presentInfo);
+    framePacer.markPresented();
     
-    if (result == VK_ERROR_OUT_OF_DATE_KHR || framebufferResized)
+    if (result == VK_ERROR_OUT_OF_DATE_KHR || framebufferResized || presentModeChanged)
     {
         framebufferResized = false;
-        
-        destroyColorResources();
-        destroyDepthBuffer();
-        
-        swapChain->reconstructChain();
-        swapChain->createSwapChain();
-        swapChain->createImageViews();
-        
-        createColorResources();
-        createDepthResources();
-        
-        createFramebuffers();
+        presentModeChanged = false;
+        recreateSwapChain();
     }
     else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
     {
         throw std::runtime_error("failed to present swap chain image!");
     }
     
-    currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+    currentFrame = (currentFrame + 1) % framesInFlight;
+}
+
+
+// Replaces the swap chain without draining the device. Graph images are sized to the swap chain extent
+// and kept in the format chosen at startup (the upscale blit converts), so they only change with the extent.
+void RenderPipeline::recreateSwapChain()
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    VkExtent2D previousExtent = swapChain->swapChainExtent;
+    
+    VkSwapchainKHR retiredSwapChain;
+    std::vector<VkImageView> retiredImageViews;
+    swapChain->reconstructChain(retiredSwapChain, retiredImageViews);
+    
+    VkDevice d = device;
+    deletionQueue.push(submissionCount, [d, retiredSwapChain, retiredImageViews]()
+    {
+        for (VkImageView imageView : retiredImageViews)
+            vkDestroyImageView(d, imageView, nullptr);
+        
+        vkDestroySwapchainKHR(d, retiredSwapChain, nullptr);
+    });
+    
+    if (previousExtent.width != swapChain->swapChainExtent.width || previousExtent.height != swapChain->swapChainExtent.height)
+    {
+        graphDirty = true;
+    }
+    
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+    recreateCount++;
+    lastRecreateTime = elapsed.count();
+    worstRecreateTime = std::max(worstRecreateTime, lastRecreateTime);
 }
 
 
 void RenderPipeline::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex)
 {
+    if (graphDirty)
+    {
+        buildRenderGraph();
+    }
+    
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 
@@ -367,56 +468,249 @@ void RenderPipeline::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t
     {
         throw std::runtime_error("failed to begin recording command buffer!");
     }
+    
+    gpuTimer.begin(commandBuffer, currentFrame);
+    frameVariants[currentFrame] = materialCache.getVariant().key();
+    framePixels[currentFrame] = renderExtent.width * renderExtent.height;
+    
+    syncGeometry();
+    partitionDraws();
+    
+    // copies have to be recorded outside the render pass. If the heap grew, the cached
+    // secondaries still bind the old buffers.
+    if (geometryHeap.recordUploads(commandBuffer, deletionQueue, submissionCount + 1))
+    {
+        invalidateStaticCache();
+    }
+    
+    textureBuffer.recordStreaming(commandBuffer, deletionQueue, submissionCount + 1);
+    syncTextureDescriptors();
+    
+    renderGraph.setImportedImage(swapChainTarget, swapChain->swapChainImages[imageIndex]);
+    renderGraph.execute(commandBuffer);
+    
+    gpuTimer.end(commandBuffer, currentFrame);
+
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to record command buffer!");
+    }
+}
 
-    VkRenderPassBeginInfo renderPassInfo{};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassInfo.renderPass = renderPass;
-    renderPassInfo.framebuffer = swapChain->swapChainFramebuffers[imageIndex];
-    renderPassInfo.renderArea.offset = {0, 0};
-    renderPassInfo.renderArea.extent = swapChain->swapChainExtent;
 
-    std::array<VkClearValue, 2> clearValues{};
-    clearValues[0].color = {{0.0f, 0.0f, 0.0f, 1.0f}};
-    clearValues[1].depthStencil = {1.0f, 0};
+// Declares the frame's passes and compiles them into images, render passes and barriers. Runs at
+// startup, when the swap chain extent changes and when occlusion culling is toggled.
+void RenderPipeline::buildRenderGraph()
+{
+    VkFormat depthFormat = findDepthFormat(deviceManager->physicalDevice);
+    
+    renderGraph.reset();
+    
+    sceneColor = renderGraph.createImage("scene color", {sceneFormat, msaaSamples});
+    sceneDepth = renderGraph.createImage("scene depth", {depthFormat, msaaSamples});
+    sceneResolve = renderGraph.createImage("scene resolve", {sceneFormat, VK_SAMPLE_COUNT_1_BIT});
+    
+    // the acquire semaphore is waited on at the transfer stage
+    swapChainTarget = renderGraph.importImage("swap chain", swapChain->swapChainImageFormat, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    
+    VkClearValue colorClear{};
+    colorClear.color = {{0.0f, 0.0f, 0.0f, 1.0f}};
+    
+    VkClearValue depthClear{};
+    depthClear.depthStencil = {1.0f, 0};
+    
+    scenePass = renderGraph.addPass("scene", [this](VkCommandBuffer commandBuffer) { recordScene(commandBuffer); });
+    renderGraph.write(scenePass, sceneColor, GA_COLOR_ATTACHMENT, &colorClear);
+    renderGraph.write(scenePass, sceneDepth, GA_DEPTH_ATTACHMENT, &depthClear);
+    renderGraph.write(scenePass, sceneResolve, GA_RESOLVE_ATTACHMENT);
+    
+    // its only output is the readback, so with occlusion culling off nothing keeps it alive and
+    // the depth attachment is no longer stored
+    uint32_t hiZPass = renderGraph.addPass("hi-z", [this](VkCommandBuffer commandBuffer)
+    {
+        hiZBuffer.record(commandBuffer, currentFrame, renderExtent, player->getProjectionMatrix() * player->getViewMatrix(), glfwGetTime());
+    }, hiZBuffer.isEnabled());
+    renderGraph.read(hiZPass, sceneDepth, GA_COMPUTE_READ);
+    
+    uint32_t upscalePass = renderGraph.addPass("upscale", [this](VkCommandBuffer commandBuffer) { recordUpscale(commandBuffer); });
+    renderGraph.read(upscalePass, sceneResolve, GA_TRANSFER_READ);
+    renderGraph.write(upscalePass, swapChainTarget, GA_TRANSFER_WRITE);
+    
+    renderGraph.compile(swapChain->swapChainExtent, deletionQueue, submissionCount);
+    
+    hiZBuffer.retireResources(deletionQueue, submissionCount);
+    
+    if (!renderGraph.isCulled(hiZPass))
+    {
+        hiZBuffer.createResources(renderGraph.getImageView(sceneDepth), swapChain->swapChainExtent);
+    }
+    
+    graphDirty = false;
+    
+    // cached secondaries reference the old framebuffer
+    invalidateStaticCache();
+}
 
-    renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-    renderPassInfo.pClearValues = clearValues.data();
 
-    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+void RenderPipeline::recordScene(VkCommandBuffer commandBuffer)
+{
+    if (renderExtent.width != staticExtent.width || renderExtent.height != staticExtent.height)
+    {
+        invalidateStaticCache();
+    }
+    
+    bool useStaticCache = !staticDraws.empty();
+    frameStats = useStaticCache ? staticStats : DrawStats{};
     
-    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+    if (useStaticCache || commandRecorder.shouldSplit(dynamicDraws.size()))
+    {
+        renderGraph.beginRenderPass(commandBuffer, scenePass, renderExtent, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+        
+        VkCommandBufferInheritanceInfo inheritanceInfo{};
+        inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritanceInfo.renderPass = renderGraph.getRenderPass(scenePass);
+        inheritanceInfo.subpass = 0;
+        inheritanceInfo.framebuffer = renderGraph.getFramebuffer(scenePass);
+        
+        frameSecondaries.clear();
+        
+        if (useStaticCache)
+        {
+            if (!staticCacheValid[currentFrame])
+            {
+                recordStaticCache(inheritanceInfo);
+                frameStats = staticStats;
+            }
+            
+            frameSecondaries.push_back(staticCommandBuffers[currentFrame]);
+        }
+        
+        if (!dynamicDraws.empty())
+        {
+            const auto& secondaries = commandRecorder.record(currentFrame, inheritanceInfo, dynamicDraws.size(),
+                [this](VkCommandBuffer secondary, size_t first, size_t last)
+                {
+                    DrawStats stats;
+                    
+                    // dynamic state and bindings are not inherited by secondary buffers
+                    bindSceneState(secondary);
+                    recordDraws(secondary, dynamicDraws, first, last, stats);
+                    
+                    std::lock_guard<std::mutex> lock(statsMutex);
+                    frameStats += stats;
+                });
+            
+            frameSecondaries.insert(frameSecondaries.end(), secondaries.begin(), secondaries.end());
+        }
+        
+        vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(frameSecondaries.size()), frameSecondaries.data());
+    }
+    else
+    {
+        renderGraph.beginRenderPass(commandBuffer, scenePass, renderExtent, VK_SUBPASS_CONTENTS_INLINE);
+        
+        bindSceneState(commandBuffer);
+        recordDraws(commandBuffer, dynamicDraws, 0, dynamicDraws.size(), frameStats);
+    }
+    
+    lastFrameStats = frameStats;
+    
+    vkCmdEndRenderPass(commandBuffer);
+}
 
+
+// Everything shared by all draws. Pipelines are bound by recordDraws as the sorted list crosses
+// pipeline boundaries, and all meshes live in the geometry heap addressed by draw offsets.
+void RenderPipeline::bindSceneState(VkCommandBuffer commandBuffer)
+{
     VkViewport viewport{};
     viewport.x = 0.0f;
     viewport.y = 0.0f;
-    viewport.width = (float) swapChain->swapChainExtent.width;
-    viewport.height = (float) swapChain->swapChainExtent.height;
+    viewport.width = (float) renderExtent.width;
+    viewport.height = (float) renderExtent.height;
     viewport.minDepth = 0.0f;
     viewport.maxDepth = 1.0f;
     vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 
     VkRect2D scissor{};
     scissor.offset = {0, 0};
-    scissor.extent = swapChain->swapChainExtent;
+    scissor.extent = renderExtent;
     vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
     
-    
     vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[currentFrame], 0, nullptr);
     
-    
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &geometryHeap.vertexBuffer, &offset);
+    vkCmdBindIndexBuffer(commandBuffer, geometryHeap.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+}
+
+
+// may run on a recording worker, so only reads shared state
+void RenderPipeline::recordDraws(VkCommandBuffer commandBuffer, const DrawList& draws, size_t first, size_t last, DrawStats& stats)
+{
     PushConstants push;
     const auto& actors = world->getWorldActors();
+    
+    int32_t boundPipeline = -1;
+    uint64_t lastTexture = UINT64_MAX;
+    uint64_t lastMesh = UINT64_MAX;
 
-    for (size_t i = 0; i < actors.size(); i++)
+    for (size_t d = first; d < last; d++)
     {
-        const Actor& a = *actors[i];
+        const DrawCommand& draw = draws[d];
         
-        if (a.getCulled())
+        if (draw.pipelineId != boundPipeline)
         {
-            continue;
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, materialCache.getPipeline(draw.pipelineId));
+            boundPipeline = draw.pipelineId;
+            stats.pipelineBinds++;
+        }
+        
+        uint64_t texture = (draw.key >> DRAW_KEY_TEXTURE_SHIFT) & 0x3FF;
+        if (texture != lastTexture)
+        {
+            lastTexture = texture;
+            stats.textureChanges++;
+        }
+        
+        uint64_t mesh = (draw.key >> DRAW_KEY_MESH_SHIFT) & 0xFFFF;
+        if (mesh != lastMesh)
+        {
+            lastMesh = mesh;
+            stats.meshChanges++;
         }
         
-        push.modelMatrix = a.getModelMatrix();
+        uint32_t indexCount;
+        uint32_t firstIndex;
+        int32_t vertexOffset;
+        
+        if (draw.actorIndex & DRAW_BATCH_BIT)
+        {
+            // batches are already in world space
+            const MeshAllocation& allocation = geometryHeap.getMesh(staticBatcher.getBatch(draw.actorIndex & ~DRAW_BATCH_BIT).meshId);
+            
+            push.modelMatrix = glm::mat4(1.f);
+            indexCount = allocation.indexCount;
+            firstIndex = allocation.indexOffset;
+            vertexOffset = static_cast<int32_t>(allocation.vertexOffset);
+        }
+        else
+        {
+            const Actor* a = actors[draw.actorIndex];
+            const MeshAllocation& allocation = geometryHeap.getMesh(static_cast<uint32_t>(a->getMeshId()));
+            const std::vector<MeshLod>& lods = a->getObject().lods;
+            
+            push.modelMatrix = renderMatrices[draw.actorIndex];
+            indexCount = allocation.indexCount;
+            firstIndex = allocation.indexOffset;
+            vertexOffset = static_cast<int32_t>(allocation.vertexOffset);
+            
+            if (a->getLod() < lods.size())
+            {
+                indexCount = lods[a->getLod()].indexCount;
+                firstIndex += lods[a->getLod()].indexOffset;
+            }
+        }
         
         vkCmdPushConstants(
             commandBuffer,
@@ -427,335 +721,807 @@ void RenderPipeline::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t
             &push
         );
         
-        VkDeviceSize vertexOffsetInBytes = vertexBuffer.vertexOffsets[i] * sizeof(Vertex);
-        VkDeviceSize indexOffsetInBytes = vertexBuffer.indexOffsets[i] * sizeof(uint32_t);
+        if (draw.rangeCount == 0)
+        {
+            vkCmdDrawIndexed(commandBuffer, indexCount, 1, firstIndex, vertexOffset, 0);
+            stats.draws++;
+            continue;
+        }
+        
+        // surviving meshlets, already merged where they were adjacent
+        for (uint32_t r = draw.firstRange; r < draw.firstRange + draw.rangeCount; r++)
+        {
+            const IndexRange& range = draws.getRange(r);
+            
+            vkCmdDrawIndexed(commandBuffer, range.indexCount, 1, firstIndex + range.firstIndex, vertexOffset, 0);
+            stats.draws++;
+        }
+    }
+}
 
-        vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer.vertexBuffer, &vertexOffsetInBytes);
-        vkCmdBindIndexBuffer(commandBuffer, vertexBuffer.indexBuffer, indexOffsetInBytes, VK_INDEX_TYPE_UINT32);
 
-        vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(a.getObject().indices.size()), 1, 0, 0, 0);
+// The ortho projection gives every actor the same pixels per unit, only its scale and its
+// mesh's texture density change the level it needs.
+void RenderPipeline::requestTexture(const Actor* a)
+{
+    const Object& obj = a->getObject();
+    
+    if (obj.vertices.empty() || obj.uvDensity <= 0.f)
+    {
+        return;
     }
     
-    vkCmdEndRenderPass(commandBuffer);
+    glm::vec3 scale = a->getWorldScale();
+    float pixelsPerUnit = lodPixelsPerUnit * std::max(scale.x, std::max(scale.y, scale.z));
+    
+    textureBuffer.request(obj.vertices[0].texIndex, obj.uvDensity / pixelsPerUnit);
+}
 
-    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+
+// Streamed textures swap their views. Each slot's set is rewritten before the slot records
+// again, which also invalidates the cached secondaries that bound it.
+void RenderPipeline::syncTextureDescriptors()
+{
+    std::vector<VkImageView>& bound = boundTextureViews[currentFrame];
+    std::vector<VkDescriptorImageInfo> imageInfos;
+    std::vector<VkWriteDescriptorSet> descriptorWrites;
+    
+    imageInfos.reserve(textureBuffer.loadedTextures);
+    
+    for (size_t j = 0; j < textureBuffer.loadedTextures; j++)
     {
-        throw std::runtime_error("failed to record command buffer!");
+        if (bound[j] == textureBuffer.textureImageView[j])
+        {
+            continue;
+        }
+        
+        bound[j] = textureBuffer.textureImageView[j];
+        
+        VkDescriptorImageInfo imageInfo{};
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        imageInfo.imageView = bound[j];
+        imageInfo.sampler = VK_NULL_HANDLE;
+        imageInfos.push_back(imageInfo);
+        
+        VkWriteDescriptorSet descriptorWrite{};
+        descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrite.dstSet = descriptorSets[currentFrame];
+        descriptorWrite.dstBinding = 2;
+        descriptorWrite.dstArrayElement = static_cast<uint32_t>(j);
+        descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        descriptorWrite.descriptorCount = 1;
+        descriptorWrite.pImageInfo = &imageInfos.back();
+        descriptorWrites.push_back(descriptorWrite);
     }
+    
+    if (descriptorWrites.empty())
+    {
+        return;
+    }
+    
+    vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+    staticCacheValid[currentFrame] = false;
 }
 
 
-void RenderPipeline::createCommandBuffers()
+// Must run on the main thread, preparing a material may build its pipeline
+void RenderPipeline::addDraw(DrawList& draws, size_t actorIndex)
 {
-    commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    if (occludedActors[actorIndex])
+    {
+        return;
+    }
     
-    VkCommandBufferAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.commandPool = commandPool;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandBufferCount = (uint32_t) commandBuffers.size();
+    const Actor* a = world->getWorldActors()[actorIndex];
+    
+    uint16_t materialId = a->getMaterial();
+    uint16_t pipelineId = materialCache.prepare(materialId);
+    const Material& material = materialCache.getMaterial(materialId);
+    
+    const Object& obj = a->getObject();
+    uint16_t texture = obj.vertices.empty() ? 0 : obj.vertices[0].texIndex;
+    
+    const glm::mat4& model = renderMatrices[actorIndex];
+    
+    glm::vec4 viewPosition = player->getViewMatrix() * model[3];
+    float depth = -viewPosition.z / DEPTH_SORT_RANGE;
+    
+    // blended passes draw back-to-front
+    if (material.state.blend)
+    {
+        depth = 1.f - depth;
+    }
+    
+    std::vector<IndexRange>& ranges = draws.getRanges();
+    uint32_t firstRange = static_cast<uint32_t>(ranges.size());
+    
+    // meshlets only describe the base level
+    if (a->getLod() == 0 && !cullMeshlets(obj.meshlets, model, materialId, ranges))
+    {
+        return;
+    }
+    
+    // keyed on the loaded object rather than the actor, so actors sharing a mesh sort next to each other
+    draws.add(DrawList::makeKey(material.pass, pipelineId, texture, static_cast<uint16_t>(obj.id), depth),
+              static_cast<uint32_t>(actorIndex), pipelineId, firstRange, static_cast<uint32_t>(ranges.size()) - firstRange);
+}
 
-    if (vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data()) != VK_SUCCESS)
-        throw std::runtime_error("failed to allocate command buffers!");
 
+void RenderPipeline::addBatchDraw(DrawList& draws, size_t batchIndex)
+{
+    if (occludedBatches[batchIndex])
+    {
+        return;
+    }
+    
+    const StaticBatch& batch = staticBatcher.getBatch(batchIndex);
+    
+    uint16_t pipelineId = materialCache.prepare(batch.material);
+    const Material& material = materialCache.getMaterial(batch.material);
+    
+    glm::vec3 center = (batch.bounds.min + batch.bounds.max) * 0.5f;
+    glm::vec4 viewPosition = player->getViewMatrix() * glm::vec4(center, 1.f);
+    
+    // mesh ids above the actor range keep batches grouped after individual meshes
+    uint16_t mesh = static_cast<uint16_t>(0xFFFF - batchIndex);
+    
+    std::vector<IndexRange>& ranges = draws.getRanges();
+    uint32_t firstRange = static_cast<uint32_t>(ranges.size());
+    
+    if (!cullMeshlets(batch.meshlets, glm::mat4(1.f), batch.material, ranges))
+    {
+        return;
+    }
+    
+    draws.add(DrawList::makeKey(material.pass, pipelineId, batch.texture, mesh, -viewPosition.z / DEPTH_SORT_RANGE),
+              static_cast<uint32_t>(batchIndex) | DRAW_BATCH_BIT, pipelineId, firstRange, static_cast<uint32_t>(ranges.size()) - firstRange);
 }
 
 
-void RenderPipeline::createCommandPool()
+// Brings the heap in line with the world. New actors share the mesh of their object, uploading it if
+// they are the first to use it. A mesh no actor uses any more and dropped batches are given back once
+// the submission being recorded now has retired.
+void RenderPipeline::syncGeometry()
 {
-    QueueFamilyIndices queueFamilyIndices = deviceManager->findQueueFamilies(deviceManager->physicalDevice);
-
-    VkCommandPoolCreateInfo poolInfo{};
-    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-    poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
+    std::vector<uint32_t> despawnedMeshes;
     
-    if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
-        throw std::runtime_error("failed to create command pool!");
+    for (const DespawnedActor& despawned : world->takeDespawnedActors())
+    {
+        staticBatcher.forget(despawned.actor);
+        
+        if (despawned.meshId < 0)
+            continue;
+        
+        uint32_t meshId = static_cast<uint32_t>(despawned.meshId);
+        SharedMesh& shared = sharedMeshes.at(meshId);
+        
+        if (--shared.users == 0)
+        {
+            objectMeshes.erase(shared.objectId);
+            sharedMeshes.erase(meshId);
+            despawnedMeshes.push_back(meshId);
+        }
+    }
     
+    std::vector<uint32_t> released = staticBatcher.takeReleasedMeshes();
+    released.insert(released.end(), despawnedMeshes.begin(), despawnedMeshes.end());
     
+    if (!released.empty())
+    {
+        GeometryHeap* heap = &geometryHeap;
+        deletionQueue.push(submissionCount + 1, [heap, released]()
+        {
+            for (uint32_t meshId : released)
+            {
+                heap->release(meshId);
+            }
+        });
+    }
+    
+    for (Actor* a : world->getWorldActors())
+    {
+        if (a->getMeshId() < 0)
+        {
+            const Object& obj = a->getObject();
+            auto mesh = objectMeshes.find(obj.id);
+            
+            if (mesh == objectMeshes.end())
+            {
+                // every LOD indexes the same vertices, so they live in one allocation after the base indices
+                std::vector<uint32_t> indices = obj.indices;
+                indices.insert(indices.end(), obj.lodIndices.begin(), obj.lodIndices.end());
+                
+                mesh = objectMeshes.emplace(obj.id, geometryHeap.upload(obj.vertices, indices)).first;
+                sharedMeshes[mesh->second].objectId = obj.id;
+            }
+            
+            sharedMeshes[mesh->second].users++;
+            a->setMeshId(static_cast<int32_t>(mesh->second));
+        }
+    }
 }
 
 
-void RenderPipeline::createRenderPass()
+// Moves one level at a time from the actor's current LOD. Refining happens as soon as the current
+// level's error is visible, coarsening only once the next level is comfortably below the threshold,
+// so actors near the boundary do not flip every frame while the zoom settles.
+uint8_t RenderPipeline::selectLod(const Actor* a) const
 {
-    VkAttachmentDescription colorAttachment{};
-    colorAttachment.format = swapChain->swapChainImageFormat;
-    colorAttachment.samples = msaaSamples;
-    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    const std::vector<MeshLod>& lods = a->getObject().lods;
     
-    VkAttachmentDescription colorAttachmentResolve{};
-    colorAttachmentResolve.format = swapChain->swapChainImageFormat;
-    colorAttachmentResolve.samples = VK_SAMPLE_COUNT_1_BIT;
-    colorAttachmentResolve.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    colorAttachmentResolve.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    colorAttachmentResolve.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    colorAttachmentResolve.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    colorAttachmentResolve.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachmentResolve.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    if (lods.size() < 2)
+    {
+        return 0;
+    }
     
-    VkAttachmentDescription depthAttachment{};
-    depthAttachment.format = findDepthFormat(deviceManager->physicalDevice);
-    depthAttachment.samples = msaaSamples;
-    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    glm::vec3 scale = a->getWorldScale();
+    float pixelsPerUnit = lodPixelsPerUnit * std::max(scale.x, std::max(scale.y, scale.z));
     
-    VkAttachmentReference colorAttachmentRef{};
-    colorAttachmentRef.attachment = 0;
-    colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    size_t lod = std::min<size_t>(a->getLod(), lods.size() - 1);
     
-    VkAttachmentReference colorAttachmentResolveRef{};
-    colorAttachmentResolveRef.attachment = 2;
-    colorAttachmentResolveRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    while (lod > 0 && lods[lod].error * pixelsPerUnit > LOD_ERROR_PIXELS)
+    {
+        lod--;
+    }
     
-    VkAttachmentReference depthAttachmentRef{};
-    depthAttachmentRef.attachment = 1;
-    depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    while (lod + 1 < lods.size() && lods[lod + 1].error * pixelsPerUnit <= LOD_ERROR_PIXELS * (1.f - LOD_HYSTERESIS))
+    {
+        lod++;
+    }
     
-    VkSubpassDescription subpass{};
-    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpass.colorAttachmentCount = 1;
-    subpass.pColorAttachments = &colorAttachmentRef;
-    subpass.pResolveAttachments = &colorAttachmentResolveRef;
-    subpass.pDepthStencilAttachment = &depthAttachmentRef;
+    return static_cast<uint8_t>(lod);
+}
+
+
+// Meshes made of a single meshlet are left to whole-object culling. Returns false when nothing survives.
+bool RenderPipeline::cullMeshlets(const std::vector<Meshlet>& meshlets, const glm::mat4& model, uint16_t materialId, std::vector<IndexRange>& ranges)
+{
+    if (meshlets.size() < 2)
+    {
+        return true;
+    }
     
-    VkSubpassDependency dependency{};
-    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependency.dstSubpass = 0;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    bool cullBackfaces = materialCache.getMaterial(materialId).state.cullMode & VK_CULL_MODE_BACK_BIT;
     
-    std::array<VkAttachmentDescription, 3> attachments = {colorAttachment, depthAttachment, colorAttachmentResolve};
-    VkRenderPassCreateInfo renderPassInfo{};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-    renderPassInfo.pAttachments = attachments.data();
-    renderPassInfo.subpassCount = 1;
-    renderPassInfo.pSubpasses = &subpass;
-    renderPassInfo.dependencyCount = 1;
-    renderPassInfo.pDependencies = &dependency;
+    return meshletCuller.cull(meshlets, model, cullBackfaces, ranges);
+}
+
 
-    if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS)
+uint64_t RenderPipeline::hashRanges(uint64_t hash, const std::vector<IndexRange>& ranges)
+{
+    hash = (hash ^ ranges.size()) * 1099511628211ull;
+    
+    for (const IndexRange& range : ranges)
     {
-        throw std::runtime_error("failed to create render pass!");
+        hash = (hash ^ ((static_cast<uint64_t>(range.firstIndex) << 32) | range.indexCount)) * 1099511628211ull;
     }
+    
+    return hash;
 }
 
 
-void RenderPipeline::createRenderPipeline()
+// The meshlet ranges every unbatched static actor at full detail and every visible batch would draw from this view
+uint64_t RenderPipeline::hashStaticMeshlets()
 {
-    auto vertShaderCode = readFile("res/shaders/vert.spv");
-    auto fragShaderCode = readFile("res/shaders/frag.spv");
+    const auto& actors = world->getWorldActors();
+    uint64_t hash = 0;
     
-    VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-    VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
+    for (size_t i : staticMeshletActors)
+    {
+        const Actor* a = actors[i];
+        
+        scratchRanges.clear();
+        cullMeshlets(a->getObject().meshlets, a->getModelMatrix(), a->getMaterial(), scratchRanges);
+        hash = hashRanges(hash, scratchRanges);
+    }
     
+    for (const StaticBatch& batch : staticBatcher.getBatches())
+    {
+        if (batch.valid && batch.visible)
+        {
+            scratchRanges.clear();
+            cullMeshlets(batch.meshlets, glm::mat4(1.f), batch.material, scratchRanges);
+            hash = hashRanges(hash, scratchRanges);
+        }
+    }
     
-    VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
-    vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-    vertShaderStageInfo.module = vertShaderModule;
-    vertShaderStageInfo.pName = "main";
+    return hash;
+}
 
-    VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
-    fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    fragShaderStageInfo.module = fragShaderModule;
-    fragShaderStageInfo.pName = "main";
-    
 
-    VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
+// Tests actors and visible batches against last frame's depth. Occlusion decides which static draws
+// exist, so results for static actors and batches are folded into the static signature.
+uint64_t RenderPipeline::testOcclusion(uint64_t signature)
+{
+    const auto& actors = world->getWorldActors();
+    const auto& batches = staticBatcher.getBatches();
     
+    occludedActors.assign(actors.size(), false);
+    occludedBatches.assign(batches.size(), false);
     
-    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    // anything that wrote depth may have moved since, whether physics, attachment or gameplay moved it
+    double time = glfwGetTime();
+    double elapsed = time - occluderSampleTime;
+    float occluderSpeed = 0.f;
     
-    auto bindingDescription = Vertex::getBindingDescription();
-    auto attributeDescriptions = Vertex::getAttributeDescriptions();
-
-    vertexInputInfo.vertexBindingDescriptionCount = 1;
-    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+    std::unordered_map<const Actor*, glm::vec3> locations;
+    locations.reserve(actors.size());
     
+    for (const Actor* a : actors)
+    {
+        if (!materialCache.getMaterial(a->getMaterial()).state.depthWrite)
+            continue;
+        
+        glm::vec3 location = a->getWorldLocation();
+        auto previous = occluderLocations.find(a);
+        
+        if (previous != occluderLocations.end() && elapsed > 0.0)
+            occluderSpeed = std::max(occluderSpeed, glm::length(location - previous->second) / static_cast<float>(elapsed));
+        
+        locations.emplace(a, location);
+    }
     
-    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
-    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-    inputAssembly.primitiveRestartEnable = VK_FALSE;
+    occluderLocations = std::move(locations);
+    occluderSampleTime = time;
     
-    VkPipelineViewportStateCreateInfo viewportState{};
-    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-    viewportState.viewportCount = 1;
-    viewportState.scissorCount = 1;
+    hiZBuffer.beginTests(occluderSpeed, time);
     
-    VkPipelineRasterizationStateCreateInfo rasterizer{};
-    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-    rasterizer.depthClampEnable = VK_FALSE;
-    rasterizer.rasterizerDiscardEnable = VK_FALSE;
-    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-    rasterizer.lineWidth = 1.0f;
-    rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-    rasterizer.depthBiasEnable = VK_FALSE;
+    if (!hiZBuffer.isActive())
+    {
+        return signature;
+    }
     
-    VkPipelineMultisampleStateCreateInfo multisampling{};
-    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    multisampling.sampleShadingEnable = VK_FALSE;
-    multisampling.rasterizationSamples = msaaSamples;
+    for (size_t i = 0; i < actors.size(); i++)
+    {
+        const Actor* a = actors[i];
+        const Material& material = materialCache.getMaterial(a->getMaterial());
+        
+        // overlays draw over everything and are never hidden
+        if (a->getCulled() || staticBatcher.isBatched(a) || !material.state.depthTest)
+        {
+            continue;
+        }
+        
+        occludedActors[i] = hiZBuffer.isOccluded(a->getBoundingBox());
+        
+        if (occludedActors[i] && !a->getPhysicsEnabled() && material.pass == MaterialPass::MP_OPAQUE)
+        {
+            signature = (signature ^ i) * 1099511628211ull;
+        }
+    }
     
-    VkPipelineDepthStencilStateCreateInfo depthStencil{};
-    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-    depthStencil.depthTestEnable = VK_TRUE;
-    depthStencil.depthWriteEnable = VK_TRUE;
-    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
-    depthStencil.depthBoundsTestEnable = VK_FALSE;
-    depthStencil.stencilTestEnable = VK_FALSE;
+    for (size_t b = 0; b < batches.size(); b++)
+    {
+        if (batches[b].valid && batches[b].visible && hiZBuffer.isOccluded(batches[b].bounds))
+        {
+            occludedBatches[b] = true;
+            signature = (signature ^ (b | DRAW_BATCH_BIT)) * 1099511628211ull;
+        }
+    }
     
-    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    colorBlendAttachment.blendEnable = VK_FALSE;
+    return signature;
+}
+
 
-    VkPipelineColorBlendStateCreateInfo colorBlending{};
-    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-    colorBlending.logicOpEnable = VK_FALSE;
-    colorBlending.logicOp = VK_LOGIC_OP_COPY;
-    colorBlending.attachmentCount = 1;
-    colorBlending.pAttachments = &colorBlendAttachment;
-    colorBlending.blendConstants[0] = 0.0f;
-    colorBlending.blendConstants[1] = 0.0f;
-    colorBlending.blendConstants[2] = 0.0f;
-    colorBlending.blendConstants[3] = 0.0f;
+void RenderPipeline::setOcclusionCulling(const bool enabled)
+{
+    hiZBuffer.setEnabled(enabled);
     
+    // the hi-z pass is culled from the graph while occlusion is off
+    graphDirty = true;
+}
+
+
+// Pipelines for the new variant are built as materials are next drawn. The texture count is
+// fixed by the descriptor layout and is kept.
+void RenderPipeline::setShaderVariant(const ShaderVariant& variant)
+{
+    ShaderVariant specialized = variant;
+    specialized.maxTextures = materialCache.getVariant().maxTextures;
     
-    std::vector<VkDynamicState> dynamicStates = {
-        VK_DYNAMIC_STATE_VIEWPORT,
-        VK_DYNAMIC_STATE_SCISSOR
-    };
+    materialCache.setVariant(specialized);
+}
+
 
-    VkPipelineDynamicStateCreateInfo dynamicState{};
-    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-    dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
-    dynamicState.pDynamicStates = dynamicStates.data();
+void RenderPipeline::printVariantTimings() const
+{
+    std::cout << std::fixed << std::setprecision(3);
     
-    VkPushConstantRange pushConstantRange = {};
-    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-    pushConstantRange.offset = 0;
-    pushConstantRange.size = sizeof(PushConstants);
+    for (const auto& [key, timing] : variantTimings)
+    {
+        if (timing.frames == 0)
+        {
+            continue;
+        }
+        
+        std::cout << "shader variant " << std::hex << key << std::dec << ": " << timing.frames << " frames, "
+                  << timing.milliseconds / timing.frames << " ms, "
+                  << timing.milliseconds * 1e6 / timing.pixels << " ns per pixel" << std::endl;
+    }
+}
 
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = 1;
-    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+
+// Splits visible actors into per-frame dynamic draws and the cached static set. Static actors only
+// contribute their index and render version to a signature, so an unchanged level costs no recording.
+// The static set is opaque only, since it is executed ahead of every dynamic pass.
+void RenderPipeline::partitionDraws()
+{
+    const auto& actors = world->getWorldActors();
+    StaticBatcher& batcher = staticBatcher;
     
-    pipelineLayoutInfo.pushConstantRangeCount = 1;
-    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+    batcher.validate();
     
-    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+    glm::mat4 viewProjection = player->getProjectionMatrix() * player->getViewMatrix();
+    meshletCuller.begin(viewProjection, -glm::normalize(player->calculateProjectionOffset()));
+    
+    // the visible batch set is part of the static signature, so the cache only re-records when a cell enters or leaves view
+    uint64_t signature = actors.size() ^ batcher.cull(viewProjection);
+    signature = testOcclusion(signature);
+    
+    // the static draws hold pipeline ids of the variant they were built with
+    signature = signature * 31 + materialCache.getVariant().key();
+    
+    dynamicDraws.clear();
+    staticMeshletActors.clear();
+    renderMatrices.resize(actors.size());
+    
+    for (size_t i = 0; i < actors.size(); i++)
     {
-        throw std::runtime_error("failed to create pipeline layout!");
+        Actor* a = actors[i];
+        
+        // resolves a dirty matrix here, on the main thread, recording threads only read it
+        a->getModelMatrix();
+        
+        if (!batcher.isBatched(a))
+        {
+            a->setLod(selectLod(a));
+        }
+        
+        if (!a->getCulled())
+        {
+            requestTexture(a);
+        }
+        
+        bool opaque = materialCache.getMaterial(a->getMaterial()).pass == MaterialPass::MP_OPAQUE;
+        bool dynamic = a->getPhysicsEnabled() || !opaque;
+        
+        // static draws are replayed from the cache until something changes, so they are never blended
+        renderMatrices[i] = dynamic ? a->getRenderMatrix(interpolation) : a->getModelMatrix();
+        
+        if (dynamic)
+        {
+            if (!a->getCulled())
+            {
+                addDraw(dynamicDraws, i);
+            }
+            continue;
+        }
+        
+        signature = (signature ^ ((static_cast<uint64_t>(i) << 32) | a->getRenderVersion())) * 1099511628211ull;
+        signature = (signature ^ a->getLod()) * 1099511628211ull;
+        
+        if (!batcher.isBatched(a) && !a->getCulled() && a->getLod() == 0)
+        {
+            staticMeshletActors.push_back(i);
+        }
     }
     
+    dynamicDraws.sort();
+    
+    // the visible static meshlets decide the static draws too, but only change with the view, so
+    // static geometry is culled again only when the view or the rest of the signature changed
+    if (signature == staticSignature && viewProjection == staticView)
+    {
+        return;
+    }
+    
+    uint64_t meshletHash = hashStaticMeshlets();
+    staticView = viewProjection;
+    
+    if (signature == staticSignature && meshletHash == staticMeshletHash)
+    {
+        return;
+    }
+    
+    staticSignature = signature;
+    staticMeshletHash = meshletHash;
+    staticDraws.clear();
+    
+    for (size_t i = 0; i < actors.size(); i++)
+    {
+        const Actor* a = actors[i];
+        
+        if (batcher.isBatched(a))
+        {
+            continue;
+        }
+        
+        if (!a->getPhysicsEnabled() && !a->getCulled() && materialCache.getMaterial(a->getMaterial()).pass == MaterialPass::MP_OPAQUE)
+        {
+            addDraw(staticDraws, i);
+        }
+    }
+    
+    for (size_t b = 0; b < batcher.getBatches().size(); b++)
+    {
+        const StaticBatch& batch = batcher.getBatch(b);
+        
+        if (batch.valid && batch.visible)
+        {
+            addBatchDraw(staticDraws, b);
+        }
+    }
+    
+    // depth order is from the camera at rebuild time, it only affects early-Z efficiency
+    staticDraws.sort();
+    
+    invalidateStaticCache();
+}
+
+
+void RenderPipeline::recordStaticCache(const VkCommandBufferInheritanceInfo& inheritanceInfo)
+{
+    VkCommandBuffer commandBuffer = staticCommandBuffers[currentFrame];
+    
+    // safe to reset, this frame slot's fence has already been waited on
+    vkResetCommandBuffer(commandBuffer, 0);
     
-    VkGraphicsPipelineCreateInfo pipelineInfo{};
-    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipelineInfo.stageCount = 2;
-    pipelineInfo.pStages  = shaderStages;
-    pipelineInfo.pVertexInputState = &vertexInputInfo;
-    pipelineInfo.pInputAssemblyState = &inputAssembly;
-    pipelineInfo.pViewportState = &viewportState;
-    pipelineInfo.pRasterizationState = &rasterizer;
-    pipelineInfo.pMultisampleState = &multisampling;
-    pipelineInfo.pDepthStencilState = &depthStencil;
-    pipelineInfo.pColorBlendState = &colorBlending;
-    pipelineInfo.pDynamicState = &dynamicState;
-    pipelineInfo.layout = pipelineLayout;
-    pipelineInfo.renderPass = renderPass;
-    pipelineInfo.subpass = 0;
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
     
-    if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create graphics pipeline!");
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to begin recording static command buffer!");
     }
     
+    staticStats = DrawStats{};
+    
+    bindSceneState(commandBuffer);
+    recordDraws(commandBuffer, staticDraws, 0, staticDraws.size(), staticStats);
     
-    // cleanup
-    vkDestroyShaderModule(device, fragShaderModule, nullptr);
-    vkDestroyShaderModule(device, vertShaderModule, nullptr);
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to record static command buffer!");
+    }
+    
+    staticCacheValid[currentFrame] = true;
+    staticExtent = renderExtent;
+    staticCacheRebuilds++;
+}
+
+
+void RenderPipeline::invalidateStaticCache()
+{
+    std::fill(staticCacheValid.begin(), staticCacheValid.end(), false);
 }
 
 
-VkShaderModule RenderPipeline::createShaderModule(const std::vector<char>& code)
+void RenderPipeline::setLatencyMode(const LatencyMode mode)
 {
-    VkShaderModuleCreateInfo createInfo{};
-    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = code.size();
-    createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+    framePacer.setMode(mode);
     
-    VkShaderModule shaderModule;
-    if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create shader module!");
+    const LatencySettings& settings = framePacer.getSettings();
+    
+    if (swapChain->preferredPresentMode != settings.presentMode)
+    {
+        swapChain->preferredPresentMode = settings.presentMode;
+        presentModeChanged = true;
+    }
+}
+
+
+// Frame slot resources are allocated once, for maxFramesInFlight, this only limits how many are cycled.
+// Slots dropped from the rotation keep their fence and retire through the deletion queue as usual.
+void RenderPipeline::setFramesInFlight(uint32_t count)
+{
+    if (count == 0 || count > maxFramesInFlight)
+    {
+        throw std::runtime_error("failed to set frames in flight, it must be from 1 to the allocated frame slots!");
     }
     
-    return shaderModule;
+    framesInFlight = count;
+    currentFrame %= framesInFlight;
+    framePacer.resetLatencyStats();
 }
 
 
-void RenderPipeline::createFramebuffers()
+// sizes every per-frame resource, so it can only change before init
+void RenderPipeline::setMaxFramesInFlight(uint32_t count)
 {
-    auto viewSize = swapChain->swapChainImageViews.size();
-    swapChain->swapChainFramebuffers.resize(viewSize);
+    if (!inFlightFences.empty())
+    {
+        throw std::runtime_error("failed to set max frames in flight, the frame slots are already allocated!");
+    }
     
-    for (size_t i = 0; i < viewSize; i++)
+    if (count == 0)
     {
-        std::array<VkImageView, 3> attachments = {
-            colorImageView,
-            depthImageView,
-            swapChain->swapChainImageViews[i]
-        };
+        throw std::runtime_error("failed to set max frames in flight, at least one frame slot is needed!");
+    }
+    
+    maxFramesInFlight = count;
+    framesInFlight = std::min(framesInFlight, count);
+}
 
-        VkFramebufferCreateInfo framebufferInfo{};
-        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-        framebufferInfo.renderPass = renderPass;
-        framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-        framebufferInfo.pAttachments = attachments.data();
-        framebufferInfo.width = swapChain->swapChainExtent.width;
-        framebufferInfo.height = swapChain->swapChainExtent.height;
-        framebufferInfo.layers = 1;
 
-        if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &swapChain->swapChainFramebuffers[i]) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create framebuffer!");
-        }
+void RenderPipeline::setRecordThreadCount(uint32_t threadCount)
+{
+    vkDeviceWaitIdle(device);
+    commandRecorder.setThreadCount(threadCount);
+}
+
+
+// Records drawCount draws, repeated from the last frame's dynamic and static lists, into the current
+// slot's secondaries through the recorder, and returns the mean milliseconds per recording. Nothing is
+// submitted, the next frame resets the pools as usual. Must run between frames.
+double RenderPipeline::timeRecording(size_t drawCount, uint32_t repeats)
+{
+    size_t available = dynamicDraws.size() + staticDraws.size();
+    
+    if (available == 0 || repeats == 0)
+    {
+        return 0.0;
+    }
+    
+    vkDeviceWaitIdle(device);
+    
+    // whole meshes, the source lists' meshlet ranges are not carried over
+    timedDraws.clear();
+    
+    for (size_t d = 0; d < drawCount; d++)
+    {
+        size_t i = d % available;
+        const DrawCommand& draw = (i < dynamicDraws.size()) ? dynamicDraws[i] : staticDraws[i - dynamicDraws.size()];
+        
+        timedDraws.add(draw.key, draw.actorIndex, draw.pipelineId);
+    }
+    
+    timedDraws.sort();
+    
+    VkCommandBufferInheritanceInfo inheritanceInfo{};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.renderPass = renderGraph.getRenderPass(scenePass);
+    inheritanceInfo.subpass = 0;
+    inheritanceInfo.framebuffer = renderGraph.getFramebuffer(scenePass);
+    
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    for (uint32_t r = 0; r < repeats; r++)
+    {
+        commandRecorder.record(currentFrame, inheritanceInfo, timedDraws.size(),
+            [this](VkCommandBuffer secondary, size_t first, size_t last)
+            {
+                DrawStats stats;
+                
+                bindSceneState(secondary);
+                recordDraws(secondary, timedDraws, first, last, stats);
+            });
     }
+    
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+    
+    return elapsed.count() / repeats;
 }
 
 
-void RenderPipeline::createDepthResources()
+// Layouts and barriers around the blit come from the render graph
+void RenderPipeline::recordUpscale(VkCommandBuffer commandBuffer)
 {
-    VkFormat depthFormat = findDepthFormat(deviceManager->physicalDevice);
+    // only the rendered sub-rect of the scene image is valid
+    VkImageBlit blit{};
+    blit.srcOffsets[0] = {0, 0, 0};
+    blit.srcOffsets[1] = {static_cast<int32_t>(renderExtent.width), static_cast<int32_t>(renderExtent.height), 1};
+    blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    blit.srcSubresource.mipLevel = 0;
+    blit.srcSubresource.baseArrayLayer = 0;
+    blit.srcSubresource.layerCount = 1;
+    blit.dstOffsets[0] = {0, 0, 0};
+    blit.dstOffsets[1] = {static_cast<int32_t>(swapChain->swapChainExtent.width), static_cast<int32_t>(swapChain->swapChainExtent.height), 1};
+    blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    blit.dstSubresource.mipLevel = 0;
+    blit.dstSubresource.baseArrayLayer = 0;
+    blit.dstSubresource.layerCount = 1;
+    
+    vkCmdBlitImage(commandBuffer,
+        renderGraph.getImage(sceneResolve), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        renderGraph.getImage(swapChainTarget), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        1, &blit,
+        VK_FILTER_NEAREST);
+}
+
+
+void RenderPipeline::createCommandBuffers()
+{
+    commandBuffers.resize(maxFramesInFlight);
+    
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = (uint32_t) commandBuffers.size();
+
+    if (vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data()) != VK_SUCCESS)
+        throw std::runtime_error("failed to allocate command buffers!");
+    
+    staticCommandBuffers.resize(maxFramesInFlight);
+    staticCacheValid.resize(maxFramesInFlight, false);
     
-    createImage(device, deviceManager->physicalDevice, swapChain->swapChainExtent.width, swapChain->swapChainExtent.height, 1, msaaSamples, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage, depthImageMemory);
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+    allocInfo.commandBufferCount = (uint32_t) staticCommandBuffers.size();
     
-    depthImageView = createImageView(device, depthImage, depthFormat, 1, VK_IMAGE_ASPECT_DEPTH_BIT);
+    if (vkAllocateCommandBuffers(device, &allocInfo, staticCommandBuffers.data()) != VK_SUCCESS)
+        throw std::runtime_error("failed to allocate static command buffers!");
+}
+
+
+void RenderPipeline::createCommandPool()
+{
+    QueueFamilyIndices queueFamilyIndices = deviceManager->findQueueFamilies(deviceManager->physicalDevice);
 
-    transitionImageLayout(deviceManager->device, deviceManager->graphicsQueue, commandPool, depthImage, depthFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, 1);
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
+    
+    if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
+        throw std::runtime_error("failed to create command pool!");
+    
+    
 }
 
 
-void RenderPipeline::createColorResources() {
-    VkFormat colorFormat = swapChain->swapChainImageFormat;
+void RenderPipeline::createRenderPipeline()
+{
+    VkPushConstantRange pushConstantRange = {};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(PushConstants);
 
-    createImage(device, deviceManager->physicalDevice, swapChain->swapChainExtent.width, swapChain->swapChainExtent.height, 1, msaaSamples, colorFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, colorImage, colorImageMemory);
-    colorImageView = createImageView(device, colorImage, colorFormat, 1, VK_IMAGE_ASPECT_COLOR_BIT);
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+    
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+    
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create pipeline layout!");
+    }
+    
+    
+    materialCache.init(device, pipelineLayout, renderGraph.getRenderPass(scenePass), msaaSamples);
+    
+    // the shaders' texture array matches the descriptor binding
+    ShaderVariant variant = materialCache.getVariant();
+    variant.maxTextures = textureBuffer.loadedTextures;
+    materialCache.setVariant(variant);
+    
+    PipelineState opaque{};
+    opaque.vertexShader = "res/shaders/vert.spv";
+    opaque.fragmentShader = "res/shaders/frag.spv";
+    materialCache.createMaterial(MaterialPass::MP_OPAQUE, opaque);
+    
+    PipelineState alphaTested = opaque;
+    alphaTested.fragmentShader = "res/shaders/alphatest.spv";
+    alphaTested.cullMode = VK_CULL_MODE_NONE;
+    materialCache.createMaterial(MaterialPass::MP_ALPHA_TESTED, alphaTested);
+    
+    PipelineState hud = opaque;
+    hud.fragmentShader = "res/shaders/unlit.spv";
+    hud.cullMode = VK_CULL_MODE_NONE;
+    hud.depthTest = false;
+    hud.depthWrite = false;
+    hud.blend = true;
+    materialCache.createMaterial(MaterialPass::MP_HUD, hud);
+    
+    // built up front so a missing shader fails at startup, the others are built on first use
+    materialCache.prepare(MATERIAL_OPAQUE);
+    
+    // cached static draws reference the old pipeline
+    invalidateStaticCache();
 }
 
 
@@ -776,31 +1542,18 @@ VkSampleCountFlagBits RenderPipeline::getMaxUsableSampleCount()
 }
 
 
-void RenderPipeline::destroyColorResources()
+void RenderPipeline::destroy()
 {
     vkDeviceWaitIdle(device);
+    deletionQueue.flush();
     
-    vkDestroyImageView(device, colorImageView, nullptr);
-    vkDestroyImage(device, colorImage, nullptr);
-    vkFreeMemory(device, colorImageMemory, nullptr);
-}
-
-
-void RenderPipeline::destroyDepthBuffer()
-{
-    vkDestroyImageView(device, depthImageView, nullptr);
-    vkDestroyImage(device, depthImage, nullptr);
-    vkFreeMemory(device, depthImageMemory, nullptr);
-}
-
-
-void RenderPipeline::destroy()
-{
-    vkDestroyPipeline(device, graphicsPipeline, nullptr);
+    textureBuffer.destroy();
+    
+    materialCache.destroy();
     vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
-    vkDestroyRenderPass(device, renderPass, nullptr);
+    renderGraph.destroy();
     
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    for (size_t i = 0; i < maxFramesInFlight; i++) {
         vkDestroyBuffer(device, uniformBuffers[i], nullptr);
         vkFreeMemory(device, uniformBuffersMemory[i], nullptr);
     }
@@ -808,14 +1561,18 @@ void RenderPipeline::destroy()
     vkDestroyDescriptorPool(device, descriptorPool, nullptr);
     vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
     
-    vertexBuffer.destroy();
+    geometryHeap.destroy();
+    hiZBuffer.destroy();
     
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    for (size_t i = 0; i < maxFramesInFlight; i++)
     {
         vkDestroySemaphore(device, renderFinishedSemaphores[i], nullptr);
         vkDestroySemaphore(device, imageAvailableSemaphores[i], nullptr);
         vkDestroyFence(device, inFlightFences[i], nullptr);
     }
     
+    gpuTimer.destroy();
+    commandRecorder.destroy();
+    
     vkDestroyCommandPool(device, commandPool, nullptr);
 }
@@ -4,9 +4,22 @@
 #include "IOUtils.h"
 #include "VulkanUtils.h"
 #include "DeviceManager.h"
-#include "VertexBuffer.h"
+#include "GeometryHeap.h"
+#include "StaticBatcher.h"
+#include "MeshletCuller.h"
+#include "HiZBuffer.h"
+#include "RenderGraph.h"
+#include "World.h"
 #include "TextureBuffer.h"
 #include "SwapChain.h"
+#include "GpuTimer.h"
+#include "DynamicResolution.h"
+#include "CommandRecorder.h"
+#include "DeletionQueue.h"
+#include "FramePacer.h"
+#include "MaterialCache.h"
+#include "DrawList.h"
+#include <mutex>
 #include "Player.h"
 #include "World.h"
 
@@ -27,16 +40,54 @@ struct PushConstants
 };
 
 
+// GPU frame time accumulated while a shader variant was active. Dynamic resolution changes the
+// pixel count, so variants are best compared per pixel.
+struct VariantTiming
+{
+    uint32_t frames = 0;
+    double milliseconds = 0.0;
+    double pixels = 0.0;
+};
+
+
+// geometry heap allocation shared by every actor loaded from the same object
+struct SharedMesh
+{
+    uint32_t objectId;
+    uint32_t users = 0;
+};
+
+
 class RenderPipeline {
 private:
     float x = 0;
-    const int MAX_FRAMES_IN_FLIGHT = 2;
+    uint32_t maxFramesInFlight = 2;      // every per-frame resource is allocated this many times
+    uint32_t framesInFlight = 2;         // slots cycled, independent of the latency mode
     uint32_t currentFrame = 0;
     
+    FramePacer framePacer;
+    bool presentModeChanged = false;
+    
     VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_1_BIT;
-    VkImage colorImage;
-    VkDeviceMemory colorImageMemory;
-    VkImageView colorImageView;
+    VkFormat sceneFormat;
+    
+    // the scene renders multisampled, resolves into a single-sample image and is scaled to the swap chain
+    RenderGraph renderGraph;
+    uint32_t sceneColor;
+    uint32_t sceneDepth;
+    uint32_t sceneResolve;
+    uint32_t swapChainTarget;
+    uint32_t scenePass;
+    bool graphDirty = false;
+    
+    VkExtent2D renderExtent;
+    GpuTimer gpuTimer;
+    
+    // variant key and rendered pixels of the frame last recorded in each slot
+    std::vector<uint64_t> frameVariants;
+    std::vector<uint32_t> framePixels;
+    std::unordered_map<uint64_t, VariantTiming> variantTimings;
+    DynamicResolution dynamicResolution;
     
     DeviceManager* deviceManager;
     SwapChain* swapChain;
@@ -44,28 +95,76 @@ private:
     Player* player;
     World* world;
     
-    VkImage depthImage;
-    VkDeviceMemory depthImageMemory;
-    VkImageView depthImageView;
-    
     TextureBuffer textureBuffer;
-    VertexBuffer vertexBuffer;
+    GeometryHeap geometryHeap;
+    StaticBatcher staticBatcher;
+    float lodPixelsPerUnit = 1.f;
+    
+    // actor meshes by object id, and each allocation's users so it is released with the last of them
+    std::unordered_map<uint32_t, uint32_t> objectMeshes;
+    std::unordered_map<uint32_t, SharedMesh> sharedMeshes;
+    
+    MeshletCuller meshletCuller;
+    std::vector<IndexRange> scratchRanges;
+    
+    // occlusion against last frame's depth, indexed like the world's actors and the batcher's batches
+    HiZBuffer hiZBuffer;
+    std::vector<bool> occludedActors;
+    std::vector<bool> occludedBatches;
+    
+    // where each depth-writing actor was when occlusion was last tested, to bound how far occluders moved
+    std::unordered_map<const Actor*, glm::vec3> occluderLocations;
+    double occluderSampleTime = 0.0;
     
     VkDescriptorSetLayout descriptorSetLayout;
     VkDescriptorPool descriptorPool;
     std::vector<VkDescriptorSet> descriptorSets;
+    std::vector<std::vector<VkImageView>> boundTextureViews;    // per frame slot, as written into its set
     
-    VkRenderPass renderPass;
-    VkPipeline graphicsPipeline;
+    MaterialCache materialCache;
     VkPipelineLayout pipelineLayout;
     
     VkCommandPool commandPool;
     std::vector<VkCommandBuffer> commandBuffers;
     
+    // frames fall between 30 Hz ticks, dynamic draws and the camera are blended this far towards the latest
+    float interpolation = 1.f;
+    std::vector<glm::mat4> renderMatrices;      // per actor, as pushed when it is drawn this frame
+    
+    CommandRecorder commandRecorder;
+    DrawList dynamicDraws;
+    DrawList timedDraws;
+    std::vector<VkCommandBuffer> frameSecondaries;
+    
+    // static (non-physics) draws are recorded once per frame slot and replayed until invalidated
+    std::vector<VkCommandBuffer> staticCommandBuffers;
+    std::vector<bool> staticCacheValid;
+    DrawList staticDraws;
+    DrawStats staticStats;
+    
+    DrawStats frameStats;
+    DrawStats lastFrameStats;
+    std::mutex statsMutex;
+    uint64_t staticSignature = 0;
+    uint64_t staticMeshletHash = 0;
+    glm::mat4 staticView = glm::mat4(0.f);          // the view static meshlets were last culled from
+    std::vector<size_t> staticMeshletActors;        // unbatched static actors drawn at full detail this frame
+    VkExtent2D staticExtent{};
+    uint32_t staticCacheRebuilds = 0;
+    
     std::vector<VkSemaphore> imageAvailableSemaphores;
     std::vector<VkSemaphore> renderFinishedSemaphores;
     std::vector<VkFence> inFlightFences;
     
+    // resources replaced during swap chain recreation are destroyed once their last submission retires
+    DeletionQueue deletionQueue;
+    uint64_t submissionCount = 0;
+    std::vector<uint64_t> frameSubmissions;
+    
+    uint32_t recreateCount = 0;
+    double lastRecreateTime = 0.0;
+    double worstRecreateTime = 0.0;
+    
     std::vector<VkBuffer> uniformBuffers;
     std::vector<VkDeviceMemory> uniformBuffersMemory;
     std::vector<void*> uniformBuffersMapped;
@@ -73,13 +172,53 @@ private:
 public:
     RenderPipeline();
     void init(DeviceManager* d, SwapChain* s, World* w);
+    void beginFrame();
     void drawFrame();
     void destroy();
-    void destroyDepthBuffer();
-    void destroyColorResources();
     
     bool framebufferResized = false;
     
+    void setRecordThreadCount(uint32_t threadCount);
+    double timeRecording(size_t drawCount, uint32_t repeats);
+    const uint32_t getRecordThreadCount() const { return commandRecorder.getThreadCount(); }
+    const double getRecordTime() const { return commandRecorder.getRecordTime(); }
+    const uint32_t getStaticCacheRebuilds() const { return staticCacheRebuilds; }
+    const uint32_t getRecreateCount() const { return recreateCount; }
+    const double getLastRecreateTime() const { return lastRecreateTime; }
+    const double getWorstRecreateTime() const { return worstRecreateTime; }
+    
+    void setLatencyMode(const LatencyMode mode);
+    void setFramesInFlight(uint32_t count);
+    void setMaxFramesInFlight(uint32_t count);
+    const uint32_t getFramesInFlight() const { return framesInFlight; }
+    const uint32_t getMaxFramesInFlight() const { return maxFramesInFlight; }
+    const LatencyMode getLatencyMode() const { return framePacer.getMode(); }
+    const double getInputLatency() const { return framePacer.getInputLatency(); }
+    const double getWorstInputLatency() const { return framePacer.getWorstInputLatency(); }
+    void resetLatencyStats() { framePacer.resetLatencyStats(); }
+    
+    const DrawStats& getDrawStats() const { return lastFrameStats; }
+    const MeshletStats& getMeshletStats() const { return meshletCuller.getStats(); }
+    
+    void setOcclusionCulling(const bool enabled);
+    const bool getOcclusionCulling() const { return hiZBuffer.isEnabled(); }
+    const OcclusionStats& getOcclusionStats() const { return hiZBuffer.getStats(); }
+    
+    // the graph is rebuilt on every resize and occlusion toggle, so the report is only printed on request
+    void printGraphMemoryReport() const { renderGraph.printMemoryReport(); }
+    
+    void setShaderVariant(const ShaderVariant& variant);
+    const ShaderVariant& getShaderVariant() const { return materialCache.getVariant(); }
+    const std::unordered_map<uint64_t, VariantTiming>& getVariantTimings() const { return variantTimings; }
+    void printVariantTimings() const;
+    
+    void setTextureBudget(VkDeviceSize bytes) { textureBuffer.setBudget(bytes); }
+    const TextureStreamStats& getTextureStats() const { return textureBuffer.getStats(); }
+    const uint32_t getHeapVertices() const { return geometryHeap.getUsedVertices(); }
+    const uint32_t getHeapIndices() const { return geometryHeap.getUsedIndices(); }
+    
+    void invalidateStaticCache();
+    
     
     // TEMP
     float lx = 0.f;
@@ -88,7 +227,6 @@ public:
     
 private:
     void createRenderPipeline();
-    void createRenderPass();
     void createCommandPool();
     
     void createDescriptorSetLayout();
@@ -100,15 +238,28 @@ private:
     void createUniformBuffers();
     void updateUniformBuffer(uint32_t currentImage);
     
-    void createColorResources();
-    void createDepthResources();
-    
-    void createFramebuffers();
+    void buildRenderGraph();
+    void recreateSwapChain();
     
     void createSyncObjects();
     void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+    void recordScene(VkCommandBuffer commandBuffer);
+    void recordUpscale(VkCommandBuffer commandBuffer);
+    void bindSceneState(VkCommandBuffer commandBuffer);
+    void recordDraws(VkCommandBuffer commandBuffer, const DrawList& draws, size_t first, size_t last, DrawStats& stats);
+    void requestTexture(const Actor* a);
+    void syncTextureDescriptors();
+    void addDraw(DrawList& draws, size_t actorIndex);
+    void addBatchDraw(DrawList& draws, size_t batchIndex);
+    void syncGeometry();
+    uint8_t selectLod(const Actor* a) const;
+    bool cullMeshlets(const std::vector<Meshlet>& meshlets, const glm::mat4& model, uint16_t materialId, std::vector<IndexRange>& ranges);
+    static uint64_t hashRanges(uint64_t hash, const std::vector<IndexRange>& ranges);
+    uint64_t hashStaticMeshlets();
+    uint64_t testOcclusion(uint64_t signature);
+    void partitionDraws();
+    void recordStaticCache(const VkCommandBufferInheritanceInfo& inheritanceInfo);
     
-    VkShaderModule createShaderModule(const std::vector<char>& code);
     VkSampleCountFlagBits getMaxUsableSampleCount();
     
 };
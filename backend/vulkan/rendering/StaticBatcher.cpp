@@ -0,0 +1,210 @@
+#include "StaticBatcher.h"
+#include "MeshCooker.h"
+#include <map>
+#include <tuple>
+#include <array>
+#include <cfloat>
+
+
+StaticBatcher::StaticBatcher()
+{
+}
+
+
+bool StaticBatcher::isBatchable(const Actor* a)
+{
+    return !a->getPhysicsEnabled() && a->getMaterial() == MATERIAL_OPAQUE && !a->getObject().vertices.empty();
+}
+
+
+// Uploads one heap mesh per batch. The actors keep their own meshes too, so a batch can be
+// dropped at runtime without touching anything else.
+void StaticBatcher::build(const std::vector<Actor*>& actors, GeometryHeap& geometryHeap)
+{
+    for (const StaticBatch& batch : batches)
+    {
+        if (batch.valid)
+            releasedMeshes.push_back(batch.meshId);
+    }
+    
+    batches.clear();
+    actorBatches.clear();
+    
+    // material, texture, cell x, cell z
+    std::map<std::tuple<uint16_t, uint16_t, int, int>, std::vector<const Actor*>> groups;
+    
+    for (const Actor* a : actors)
+    {
+        if (!isBatchable(a))
+        {
+            continue;
+        }
+        
+        const BoundingBox& box = a->getBoundingBox();
+        glm::vec3 center = (box.min + box.max) * 0.5f;
+        
+        int cellX = static_cast<int>(std::floor(center.x / BATCH_CELL_SIZE));
+        int cellZ = static_cast<int>(std::floor(center.z / BATCH_CELL_SIZE));
+        
+        groups[{a->getMaterial(), a->getObject().vertices[0].texIndex, cellX, cellZ}].push_back(a);
+    }
+    
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    
+    for (const auto& [key, members] : groups)
+    {
+        StaticBatch batch{};
+        batch.material = std::get<0>(key);
+        batch.texture = std::get<1>(key);
+        batch.cell = glm::ivec2(std::get<2>(key), std::get<3>(key));
+        batch.bounds = {glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX)};
+        
+        vertices.clear();
+        indices.clear();
+        
+        for (const Actor* a : members)
+        {
+            const Object& obj = a->getObject();
+            const glm::mat4 model = a->getModelMatrix();
+            uint32_t baseVertex = static_cast<uint32_t>(vertices.size());
+            
+            for (Vertex v : obj.vertices)
+            {
+                v.pos = glm::vec3(model * glm::vec4(v.pos, 1.f));
+                
+                batch.bounds.min = glm::min(batch.bounds.min, v.pos);
+                batch.bounds.max = glm::max(batch.bounds.max, v.pos);
+                
+                vertices.push_back(v);
+            }
+            
+            for (uint32_t index : obj.indices)
+            {
+                indices.push_back(baseVertex + index);
+            }
+            
+            batch.actors.push_back(a);
+            batch.actorVersions.push_back(a->getRenderVersion());
+            actorBatches[a] = static_cast<int32_t>(batches.size());
+        }
+        
+        batch.meshId = geometryHeap.upload(vertices, indices);
+        batch.meshlets = MeshCooker::buildMeshlets(vertices, indices);
+        batches.push_back(batch);
+    }
+}
+
+
+void StaticBatcher::invalidate(StaticBatch& batch)
+{
+    batch.valid = false;
+    releasedMeshes.push_back(batch.meshId);
+}
+
+
+// Returns true if a batch was invalidated, its members then go back to being drawn one by one
+bool StaticBatcher::validate()
+{
+    bool changed = false;
+    
+    for (StaticBatch& batch : batches)
+    {
+        if (!batch.valid)
+        {
+            continue;
+        }
+        
+        for (size_t m = 0; m < batch.actors.size(); m++)
+        {
+            const Actor* a = batch.actors[m];
+            
+            if (a->getRenderVersion() != batch.actorVersions[m] || !isBatchable(a))
+            {
+                invalidate(batch);
+                changed = true;
+                break;
+            }
+        }
+    }
+    
+    return changed;
+}
+
+
+// Frustum test of each batch's bounds. Returns a hash of the visible set so callers
+// can tell when it changed.
+uint64_t StaticBatcher::cull(const glm::mat4& viewProjection)
+{
+    std::array<glm::vec4, 6> planes = MeshletCuller::extractPlanes(viewProjection);
+    
+    uint64_t signature = batches.size();
+    
+    for (size_t b = 0; b < batches.size(); b++)
+    {
+        StaticBatch& batch = batches[b];
+        batch.visible = true;
+        
+        for (const glm::vec4& plane : planes)
+        {
+            // corner furthest along the plane normal
+            glm::vec3 p(
+                plane.x >= 0.f ? batch.bounds.max.x : batch.bounds.min.x,
+                plane.y >= 0.f ? batch.bounds.max.y : batch.bounds.min.y,
+                plane.z >= 0.f ? batch.bounds.max.z : batch.bounds.min.z
+            );
+            
+            if (glm::dot(glm::vec3(plane), p) + plane.w < 0.f)
+            {
+                batch.visible = false;
+                break;
+            }
+        }
+        
+        signature = (signature ^ ((b << 1) | (batch.visible && batch.valid))) * 1099511628211ull;
+    }
+    
+    return signature;
+}
+
+
+// Called before a destroyed actor's memory is reused. Its batch can no longer be validated, so it is dropped.
+void StaticBatcher::forget(const Actor* a)
+{
+    auto it = actorBatches.find(a);
+    
+    if (it == actorBatches.end())
+    {
+        return;
+    }
+    
+    StaticBatch& batch = batches[it->second];
+    actorBatches.erase(it);
+    
+    if (batch.valid)
+    {
+        invalidate(batch);
+    }
+}
+
+
+std::vector<uint32_t> StaticBatcher::takeReleasedMeshes()
+{
+    std::vector<uint32_t> released = std::move(releasedMeshes);
+    releasedMeshes.clear();
+    
+    return released;
+}
+
+
+const bool StaticBatcher::isBatched(const Actor* a) const
+{
+    auto it = actorBatches.find(a);
+    
+    if (it == actorBatches.end())
+    {
+        return false;
+    }
+    
+    return batches[it->second].valid;
+}
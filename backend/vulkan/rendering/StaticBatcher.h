@@ -0,0 +1,70 @@
+#ifndef STATICBATCHER_H
+#define STATICBATCHER_H
+
+#include "VulkanUtils.h"
+#include "MaterialCache.h"
+#include "Actor.h"
+#include "GeometryHeap.h"
+#include "MeshletCuller.h"
+#include <unordered_map>
+
+
+// static geometry is merged per texture within cells of this size on the XZ plane
+#define BATCH_CELL_SIZE 16.f
+
+
+struct StaticBatch
+{
+    uint16_t material;
+    uint16_t texture;
+    glm::ivec2 cell;
+    BoundingBox bounds;
+    
+    uint32_t meshId;
+    std::vector<Meshlet> meshlets;      // in world space, like the geometry
+    
+    std::vector<const Actor*> actors;
+    std::vector<uint32_t> actorVersions;
+    
+    // a member changed after the batch was built, its actors are drawn individually again
+    bool valid = true;
+    bool visible = true;
+};
+
+
+/**
+ * @class StaticBatcher
+ * @brief Merges non-physics actors into pre-transformed, world-space batches at level load.
+ *
+ * Each batch is one geometry heap mesh drawn with a single call and an identity model matrix.
+ * Batches keep their own bounds so they can be culled per cell. Once a batch is invalidated its
+ * mesh is handed back through takeReleasedMeshes, since only the renderer knows when it is idle.
+ */
+class StaticBatcher {
+private:
+    std::vector<StaticBatch> batches;
+    std::unordered_map<const Actor*, int32_t> actorBatches;
+    std::vector<uint32_t> releasedMeshes;
+    
+public:
+    StaticBatcher();
+    
+    void build(const std::vector<Actor*>& actors, GeometryHeap& geometryHeap);
+    
+    bool validate();
+    void forget(const Actor* a);
+    uint64_t cull(const glm::mat4& viewProjection);
+    
+    std::vector<uint32_t> takeReleasedMeshes();
+    
+    const bool isBatched(const Actor* a) const;
+    
+    const std::vector<StaticBatch>& getBatches() const { return batches; }
+    const StaticBatch& getBatch(size_t i) const { return batches[i]; }
+    
+private:
+    static bool isBatchable(const Actor* a);
+    void invalidate(StaticBatch& batch);
+};
+
+#endif
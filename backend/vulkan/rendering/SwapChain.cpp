@@ -17,7 +17,9 @@ void SwapChain::init(VkSurfaceKHR s, Window* w, DeviceManager* d)
 }
 
 
-void SwapChain::reconstructChain()
+// The old chain is handed to the driver so it can recycle its images, and is returned
+// to the caller to be destroyed once the frames still presenting from it have retired.
+void SwapChain::reconstructChain(VkSwapchainKHR& retiredSwapChain, std::vector<VkImageView>& retiredImageViews)
 {
     int width = 0, height = 0;
     glfwGetFramebufferSize(window->window, &width, &height);
@@ -27,11 +29,16 @@ void SwapChain::reconstructChain()
         glfwWaitEvents();
     }
     
-    destroy();
+    retiredSwapChain = swapChain;
+    retiredImageViews = std::move(swapChainImageViews);
+    swapChainImageViews.clear();
+    
+    createSwapChain(retiredSwapChain);
+    createImageViews();
 }
 
 
-void SwapChain::createSwapChain()
+void SwapChain::createSwapChain(VkSwapchainKHR oldSwapChain)
 {
     SwapChainSupportDetails swapChainSupport = deviceManager->querySwapChainSupport(deviceManager->physicalDevice);
     
@@ -54,7 +61,8 @@ void SwapChain::createSwapChain()
     createInfo.imageColorSpace = surfaceFormat.colorSpace;
     createInfo.imageExtent = extent;
     createInfo.imageArrayLayers = 1;
-    createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    // the scene is rendered offscreen and blitted (upscaled) into the swap chain image
+    createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
     
     QueueFamilyIndices indices = deviceManager->findQueueFamilies(deviceManager->physicalDevice);
     uint32_t queueFamilyIndices[] = {indices.graphicsFamily.value(), indices.presentFamily.value()};
@@ -73,7 +81,7 @@ void SwapChain::createSwapChain()
     createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     createInfo.presentMode = presentMode;
     createInfo.clipped = VK_TRUE;
-    createInfo.oldSwapchain = VK_NULL_HANDLE;
+    createInfo.oldSwapchain = oldSwapChain;
     
     if (vkCreateSwapchainKHR(deviceManager->device, &createInfo, nullptr, &swapChain) != VK_SUCCESS) {
         throw std::runtime_error("failed to create swap chain!");
@@ -89,7 +97,7 @@ void SwapChain::createSwapChain()
 
 VkPresentModeKHR SwapChain::chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) {
     for (const auto& availablePresentMode : availablePresentModes) {
-        if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
+        if (availablePresentMode == preferredPresentMode) {
             return availablePresentMode;
         }
     }
@@ -141,15 +149,10 @@ void SwapChain::createImageViews() {
 
 void SwapChain::destroy()
 {
-    
-    for (auto framebuffer : swapChainFramebuffers)
-        vkDestroyFramebuffer(deviceManager->device, framebuffer, nullptr);
-    
     for (auto imageView : swapChainImageViews)
         vkDestroyImageView(deviceManager->device, imageView, nullptr);
     
     swapChainImageViews.clear();
-    swapChainFramebuffers.clear();
     
     vkDestroySwapchainKHR(deviceManager->device, swapChain, nullptr);
 }
@@ -15,22 +15,24 @@ public:
     
     Window* window;
     
-    std::vector<VkFramebuffer> swapChainFramebuffers;
+    std::vector<VkImage> swapChainImages;
     std::vector<VkImageView> swapChainImageViews;
     
+    // falls back to FIFO, which is always available, when unsupported
+    VkPresentModeKHR preferredPresentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+    
 private:
     DeviceManager* deviceManager;
     VkSurfaceKHR surface;
-    std::vector<VkImage> swapChainImages;
     
 public:
     SwapChain();
     void init(VkSurfaceKHR s, Window* w, DeviceManager* d);
     void destroy();
     
-    void createSwapChain();
+    void createSwapChain(VkSwapchainKHR oldSwapChain = VK_NULL_HANDLE);
     void createImageViews();
-    void reconstructChain();
+    void reconstructChain(VkSwapchainKHR& retiredSwapChain, std::vector<VkImageView>& retiredImageViews);
 
 private:
     VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
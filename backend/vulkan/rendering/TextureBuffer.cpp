@@ -1,6 +1,11 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "TextureBuffer.h"
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
 
 TextureBuffer::TextureBuffer()
 {
@@ -12,20 +17,76 @@ void TextureBuffer::init(DeviceManager* d, VkCommandPool cp, World* w)
     deviceManager = d;
     commandPool = cp;
     world = w;
-    
+
     linearFiltering = false;
-    
+    stats.budget = budget;
+
+    running = true;
+
+    for (uint32_t i = 0; i < TEXTURE_STREAM_THREADS; i++)
+    {
+        workers.emplace_back(&TextureBuffer::run, this);
+    }
+
     populateBuffers();
     createTextureSampler();
 }
 
 
+// Only each texture's header is read on the main thread. Decoding and mipping run on the
+// workers in parallel, and only the tails are uploaded.
 void TextureBuffer::populateBuffers()
 {
     for (const Object& obj : world->getWorldObjects())
     {
-        createTextureImage(obj.texture);
+        StreamedTexture texture{};
+        texture.path = obj.texture;
+
+        int texWidth, texHeight, texChannels;
+
+        if (!stbi_info(obj.texture, &texWidth, &texHeight, &texChannels))
+            throw std::runtime_error("failed to load texture image!");
+
+        texture.width = static_cast<uint32_t>(texWidth);
+        texture.height = static_cast<uint32_t>(texHeight);
+        texture.mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
+
+        while (texture.tailLevel + 1 < texture.mipLevels && std::max(texture.width, texture.height) >> texture.tailLevel > TEXTURE_TAIL_SIZE)
+        {
+            texture.tailLevel++;
+        }
+
+        texture.residentLevel = texture.tailLevel;
+        texture.requestedLevel = texture.tailLevel;
+        texture.wantedLevel = texture.tailLevel;
+
+        textures.push_back(texture);
+    }
+
+    for (uint32_t i = 0; i < textures.size(); i++)
+    {
+        scheduleLoad(i, textures[i].tailLevel);
     }
+
+    std::vector<TextureUpload> uploads;
+
+    {
+        std::unique_lock<std::mutex> lock(uploadMutex);
+        uploadCondition.wait(lock, [this]() { return completedUploads.size() == textures.size(); });
+        uploads.swap(completedUploads);
+    }
+
+    // slots are assigned in load order
+    std::sort(uploads.begin(), uploads.end(), [](const TextureUpload& a, const TextureUpload& b) { return a.texture < b.texture; });
+
+    textureImageView.resize(textures.size());
+
+    for (const TextureUpload& upload : uploads)
+    {
+        createTextureImage(upload);
+    }
+
+    stats.pendingLoads = 0;
 }
 
 
@@ -33,26 +94,26 @@ void TextureBuffer::createTextureSampler()
 {
     VkPhysicalDeviceProperties properties{};
     vkGetPhysicalDeviceProperties(deviceManager->physicalDevice, &properties);
-    
+
     VkSamplerCreateInfo samplerInfo{};
-    
+
     samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-    
+
     if (linearFiltering)
     {
         samplerInfo.magFilter = VK_FILTER_LINEAR;
         samplerInfo.minFilter = VK_FILTER_LINEAR;
-        
+
         samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
     }
     else
     {
         samplerInfo.magFilter = VK_FILTER_NEAREST;
         samplerInfo.minFilter = VK_FILTER_NEAREST;
-        
+
         samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
     }
-    
+
     samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
     samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
     samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
@@ -65,155 +126,121 @@ void TextureBuffer::createTextureSampler()
     samplerInfo.mipLodBias = 0.0f;
     samplerInfo.minLod = 0;
     samplerInfo.maxLod = 10;
-    
+
     textureSampler.resize(textureSampler.size() + 1);
-    
+
     if (vkCreateSampler(deviceManager->device, &samplerInfo, nullptr, &textureSampler[textureSampler.size() - 1]) != VK_SUCCESS)
         throw std::runtime_error("failed to create texture sampler!");
 }
 
 
-void TextureBuffer::createTextureImageView()
+void TextureBuffer::createTextureImage(const TextureUpload& upload)
 {
-    textureImageView[loadedTextures] = createImageView(deviceManager->device, textureImage[loadedTextures], VK_FORMAT_R8G8B8A8_SRGB, mipLevels);
-}
-
+    if (upload.failed)
+        throw std::runtime_error("failed to load texture image!");
 
-void TextureBuffer::createTextureImage(const char* filename)
-{
-    int texWidth, texHeight, texChannels;
-    stbi_uc* pixels = stbi_load(filename, &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-    VkDeviceSize imageSize = texWidth * texHeight * 4;
-    
-    mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
+    StreamedTexture& texture = textures[upload.texture];
+    texture.loading = false;
 
-    if (!pixels)
-        throw std::runtime_error("failed to load texture image!");
-    
     VkBuffer stagingBuffer;
     VkDeviceMemory stagingBufferMemory;
-    
-    createBuffer(deviceManager->device, deviceManager->physicalDevice, imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-    
-    void* data;
-    vkMapMemory(deviceManager->device, stagingBufferMemory, 0, imageSize, 0, &data);
-        memcpy(data, pixels, static_cast<size_t>(imageSize));
-    vkUnmapMemory(deviceManager->device, stagingBufferMemory);
-    
-    stbi_image_free(pixels);
-    
-    VkImageCreateInfo imageInfo{};
-    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-    imageInfo.imageType = VK_IMAGE_TYPE_2D;
-    imageInfo.extent.width = static_cast<uint32_t>(texWidth);
-    imageInfo.extent.height = static_cast<uint32_t>(texHeight);
-    imageInfo.extent.depth = 1;
-    imageInfo.mipLevels = mipLevels;
-    imageInfo.arrayLayers = 1;
-    imageInfo.format = VK_FORMAT_R8G8B8A8_SRGB;
-    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-    
-    
-    textureImage.resize(loadedTextures + 1);
-    textureImageView.resize(loadedTextures + 1);
-    textureImageMemory.resize(loadedTextures + 1);
-    
-    createImage(deviceManager->device, deviceManager->physicalDevice, texWidth, texHeight, mipLevels, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage[loadedTextures], textureImageMemory[loadedTextures]);
-    
-    transitionImageLayout(deviceManager->device, deviceManager->graphicsQueue, commandPool, textureImage[loadedTextures], VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels);
-    
-    copyBufferToImage(stagingBuffer, textureImage[loadedTextures], static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
-    
+    createStagingBuffer(upload, stagingBuffer, stagingBufferMemory);
+
+    createLevelsImage(texture, upload.baseLevel, texture.image, texture.memory, texture.size);
+
+    VkCommandBuffer commandBuffer = beginSingleTimeCommands(deviceManager->device, commandPool);
+    recordUpload(commandBuffer, texture.image, texture, upload, stagingBuffer);
+    endSingleTimeCommands(deviceManager->device, deviceManager->graphicsQueue, commandPool, commandBuffer);
+
     vkDestroyBuffer(deviceManager->device, stagingBuffer, nullptr);
     vkFreeMemory(deviceManager->device, stagingBufferMemory, nullptr);
-    
-    generateMipmaps(textureImage[loadedTextures], VK_FORMAT_R8G8B8A8_SRGB, texWidth, texHeight, mipLevels);
-    
-    createTextureImageView();
-//    createTextureSampler();
-    
+
+    textureImageView[upload.texture] = createImageView(deviceManager->device, texture.image, VK_FORMAT_R8G8B8A8_SRGB, texture.mipLevels - upload.baseLevel);
+
+    stats.residentBytes += texture.size;
     loadedTextures++;
 }
 
 
-void TextureBuffer::generateMipmaps(VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels)
+void TextureBuffer::createLevelsImage(const StreamedTexture& texture, uint32_t baseLevel, VkImage& image, VkDeviceMemory& memory, VkDeviceSize& size)
 {
-    VkFormatProperties formatProperties;
-    vkGetPhysicalDeviceFormatProperties(deviceManager->physicalDevice, imageFormat, &formatProperties);
-    
-    if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT))
+    uint32_t width = std::max(texture.width >> baseLevel, 1u);
+    uint32_t height = std::max(texture.height >> baseLevel, 1u);
+
+    // transfer source so coarser levels can be copied out when this image is evicted
+    createImage(deviceManager->device, deviceManager->physicalDevice, width, height, texture.mipLevels - baseLevel, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, memory);
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(deviceManager->device, image, &memRequirements);
+    size = memRequirements.size;
+}
+
+
+void TextureBuffer::createStagingBuffer(const TextureUpload& upload, VkBuffer& buffer, VkDeviceMemory& memory)
+{
+    VkDeviceSize bufferSize = 0;
+
+    for (const std::vector<stbi_uc>& level : upload.levels)
     {
-        throw std::runtime_error("texture image format does not support linear blitting!");
+        bufferSize += level.size();
     }
-    
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands(deviceManager->device, commandPool);
+
+    createBuffer(deviceManager->device, deviceManager->physicalDevice, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, buffer, memory);
+
+    void* data;
+    vkMapMemory(deviceManager->device, memory, 0, bufferSize, 0, &data);
+
+    size_t offset = 0;
+
+    for (const std::vector<stbi_uc>& level : upload.levels)
+    {
+        memcpy(static_cast<char*>(data) + offset, level.data(), level.size());
+        offset += level.size();
+    }
+
+    vkUnmapMemory(deviceManager->device, memory);
+}
+
+
+// Copies every level of the upload into a freshly created image and leaves it shader readable.
+void TextureBuffer::recordUpload(VkCommandBuffer commandBuffer, VkImage image, const StreamedTexture& texture, const TextureUpload& upload, VkBuffer stagingBuffer)
+{
+    uint32_t levelCount = static_cast<uint32_t>(upload.levels.size());
 
     VkImageMemoryBarrier barrier{};
     barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
     barrier.image = image;
     barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
     barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount = 1;
-    barrier.subresourceRange.levelCount = 1;
-
-    int32_t mipWidth = texWidth;
-    int32_t mipHeight = texHeight;
-
-    for (uint32_t i = 1; i < mipLevels; i++) {
-        barrier.subresourceRange.baseMipLevel = i - 1;
-        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-
-        vkCmdPipelineBarrier(commandBuffer,
-            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
-            0, nullptr,
-            0, nullptr,
-            1, &barrier);
-
-        VkImageBlit blit{};
-        blit.srcOffsets[0] = {0, 0, 0};
-        blit.srcOffsets[1] = {mipWidth, mipHeight, 1};
-        blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        blit.srcSubresource.mipLevel = i - 1;
-        blit.srcSubresource.baseArrayLayer = 0;
-        blit.srcSubresource.layerCount = 1;
-        blit.dstOffsets[0] = {0, 0, 0};
-        blit.dstOffsets[1] = { mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1 };
-        blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        blit.dstSubresource.mipLevel = i;
-        blit.dstSubresource.baseArrayLayer = 0;
-        blit.dstSubresource.layerCount = 1;
-
-        vkCmdBlitImage(commandBuffer,
-            image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-            image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-            1, &blit,
-            VK_FILTER_LINEAR);
-
-        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-        vkCmdPipelineBarrier(commandBuffer,
-            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
-            0, nullptr,
-            0, nullptr,
-            1, &barrier);
-
-        if (mipWidth > 1) mipWidth /= 2;
-        if (mipHeight > 1) mipHeight /= 2;
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, levelCount, 0, 1};
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer,
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+        0, nullptr,
+        0, nullptr,
+        1, &barrier);
+
+    std::vector<VkBufferImageCopy> regions(levelCount);
+    VkDeviceSize offset = 0;
+
+    for (uint32_t i = 0; i < levelCount; i++)
+    {
+        uint32_t level = upload.baseLevel + i;
+
+        regions[i].bufferOffset = offset;
+        regions[i].imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, i, 0, 1};
+        regions[i].imageOffset = {0, 0, 0};
+        regions[i].imageExtent = {std::max(texture.width >> level, 1u), std::max(texture.height >> level, 1u), 1};
+
+        offset += upload.levels[i].size();
     }
 
-    barrier.subresourceRange.baseMipLevel = mipLevels - 1;
+    vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, levelCount, regions.data());
+
     barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
     barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
     barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
@@ -224,53 +251,506 @@ void TextureBuffer::generateMipmaps(VkImage image, VkFormat imageFormat, int32_t
         0, nullptr,
         0, nullptr,
         1, &barrier);
+}
 
-    endSingleTimeCommands(deviceManager->device, deviceManager->graphicsQueue, commandPool, commandBuffer);
+
+// Drops every level finer than the given one. The coarser levels are already on the GPU, so
+// they are copied into the smaller image instead of being decoded again.
+void TextureBuffer::recordEviction(VkCommandBuffer commandBuffer, uint32_t index, uint32_t level, DeletionQueue& deletionQueue, uint64_t lastSubmission)
+{
+    StreamedTexture& texture = textures[index];
+    uint32_t levelCount = texture.mipLevels - level;
+
+    VkImage image;
+    VkDeviceMemory memory;
+    VkDeviceSize size;
+    createLevelsImage(texture, level, image, memory, size);
+
+    std::array<VkImageMemoryBarrier, 2> barriers{};
+
+    // earlier frames may still be sampling the old image
+    barriers[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barriers[0].image = texture.image;
+    barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[0].subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, level - texture.residentLevel, levelCount, 0, 1};
+    barriers[0].oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barriers[0].srcAccessMask = 0;
+    barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+    barriers[1].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barriers[1].image = image;
+    barriers[1].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[1].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[1].subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, levelCount, 0, 1};
+    barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barriers[1].srcAccessMask = 0;
+    barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+        0, nullptr,
+        0, nullptr,
+        static_cast<uint32_t>(barriers.size()), barriers.data());
+
+    std::vector<VkImageCopy> regions(levelCount);
+
+    for (uint32_t i = 0; i < levelCount; i++)
+    {
+        uint32_t mip = level + i;
+
+        regions[i].srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, mip - texture.residentLevel, 0, 1};
+        regions[i].dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, i, 0, 1};
+        regions[i].extent = {std::max(texture.width >> mip, 1u), std::max(texture.height >> mip, 1u), 1};
+    }
+
+    vkCmdCopyImage(commandBuffer,
+        texture.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        levelCount, regions.data());
+
+    barriers[1].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barriers[1].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barriers[1].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+        0, nullptr,
+        0, nullptr,
+        1, &barriers[1]);
+
+    replaceImage(index, level, image, memory, size, deletionQueue, lastSubmission);
+    stats.evicted++;
 }
 
 
-void TextureBuffer::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height)
+void TextureBuffer::replaceImage(uint32_t index, uint32_t level, VkImage image, VkDeviceMemory memory, VkDeviceSize size,
+                                 DeletionQueue& deletionQueue, uint64_t lastSubmission)
 {
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands(deviceManager->device, commandPool);
-    
-    VkBufferImageCopy region{};
-    region.bufferOffset = 0;
-    region.bufferRowLength = 0;
-    region.bufferImageHeight = 0;
-
-    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    region.imageSubresource.mipLevel = 0;
-    region.imageSubresource.baseArrayLayer = 0;
-    region.imageSubresource.layerCount = 1;
-
-    region.imageOffset = {0, 0, 0};
-    region.imageExtent = {
-        width,
-        height,
-        1
-    };
-    
-    vkCmdCopyBufferToImage(
-        commandBuffer,
-        buffer,
-        image,
-        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-        1,
-        &region
-    );
+    StreamedTexture& texture = textures[index];
 
-    endSingleTimeCommands(deviceManager->device, deviceManager->graphicsQueue, commandPool, commandBuffer);
+    VkDevice device = deviceManager->device;
+    VkImage oldImage = texture.image;
+    VkDeviceMemory oldMemory = texture.memory;
+    VkImageView oldView = textureImageView[index];
+
+    deletionQueue.push(lastSubmission, [device, oldImage, oldMemory, oldView]()
+    {
+        vkDestroyImageView(device, oldView, nullptr);
+        vkDestroyImage(device, oldImage, nullptr);
+        vkFreeMemory(device, oldMemory, nullptr);
+    });
+
+    stats.residentBytes = stats.residentBytes - texture.size + size;
+
+    texture.image = image;
+    texture.memory = memory;
+    texture.size = size;
+    texture.residentLevel = level;
+
+    textureImageView[index] = createImageView(device, image, VK_FORMAT_R8G8B8A8_SRGB, texture.mipLevels - level);
+}
+
+
+void TextureBuffer::request(uint32_t texture, float uvPerPixel)
+{
+    if (texture >= textures.size())
+    {
+        return;
+    }
+
+    StreamedTexture& t = textures[texture];
+
+    float texelsPerPixel = uvPerPixel * std::max(t.width, t.height);
+    uint32_t level = texelsPerPixel > 1.f ? static_cast<uint32_t>(std::log2(texelsPerPixel)) : 0;
+
+    t.requestedLevel = std::min(t.requestedLevel, std::min(level, t.tailLevel));
+}
+
+
+void TextureBuffer::setBudget(VkDeviceSize bytes)
+{
+    budget = bytes;
+    stats.budget = bytes;
+}
+
+
+VkDeviceSize TextureBuffer::estimateSize(const StreamedTexture& texture, uint32_t baseLevel) const
+{
+    VkDeviceSize size = 0;
+
+    for (uint32_t level = baseLevel; level < texture.mipLevels; level++)
+    {
+        size += static_cast<VkDeviceSize>(std::max(texture.width >> level, 1u)) * std::max(texture.height >> level, 1u) * 4;
+    }
+
+    return size;
+}
+
+
+uint32_t TextureBuffer::desiredLevel(const StreamedTexture& texture) const
+{
+    return frame - texture.lastRequested <= TEXTURE_EVICT_FRAMES ? texture.wantedLevel : texture.tailLevel;
+}
+
+
+// Drops the texture asked for longest ago, other than keep, back to its tail. Textures asked
+// for this frame are never dropped to make room for others.
+bool TextureBuffer::evictLeastRecent(VkCommandBuffer commandBuffer, uint32_t keep, DeletionQueue& deletionQueue, uint64_t lastSubmission)
+{
+    int32_t oldest = -1;
+
+    for (uint32_t i = 0; i < textures.size(); i++)
+    {
+        const StreamedTexture& t = textures[i];
+
+        if (i == keep || t.loading || t.residentLevel >= t.tailLevel || t.lastRequested == frame)
+        {
+            continue;
+        }
+
+        if (oldest < 0 || t.lastRequested < textures[oldest].lastRequested)
+        {
+            oldest = static_cast<int32_t>(i);
+        }
+    }
+
+    if (oldest < 0)
+    {
+        return false;
+    }
+
+    // not loaded again until a draw asks for it
+    textures[oldest].wantedLevel = textures[oldest].tailLevel;
+    recordEviction(commandBuffer, static_cast<uint32_t>(oldest), textures[oldest].tailLevel, deletionQueue, lastSubmission);
+
+    return true;
+}
+
+
+// Runs after the frame's requests, on the main thread. Finished decodes are uploaded, unwanted
+// levels dropped, and new loads scheduled finest first while they fit the budget.
+bool TextureBuffer::recordStreaming(VkCommandBuffer commandBuffer, DeletionQueue& deletionQueue, uint64_t lastSubmission)
+{
+    bool changed = false;
+
+    // a coarser request only replaces a finer one once the finer one has gone stale
+    for (StreamedTexture& t : textures)
+    {
+        if (t.requestedLevel < t.tailLevel && (t.requestedLevel <= t.wantedLevel || frame - t.lastRequested > TEXTURE_EVICT_FRAMES))
+        {
+            t.wantedLevel = t.requestedLevel;
+            t.lastRequested = frame;
+        }
+
+        t.requestedLevel = t.tailLevel;
+    }
+
+    std::vector<TextureUpload> uploads;
+
+    {
+        std::lock_guard<std::mutex> lock(uploadMutex);
+        uploads.swap(completedUploads);
+    }
+
+    for (const TextureUpload& upload : uploads)
+    {
+        if (upload.failed)
+            throw std::runtime_error("failed to load texture image!");
+
+        StreamedTexture& texture = textures[upload.texture];
+
+        texture.loading = false;
+        reservedBytes -= texture.reserved;
+        texture.reserved = 0;
+        stats.pendingLoads--;
+
+        VkBuffer stagingBuffer;
+        VkDeviceMemory stagingBufferMemory;
+        createStagingBuffer(upload, stagingBuffer, stagingBufferMemory);
+
+        VkImage image;
+        VkDeviceMemory memory;
+        VkDeviceSize size;
+        createLevelsImage(texture, upload.baseLevel, image, memory, size);
+
+        recordUpload(commandBuffer, image, texture, upload, stagingBuffer);
+        replaceImage(upload.texture, upload.baseLevel, image, memory, size, deletionQueue, lastSubmission);
+
+        VkDevice device = deviceManager->device;
+        deletionQueue.push(lastSubmission, [device, stagingBuffer, stagingBufferMemory]()
+        {
+            vkDestroyBuffer(device, stagingBuffer, nullptr);
+            vkFreeMemory(device, stagingBufferMemory, nullptr);
+        });
+
+        stats.streamedIn++;
+        changed = true;
+    }
+
+    for (uint32_t i = 0; i < textures.size(); i++)
+    {
+        const StreamedTexture& t = textures[i];
+
+        if (!t.loading && desiredLevel(t) > t.residentLevel)
+        {
+            recordEviction(commandBuffer, i, desiredLevel(t), deletionQueue, lastSubmission);
+            changed = true;
+        }
+    }
+
+    std::vector<uint32_t> loads;
+
+    for (uint32_t i = 0; i < textures.size(); i++)
+    {
+        if (!textures[i].loading && desiredLevel(textures[i]) < textures[i].residentLevel)
+        {
+            loads.push_back(i);
+        }
+    }
+
+    std::sort(loads.begin(), loads.end(), [this](uint32_t a, uint32_t b) { return desiredLevel(textures[a]) < desiredLevel(textures[b]); });
+
+    for (uint32_t i : loads)
+    {
+        StreamedTexture& t = textures[i];
+        uint32_t level = desiredLevel(t);
+
+        // dropped earlier in this loop to make room
+        if (level >= t.residentLevel)
+        {
+            continue;
+        }
+
+        while (level < t.residentLevel)
+        {
+            VkDeviceSize growth = estimateSize(t, level) - estimateSize(t, t.residentLevel);
+
+            if (stats.residentBytes + reservedBytes + growth <= budget)
+            {
+                break;
+            }
+
+            if (evictLeastRecent(commandBuffer, i, deletionQueue, lastSubmission))
+            {
+                changed = true;
+                continue;
+            }
+
+            // settle for a coarser level than asked
+            level++;
+        }
+
+        if (level < t.residentLevel)
+        {
+            t.reserved = estimateSize(t, level) - estimateSize(t, t.residentLevel);
+            reservedBytes += t.reserved;
+            scheduleLoad(i, level);
+        }
+    }
+
+    frame++;
+
+    return changed;
+}
+
+
+void TextureBuffer::scheduleLoad(uint32_t index, uint32_t level)
+{
+    textures[index].loading = true;
+    stats.pendingLoads++;
+
+    std::string path = textures[index].path;
+
+    enqueueTask([this, index, level, path]()
+    {
+        TextureUpload upload{};
+        upload.texture = index;
+        upload.baseLevel = level;
+
+        decodeLevels(path, upload);
+
+        {
+            std::lock_guard<std::mutex> lock(uploadMutex);
+            completedUploads.push_back(std::move(upload));
+        }
+        uploadCondition.notify_all();
+    });
+}
+
+
+// Decodes the file and builds the mip chain from the full image down, keeping baseLevel and coarser.
+void TextureBuffer::decodeLevels(const std::string& path, TextureUpload& upload)
+{
+    int texWidth, texHeight, texChannels;
+    stbi_uc* pixels = stbi_load(path.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+
+    if (!pixels)
+    {
+        upload.failed = true;
+        return;
+    }
+
+    uint32_t width = static_cast<uint32_t>(texWidth);
+    uint32_t height = static_cast<uint32_t>(texHeight);
+    uint32_t mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
+
+    std::vector<stbi_uc> level(pixels, pixels + static_cast<size_t>(width) * height * 4);
+    stbi_image_free(pixels);
+
+    for (uint32_t i = 0; i < mipLevels; i++)
+    {
+        std::vector<stbi_uc> next;
+
+        if (i + 1 < mipLevels)
+        {
+            next = downsample(level, width, height);
+            width = std::max(width / 2, 1u);
+            height = std::max(height / 2, 1u);
+        }
+
+        if (i >= upload.baseLevel)
+        {
+            upload.levels.push_back(std::move(level));
+        }
+
+        level = std::move(next);
+    }
+}
+
+
+// Box filter in linear light, matching what a linear blit of an sRGB image does. An odd last
+// row or column is folded into its neighbour.
+std::vector<stbi_uc> TextureBuffer::downsample(const std::vector<stbi_uc>& pixels, uint32_t width, uint32_t height)
+{
+    // workers may get here at the same time, static initialization is thread safe
+    static const std::array<float, 256> toLinear = []()
+    {
+        std::array<float, 256> table{};
+
+        for (int i = 0; i < 256; i++)
+        {
+            float c = i / 255.f;
+            table[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+
+        return table;
+    }();
+
+    uint32_t dstWidth = std::max(width / 2, 1u);
+    uint32_t dstHeight = std::max(height / 2, 1u);
+    std::vector<stbi_uc> result(static_cast<size_t>(dstWidth) * dstHeight * 4);
+
+    for (uint32_t y = 0; y < dstHeight; y++)
+    {
+        uint32_t y0 = std::min(y * 2, height - 1);
+        uint32_t y1 = y == dstHeight - 1 ? height - 1 : std::min(y * 2 + 1, height - 1);
+
+        for (uint32_t x = 0; x < dstWidth; x++)
+        {
+            uint32_t x0 = std::min(x * 2, width - 1);
+            uint32_t x1 = x == dstWidth - 1 ? width - 1 : std::min(x * 2 + 1, width - 1);
+
+            float sum[4] = {0.f, 0.f, 0.f, 0.f};
+            uint32_t count = 0;
+
+            for (uint32_t sy = y0; sy <= y1; sy++)
+            {
+                for (uint32_t sx = x0; sx <= x1; sx++)
+                {
+                    const stbi_uc* p = &pixels[(static_cast<size_t>(sy) * width + sx) * 4];
+
+                    sum[0] += toLinear[p[0]];
+                    sum[1] += toLinear[p[1]];
+                    sum[2] += toLinear[p[2]];
+                    sum[3] += p[3] / 255.f;
+                    count++;
+                }
+            }
+
+            stbi_uc* d = &result[(static_cast<size_t>(y) * dstWidth + x) * 4];
+
+            for (int c = 0; c < 3; c++)
+            {
+                float linear = sum[c] / count;
+                float srgb = linear <= 0.0031308f ? linear * 12.92f : 1.055f * std::pow(linear, 1.f / 2.4f) - 0.055f;
+                d[c] = static_cast<stbi_uc>(std::clamp(srgb, 0.f, 1.f) * 255.f + 0.5f);
+            }
+
+            d[3] = static_cast<stbi_uc>(std::clamp(sum[3] / count, 0.f, 1.f) * 255.f + 0.5f);
+        }
+    }
+
+    return result;
+}
+
+
+void TextureBuffer::enqueueTask(const std::function<void()>& task)
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        taskQueue.push(task);
+    }
+    taskCondition.notify_one();
 }
 
 
+void TextureBuffer::run()
+{
+    while (true)
+    {
+        std::function<void()> task;
+
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            taskCondition.wait(lock, [this]() { return !running || !taskQueue.empty(); });
+
+            if (!running)
+            {
+                return;
+            }
+
+            task = std::move(taskQueue.front());
+            taskQueue.pop();
+        }
+
+        task();
+    }
+}
+
+
+// Queued deletions of replaced images are owned by the deletion queue and must be flushed first.
 void TextureBuffer::destroy()
 {
-    for (int i = 0; i < loadedTextures; ++i)
     {
-        vkDestroySampler(deviceManager->device, textureSampler[i], nullptr);
+        std::lock_guard<std::mutex> lock(queueMutex);
+        running = false;
+    }
+    taskCondition.notify_all();
+
+    for (std::thread& worker : workers)
+    {
+        if (worker.joinable())
+            worker.join();
+    }
+
+    workers.clear();
+
+    for (VkSampler sampler : textureSampler)
+    {
+        vkDestroySampler(deviceManager->device, sampler, nullptr);
+    }
+
+    for (size_t i = 0; i < textures.size(); i++)
+    {
         vkDestroyImageView(deviceManager->device, textureImageView[i], nullptr);
-        vkDestroyImage(deviceManager->device, textureImage[i], nullptr);
-        vkFreeMemory(deviceManager->device, textureImageMemory[i], nullptr);
+        vkDestroyImage(deviceManager->device, textures[i].image, nullptr);
+        vkFreeMemory(deviceManager->device, textures[i].memory, nullptr);
     }
-    
+
+    textureSampler.clear();
+    textures.clear();
 }
@@ -4,44 +4,157 @@
 
 #include "VulkanUtils.h"
 #include "DeviceManager.h"
+#include "DeletionQueue.h"
 #include "World.h"
 #include "stb_image.h"
 
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+#include <atomic>
+#include <functional>
 
 
+// mips no larger than this in either dimension stay resident for the whole run
+#define TEXTURE_TAIL_SIZE 64
+
+#define TEXTURE_STREAM_THREADS 2
+
+// default VRAM budget for textures, tails count towards it but are never evicted
+#define DEFAULT_TEXTURE_BUDGET (256ull * 1024 * 1024)
+
+// a level that stops being requested is kept this many frames before it is dropped
+#define TEXTURE_EVICT_FRAMES 120
+
+
+struct StreamedTexture
+{
+    std::string path;
+    uint32_t width = 1;
+    uint32_t height = 1;
+    uint32_t mipLevels = 1;         // of the full chain
+    uint32_t tailLevel = 0;         // coarsest level that can be streamed out, never evicted itself
+
+    // the image only holds residentLevel and coarser, so its view is clamped to what is loaded
+    uint32_t residentLevel = 0;
+    VkImage image = VK_NULL_HANDLE;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize size = 0;
+
+    uint32_t requestedLevel = 0;    // finest level any draw asked for this frame
+    uint32_t wantedLevel = 0;       // finest level asked for recently
+    uint64_t lastRequested = 0;     // frame wantedLevel was last asked for
+    
+    bool loading = false;
+    VkDeviceSize reserved = 0;      // budget held for the load in flight
+};
+
+
+// pixel data decoded on a worker, levels[0] is baseLevel
+struct TextureUpload
+{
+    uint32_t texture;
+    uint32_t baseLevel;
+    std::vector<std::vector<stbi_uc>> levels;
+    bool failed = false;
+};
+
+
+struct TextureStreamStats
+{
+    VkDeviceSize residentBytes = 0;
+    VkDeviceSize budget = 0;
+    uint32_t streamedIn = 0;
+    uint32_t evicted = 0;
+    uint32_t pendingLoads = 0;
+};
+
+
+/**
+ * @class TextureBuffer
+ * @brief Owns the level textures, with only their mip tail loaded up front and finer mips streamed on demand.
+ *
+ * At startup each texture is decoded on a worker, mipped on the CPU and only the levels up to
+ * TEXTURE_TAIL_SIZE are uploaded. Draws report the finest level their on-screen texel density
+ * needs, workers decode that level and coarser ones, and the main thread swaps in a new image
+ * holding exactly the resident levels. Levels nothing asks for, or that do not fit the budget,
+ * are dropped by copying the coarser levels on the GPU into a smaller image. Replaced images
+ * are destroyed through the deletion queue, and each swap changes textureImageView, which the
+ * owner has to write into its descriptor sets before they are next used.
+ */
 class TextureBuffer {
 public:
     std::vector<VkImageView> textureImageView;
     std::vector<VkSampler> textureSampler;
     uint8_t loadedTextures = 0;
-    
+
 private:
     bool linearFiltering = true;
-    
+
     DeviceManager* deviceManager;
     VkCommandPool commandPool;
-    
-    uint8_t mipLevels;
-    std::vector<VkImage> textureImage;
-    std::vector<VkDeviceMemory> textureImageMemory;
-    
+
+    std::vector<StreamedTexture> textures;
+    VkDeviceSize budget = DEFAULT_TEXTURE_BUDGET;
+    VkDeviceSize reservedBytes = 0;
+    uint64_t frame = 0;
+    TextureStreamStats stats;
+
+    std::vector<std::thread> workers;
+    std::atomic<bool> running = false;
+    std::queue<std::function<void()>> taskQueue;
+    std::mutex queueMutex;
+    std::condition_variable taskCondition;
+
+    std::vector<TextureUpload> completedUploads;
+    std::mutex uploadMutex;
+    std::condition_variable uploadCondition;
+
     World* world;
-    
+
 public:
     TextureBuffer();
-    
+
     void init(DeviceManager* d, VkCommandPool cp, World* w);
     void destroy();
 
+    // called while building the frame's draws, with the texture coordinate span of one screen pixel
+    void request(uint32_t texture, float uvPerPixel);
+
+    // Decides what to stream in and out and records the finished swaps. Returns true if any
+    // textureImageView changed.
+    bool recordStreaming(VkCommandBuffer commandBuffer, DeletionQueue& deletionQueue, uint64_t lastSubmission);
+
+    void setBudget(VkDeviceSize bytes);
+
+    const StreamedTexture& getTexture(uint32_t texture) const { return textures[texture]; }
+    const TextureStreamStats& getStats() const { return stats; }
+
 private:
-    void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
-    
-    void generateMipmaps(VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels);
-    void createTextureImage(const char* filename);
-    void createTextureImageView();
+    void createTextureImage(const TextureUpload& upload);
     void createTextureSampler();
-    
+
     void populateBuffers();
+
+    void createLevelsImage(const StreamedTexture& texture, uint32_t baseLevel, VkImage& image, VkDeviceMemory& memory, VkDeviceSize& size);
+    void createStagingBuffer(const TextureUpload& upload, VkBuffer& buffer, VkDeviceMemory& memory);
+    void recordUpload(VkCommandBuffer commandBuffer, VkImage image, const StreamedTexture& texture, const TextureUpload& upload, VkBuffer stagingBuffer);
+    void recordEviction(VkCommandBuffer commandBuffer, uint32_t index, uint32_t level, DeletionQueue& deletionQueue, uint64_t lastSubmission);
+    void replaceImage(uint32_t index, uint32_t level, VkImage image, VkDeviceMemory memory, VkDeviceSize size,
+                      DeletionQueue& deletionQueue, uint64_t lastSubmission);
+    bool evictLeastRecent(VkCommandBuffer commandBuffer, uint32_t keep, DeletionQueue& deletionQueue, uint64_t lastSubmission);
+
+    VkDeviceSize estimateSize(const StreamedTexture& texture, uint32_t baseLevel) const;
+    uint32_t desiredLevel(const StreamedTexture& texture) const;
+    void scheduleLoad(uint32_t index, uint32_t level);
+
+    static void decodeLevels(const std::string& path, TextureUpload& upload);
+    static std::vector<stbi_uc> downsample(const std::vector<stbi_uc>& pixels, uint32_t width, uint32_t height);
+
+    void enqueueTask(const std::function<void()>& task);
+    void run();
 };
 
 #endif
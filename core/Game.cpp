@@ -3,6 +3,25 @@
 #include <thread>
 #include <chrono>
 
+// build with -DBENCHMARK_PHYSICS to time the actor transform path, the scene graph, the contact
+// solver, the mesh collider, spatial queries and simulation tiers after the level loads
+#ifdef BENCHMARK_PHYSICS
+#include "Benchmark.h"
+#define BENCHMARK_TICKS 1000
+#endif
+
+// build with -DBENCHMARK_RENDERING to time draw recording across recording threads, frame hitches
+// while the window is resized, input latency per latency mode and frames in flight and GPU time per
+// shader variant, once the level has been drawn for a few frames and the render graph's memory reported
+#ifdef BENCHMARK_RENDERING
+#include "RenderBenchmark.h"
+#define BENCHMARK_WARMUP_FRAMES 60
+#define BENCHMARK_RECORD_REPEATS 200
+#define BENCHMARK_RESIZES 40
+#define BENCHMARK_LATENCY_FRAMES 300
+#define BENCHMARK_VARIANT_FRAMES 300
+#endif
+
 
 Game::Game()
 {
@@ -15,6 +34,15 @@ void Game::run()
     
     world.load(&audioManager);
     
+#ifdef BENCHMARK_PHYSICS
+    DEBUG_BenchmarkTransforms(world.getWorldActors(), BENCHMARK_TICKS);
+    DEBUG_BenchmarkSceneGraph(world.getWorldObjects().front(), BENCHMARK_TICKS);
+    DEBUG_BenchmarkContactSolver(world.getWorldObjects()[1], BENCHMARK_TICKS);
+    DEBUG_BenchmarkMeshCollider(BENCHMARK_TICKS);
+    DEBUG_BenchmarkSpatialQueries(world.getWorldActors(), world.getPlayerAsRef()->getWorldLocation(), BENCHMARK_TICKS);
+    DEBUG_BenchmarkSimulationLod(world.getWorldObjects()[1], BENCHMARK_TICKS);
+#endif
+    
     initWindow();
     initVulkan();
     
@@ -52,8 +80,28 @@ void Game::mainLoop()
     
     gameWindow.resetUpdateTimer();
     
+#ifdef BENCHMARK_RENDERING
+    auto frame = [this]()
+    {
+        vkManager.beginFrame();
+        gameWindow.update();
+        vkManager.draw();
+    };
+    
+    DEBUG_RunFrames(frame, BENCHMARK_WARMUP_FRAMES);
+    vkManager.renderPipeline.printGraphMemoryReport();
+    DEBUG_BenchmarkRecording(vkManager.renderPipeline, BENCHMARK_RECORD_REPEATS);
+    DEBUG_BenchmarkResize(gameWindow.window, vkManager.renderPipeline, frame, BENCHMARK_RESIZES);
+    DEBUG_BenchmarkLatency(vkManager.renderPipeline, frame, BENCHMARK_LATENCY_FRAMES);
+    DEBUG_BenchmarkShaderVariants(vkManager.renderPipeline, frame, BENCHMARK_VARIANT_FRAMES);
+    
+    gameWindow.resetUpdateTimer();
+#endif
+    
     while (!glfwWindowShouldClose(gameWindow.window))
     {
+        // wait for the frame slot first so the simulation runs on the freshest input
+        vkManager.beginFrame();
         gameWindow.update();
         vkManager.draw();
 //        std::this_thread::sleep_for(std::chrono::milliseconds(100));
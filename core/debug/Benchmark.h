@@ -0,0 +1,741 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "Actor.h"
+#include "SceneGraph.h"
+#include "ContactSolver.h"
+#include "Physics.h"
+#include "MeshCooker.h"
+#include "MeshCollider.h"
+#include "SpatialQuery.h"
+#include "SimulationLod.h"
+#include "TriggerTracker.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <chrono>
+#include <cfloat>
+#include <stdio.h>
+
+
+// an update followed by two collision pushes
+#define BENCHMARK_MOVES_PER_TICK 3
+#define BENCHMARK_ACTOR_COPIES 16
+
+// one chain, and many roots with a flat row of children each
+#define BENCHMARK_DEEP_LEVELS 256
+#define BENCHMARK_WIDE_ROOTS 16
+#define BENCHMARK_WIDE_CHILDREN 256
+
+#define BENCHMARK_CRATE_SCALE 4.f
+
+// brute force tests every triangle, so it only gets a handful of the queries
+#define BENCHMARK_BRUTE_FORCE_QUERIES 16
+
+#define BENCHMARK_RAY_BATCH 4096
+#define BENCHMARK_RAY_LENGTH 50.f
+
+// a square of crates resting on one floor around the player, far wider than the full tier
+#define BENCHMARK_LOD_CRATES_PER_SIDE 48
+#define BENCHMARK_LOD_SPACING 4.f
+
+
+glm::mat4 DEBUG_BuildModelMatrix(const glm::vec3& location, const glm::vec3& rotation, const glm::vec3& scale)
+{
+    glm::mat4 model = glm::translate(glm::mat4(1.f), location);
+
+    model = glm::rotate(model, glm::radians(rotation.z), glm::vec3(0, 0, 1));
+    model = glm::rotate(model, glm::radians(rotation.y), glm::vec3(0, 1, 0));
+    model = glm::rotate(model, glm::radians(rotation.x), glm::vec3(1, 0, 0));
+
+    return glm::scale(model, scale);
+}
+
+
+// what every move used to cost: eight corners on the heap and a full matrix build per corner
+BoundingBox DEBUG_UncachedBoundingBox(const Object& obj, const glm::vec3& location, const glm::vec3& rotation, const glm::vec3& scale)
+{
+    glm::vec3 min = obj.boundingBox.min;
+    glm::vec3 max = obj.boundingBox.max;
+
+    std::vector<glm::vec3> corners = {
+        glm::vec3(min.x, min.y, min.z), glm::vec3(max.x, min.y, min.z),
+        glm::vec3(min.x, max.y, min.z), glm::vec3(max.x, max.y, min.z),
+        glm::vec3(min.x, min.y, max.z), glm::vec3(max.x, min.y, max.z),
+        glm::vec3(min.x, max.y, max.z), glm::vec3(max.x, max.y, max.z)
+    };
+
+    BoundingBox box;
+    box.min = glm::vec3(FLT_MAX);
+    box.max = glm::vec3(-FLT_MAX);
+
+    for (const glm::vec3& corner : corners)
+    {
+        glm::vec3 transformed = glm::vec3(DEBUG_BuildModelMatrix(location, rotation, scale) * glm::vec4(corner, 1.f));
+
+        box.min = glm::min(box.min, transformed);
+        box.max = glm::max(box.max, transformed);
+    }
+
+    return box;
+}
+
+
+/**
+ * @brief Times the transform work of a physics tick, uncached against the actor's cached path.
+ *
+ * Runs on copies of the given actors. Each tick moves every actor BENCHMARK_MOVES_PER_TICK times,
+ * reads every pair's bounds as the collision loop does and reads each model matrix once as a draw.
+ */
+void DEBUG_BenchmarkTransforms(const std::vector<Actor*>& worldActors, uint32_t ticks)
+{
+    std::vector<Actor> actors;
+
+    for (uint32_t copy = 0; copy < BENCHMARK_ACTOR_COPIES; copy++)
+    {
+        for (const Actor* a : worldActors)
+        {
+            Transform t = { a->getWorldLocation() + glm::vec3(copy * 2.f, 0.f, 0.f), a->getWorldRotation() + glm::vec3(0.f, copy * 10.f, 0.f), a->getWorldScale() };
+            actors.emplace_back(a->getObject(), t);
+        }
+    }
+
+    const glm::vec3 step(0.01f, 0.f, 0.005f);
+    float checksum = 0.f;
+
+    std::vector<glm::vec3> locations(actors.size());
+    std::vector<BoundingBox> boxes(actors.size());
+
+    for (size_t i = 0; i < actors.size(); i++)
+    {
+        locations[i] = actors[i].getWorldLocation();
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    for (uint32_t tick = 0; tick < ticks; tick++)
+    {
+        for (size_t i = 0; i < actors.size(); i++)
+        {
+            for (uint32_t move = 0; move < BENCHMARK_MOVES_PER_TICK; move++)
+            {
+                locations[i] += step;
+                boxes[i] = DEBUG_UncachedBoundingBox(actors[i].getObject(), locations[i], actors[i].getWorldRotation(), actors[i].getWorldScale());
+            }
+        }
+
+        for (size_t i = 0; i < actors.size(); i++)
+        {
+            for (size_t j = 0; j < actors.size(); j++)
+            {
+                checksum += boxes[i].max.x - boxes[j].min.x;
+            }
+
+            checksum += DEBUG_BuildModelMatrix(locations[i], actors[i].getWorldRotation(), actors[i].getWorldScale())[3].x;
+        }
+    }
+
+    auto middle = std::chrono::high_resolution_clock::now();
+
+    for (uint32_t tick = 0; tick < ticks; tick++)
+    {
+        for (Actor& a : actors)
+        {
+            for (uint32_t move = 0; move < BENCHMARK_MOVES_PER_TICK; move++)
+            {
+                a.addActorLocation(step);
+            }
+        }
+
+        for (const Actor& a : actors)
+        {
+            for (const Actor& b : actors)
+            {
+                checksum += a.getBoundingBox().max.x - b.getBoundingBox().min.x;
+            }
+
+            checksum += a.getModelMatrix()[3].x;
+        }
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+
+    double uncached = std::chrono::duration<double, std::milli>(middle - start).count() / ticks;
+    double cached = std::chrono::duration<double, std::milli>(end - middle).count() / ticks;
+
+    printf("transform benchmark: %zu actors, %u ticks\n", actors.size(), ticks);
+    printf("  uncached %.4f ms/tick, cached %.4f ms/tick, %.1fx (checksum %f)\n", uncached, cached, uncached / cached, checksum);
+}
+
+
+// what syncing attachments by hand costs: every child rebuilds its whole chain up to the root
+glm::mat4 DEBUG_ChainMatrix(const Actor& a)
+{
+    glm::mat4 world = a.getLocalMatrix();
+
+    for (const Actor* p = a.getParent(); p != nullptr; p = p->getParent())
+    {
+        world = p->getLocalMatrix() * world;
+    }
+
+    return world;
+}
+
+
+/**
+ * @brief Times propagation through one hierarchy, rebuilt per child against the scene graph.
+ *
+ * Each tick either moves every root, so the whole hierarchy is dirty, or a single leaf.
+ */
+void DEBUG_BenchmarkHierarchy(const char* name, std::vector<Actor>& actors, const std::vector<Actor*>& roots, SceneGraph& sceneGraph, uint32_t ticks)
+{
+    const glm::vec3 step(0.01f, 0.f, 0.005f);
+    Actor& leaf = actors.back();
+    float checksum = 0.f;
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    for (uint32_t tick = 0; tick < ticks; tick++)
+    {
+        for (Actor* root : roots)
+        {
+            root->addActorLocation(step);
+        }
+
+        for (const Actor& a : actors)
+        {
+            checksum += DEBUG_ChainMatrix(a)[3].x;
+        }
+    }
+
+    auto handSynced = std::chrono::high_resolution_clock::now();
+
+    for (uint32_t tick = 0; tick < ticks; tick++)
+    {
+        for (Actor* root : roots)
+        {
+            root->addActorLocation(step);
+        }
+
+        sceneGraph.update();
+        checksum += leaf.getModelMatrix()[3].x;
+    }
+
+    auto rootsMoved = std::chrono::high_resolution_clock::now();
+
+    for (uint32_t tick = 0; tick < ticks; tick++)
+    {
+        leaf.addActorLocation(step);
+
+        sceneGraph.update();
+        checksum += leaf.getModelMatrix()[3].x;
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+
+    double manual = std::chrono::duration<double, std::milli>(handSynced - start).count() / ticks;
+    double full = std::chrono::duration<double, std::milli>(rootsMoved - handSynced).count() / ticks;
+    double single = std::chrono::duration<double, std::milli>(end - rootsMoved).count() / ticks;
+
+    printf("%s hierarchy: %u nodes, depth %u, %u ticks\n", name, sceneGraph.getStats().nodes, sceneGraph.getStats().depth, ticks);
+    printf("  hand synced %.4f ms/tick, graph with roots moved %.4f ms/tick, one leaf moved %.4f ms/tick (checksum %f)\n",
+           manual, full, single, checksum);
+}
+
+
+void DEBUG_BenchmarkSceneGraph(const Object& obj, uint32_t ticks)
+{
+    const Transform offset = { glm::vec3(0.f, 0.5f, 0.f), glm::vec3(0.f, 5.f, 0.f), glm::vec3(1.f) };
+
+    std::vector<Actor> deep;
+    std::vector<Actor*> deepRoots;
+    SceneGraph deepGraph;
+
+    deep.reserve(BENCHMARK_DEEP_LEVELS);
+
+    for (uint32_t level = 0; level < BENCHMARK_DEEP_LEVELS; level++)
+    {
+        Transform t = offset;
+        t.worldLocation.y *= level;
+        t.worldRotation.y *= level;
+
+        deep.emplace_back(obj, t);
+
+        if (level > 0)
+        {
+            deepGraph.attach(&deep[level], &deep[level - 1]);
+        }
+    }
+
+    deepRoots.push_back(&deep.front());
+    deepGraph.update();
+
+    DEBUG_BenchmarkHierarchy("deep", deep, deepRoots, deepGraph, ticks);
+
+    std::vector<Actor> wide;
+    std::vector<Actor*> wideRoots;
+    SceneGraph wideGraph;
+
+    wide.reserve(BENCHMARK_WIDE_ROOTS * (BENCHMARK_WIDE_CHILDREN + 1));
+
+    for (uint32_t root = 0; root < BENCHMARK_WIDE_ROOTS; root++)
+    {
+        Transform t = offset;
+        t.worldLocation.x = root * 4.f;
+
+        wide.emplace_back(obj, t);
+        wideRoots.push_back(&wide.back());
+
+        for (uint32_t child = 0; child < BENCHMARK_WIDE_CHILDREN; child++)
+        {
+            t.worldLocation.z = child * 0.1f;
+
+            wide.emplace_back(obj, t);
+            wideGraph.attach(&wide.back(), wideRoots.back());
+        }
+    }
+
+    wideGraph.update();
+
+    DEBUG_BenchmarkHierarchy("wide", wide, wideRoots, wideGraph, ticks);
+}
+
+
+// Drops a stack of crates on a floor and lets it settle, returning the solve time per iteration
+void DEBUG_RunCrateStack(const Object& crate, uint32_t height, uint32_t iterations, bool warmStarting, uint32_t ticks)
+{
+    float size = (crate.boundingBox.max.y - crate.boundingBox.min.y) * BENCHMARK_CRATE_SCALE;
+
+    std::vector<Actor> actors;
+    actors.reserve(height + 1);
+
+    // the crate mesh flattened into a floor whose top is at 0
+    float floorScale = 10.f * BENCHMARK_CRATE_SCALE;
+    float floorHalfHeight = (crate.boundingBox.max.y - crate.boundingBox.min.y) * 0.5f * floorScale;
+    Transform floor = { glm::vec3(0.f, -floorHalfHeight, 0.f), glm::vec3(0.f), glm::vec3(floorScale) };
+    actors.emplace_back(crate, floor);
+
+    for (uint32_t level = 0; level < height; level++)
+    {
+        Transform t = { glm::vec3(0.f, size * (level + 0.5f), 0.f), glm::vec3(0.f), glm::vec3(BENCHMARK_CRATE_SCALE) };
+
+        actors.emplace_back(crate, t);
+        actors.back().setPhysicsEnabled(true);
+        actors.back().setCollider({ CS_OBB });
+    }
+
+    std::vector<Actor*> pointers;
+
+    for (Actor& a : actors)
+    {
+        pointers.push_back(&a);
+    }
+
+    CollisionLayerMatrix layers;
+    Broadphase broadphase;
+    ContactSolver solver;
+
+    solver.setIterations(iterations);
+    solver.setWarmStarting(warmStarting);
+
+    float startHeight = actors.back().getWorldLocation().y;
+    double solveMilliseconds = 0.0;
+
+    for (uint32_t tick = 0; tick < ticks; tick++)
+    {
+        for (Actor* a : pointers)
+        {
+            a->update(PHYSICS_DELTA_TIME);
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+        broadphase.build(pointers, layers);
+        solver.solve(broadphase, PHYSICS_DELTA_TIME);
+        auto end = std::chrono::high_resolution_clock::now();
+
+        solveMilliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+
+        solver.integrate(pointers, broadphase, layers, PHYSICS_DELTA_TIME);
+    }
+
+    const ContactSolverStats& stats = solver.getStats();
+    float firstResidual = stats.residuals.empty() ? 0.f : stats.residuals.front();
+    float lastResidual = stats.residuals.empty() ? 0.f : stats.residuals.back();
+
+    printf("  %2u crates, %2u iterations, warm start %s: %.5f ms/iteration, residual %.4f -> %.4f, penetration %.4f, top drift %.4f, %u/%u warm\n",
+           height, iterations, warmStarting ? "on " : "off", solveMilliseconds / ticks / std::max(iterations, 1u),
+           firstResidual, lastResidual, stats.maxPenetration, std::abs(actors.back().getWorldLocation().y - startHeight),
+           stats.warmStarted, stats.contacts);
+}
+
+
+/**
+ * @brief Settles crate stacks of a few heights and reports how far the solver converged.
+ *
+ * The residual is the impulse the first and last iterations of the final tick still changed,
+ * a settled stack drives the last one towards zero. Drift is how far the top crate sank.
+ */
+void DEBUG_BenchmarkContactSolver(const Object& crate, uint32_t ticks)
+{
+    const uint32_t heights[] = { 4, 8, 16 };
+    const uint32_t iterationCounts[] = { 4, 8, 16 };
+
+    printf("contact solver benchmark: %u ticks\n", ticks);
+
+    for (uint32_t height : heights)
+    {
+        for (uint32_t iterations : iterationCounts)
+        {
+            DEBUG_RunCrateStack(crate, height, iterations, true, ticks);
+        }
+
+        DEBUG_RunCrateStack(crate, height, CONTACT_SOLVER_ITERATIONS, false, ticks);
+    }
+}
+
+
+// a bumpy square grid of quads two triangles each, one unit apart
+Object DEBUG_BuildTerrain(uint32_t quads)
+{
+    Object terrain{};
+    terrain.texture = nullptr;
+
+    for (uint32_t z = 0; z <= quads; z++)
+    {
+        for (uint32_t x = 0; x <= quads; x++)
+        {
+            Vertex vertex{};
+            vertex.pos = glm::vec3(x, std::sin(x * 0.3f) * std::cos(z * 0.2f), z);
+            terrain.vertices.push_back(vertex);
+        }
+    }
+
+    for (uint32_t z = 0; z < quads; z++)
+    {
+        for (uint32_t x = 0; x < quads; x++)
+        {
+            uint32_t corner = z * (quads + 1) + x;
+
+            terrain.indices.insert(terrain.indices.end(), { corner, corner + quads + 1, corner + 1 });
+            terrain.indices.insert(terrain.indices.end(), { corner + 1, corner + quads + 1, corner + quads + 2 });
+        }
+    }
+
+    terrain.boundingBox = generateBoundingBox(terrain.vertices);
+
+    return terrain;
+}
+
+
+// Capsules and boxes dropped into terrains of growing size, through the BVH and against every
+// triangle, which is what finding the deepest contact costs without one.
+void DEBUG_BenchmarkMeshCollider(uint32_t ticks)
+{
+    printf("mesh collider, %u queries per shape\n", ticks);
+
+    glm::mat4 model(1.f);
+
+    for (uint32_t quads : { 64u, 256u, 512u })
+    {
+        Object terrain = DEBUG_BuildTerrain(quads);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        MeshCooker::buildBvh(terrain.vertices, terrain.indices, terrain.bvhNodes, terrain.bvhTriangles);
+        auto end = std::chrono::high_resolution_clock::now();
+
+        double buildMilliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+
+        WorldCollider mesh;
+        mesh.shape = CS_MESH;
+        mesh.mesh = &terrain;
+        mesh.model = model;
+        mesh.min = terrain.boundingBox.min;
+        mesh.max = terrain.boundingBox.max;
+
+        // the same spots every run, each sunk a little into the surface
+        std::vector<WorldCollider> capsules;
+        std::vector<WorldCollider> boxes;
+        uint32_t seed = 12345;
+
+        for (uint32_t i = 0; i < ticks; i++)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            float x = (seed >> 8) % (quads * 100) / 100.f;
+            seed = seed * 1664525u + 1013904223u;
+            float z = (seed >> 8) % (quads * 100) / 100.f;
+
+            glm::vec3 center(x, std::sin(x * 0.3f) * std::cos(z * 0.2f) + 0.2f, z);
+
+            WorldCollider capsule;
+            capsule.shape = CS_CAPSULE;
+            capsule.radius = 0.25f;
+            capsule.segmentStart = center;
+            capsule.segmentEnd = center + glm::vec3(0.f, 0.5f, 0.f);
+            capsule.center = center + glm::vec3(0.f, 0.25f, 0.f);
+            capsule.min = center - glm::vec3(0.25f);
+            capsule.max = capsule.segmentEnd + glm::vec3(0.25f);
+            capsules.push_back(capsule);
+
+            WorldCollider box;
+            box.center = center;
+            box.halfExtents = glm::vec3(0.4f);
+            box.min = center - box.halfExtents;
+            box.max = center + box.halfExtents;
+            boxes.push_back(box);
+        }
+
+        uint32_t contacts = 0;
+        BasicCollisionResponse contact;
+
+        start = std::chrono::high_resolution_clock::now();
+
+        for (const WorldCollider& capsule : capsules)
+        {
+            contacts += MeshCollider::collideCapsule(capsule, mesh, contact);
+        }
+
+        end = std::chrono::high_resolution_clock::now();
+        double capsuleMicroseconds = std::chrono::duration<double, std::micro>(end - start).count() / ticks;
+
+        start = std::chrono::high_resolution_clock::now();
+
+        for (const WorldCollider& box : boxes)
+        {
+            contacts += MeshCollider::collideBox(box, mesh, contact);
+        }
+
+        end = std::chrono::high_resolution_clock::now();
+        double boxMicroseconds = std::chrono::duration<double, std::micro>(end - start).count() / ticks;
+
+        // the deepest contact has to match the brute force one
+        uint32_t bruteQueries = std::min(ticks, static_cast<uint32_t>(BENCHMARK_BRUTE_FORCE_QUERIES));
+        uint32_t mismatches = 0;
+
+        start = std::chrono::high_resolution_clock::now();
+
+        for (uint32_t i = 0; i < bruteQueries; i++)
+        {
+            bool hit = false;
+            float deepest = 0.f;
+
+            for (uint32_t t = 0; t < terrain.indices.size() / 3; t++)
+            {
+                glm::vec3 corners[3];
+                MeshCollider::getTriangle(mesh, t, corners);
+
+                if (MeshCollider::collideCapsuleTriangle(capsules[i], corners, contact) && (!hit || contact.penetrationDepth > deepest))
+                {
+                    deepest = contact.penetrationDepth;
+                    hit = true;
+                }
+            }
+
+            bool traversed = MeshCollider::collideCapsule(capsules[i], mesh, contact);
+
+            if (hit != traversed || (hit && std::abs(deepest - contact.penetrationDepth) > 1e-5f))
+            {
+                mismatches++;
+            }
+        }
+
+        end = std::chrono::high_resolution_clock::now();
+        double bruteMicroseconds = std::chrono::duration<double, std::micro>(end - start).count() / std::max(bruteQueries, 1u);
+
+        printf("  %7zu triangles: bvh %zu nodes built in %.2f ms, capsule %.2f us, box %.2f us, brute force capsule %.1f us, %u/%u contacts, %u mismatches\n",
+               terrain.indices.size() / 3, terrain.bvhNodes.size(), buildMilliseconds, capsuleMicroseconds, boxMicroseconds,
+               bruteMicroseconds, contacts, ticks * 2, mismatches);
+    }
+}
+
+
+// Batches of rays fanned out from the player over the loaded level, as gameplay code would cast
+// them for line of sight or picking, along with a proximity overlap per batch.
+void DEBUG_BenchmarkSpatialQueries(const std::vector<Actor*>& worldActors, const glm::vec3& origin, uint32_t batches)
+{
+    CollisionLayerMatrix layers;
+    Broadphase broadphase;
+
+    broadphase.build(worldActors, layers);
+
+    std::vector<Ray> rays;
+    uint32_t seed = 12345;
+
+    for (uint32_t i = 0; i < BENCHMARK_RAY_BATCH; i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        float yaw = (seed >> 8) % 36000 / 100.f;
+        seed = seed * 1664525u + 1013904223u;
+        float pitch = (seed >> 8) % 9000 / 100.f - 60.f;
+
+        glm::vec3 direction(std::cos(glm::radians(pitch)) * std::cos(glm::radians(yaw)), std::sin(glm::radians(pitch)),
+                            std::cos(glm::radians(pitch)) * std::sin(glm::radians(yaw)));
+
+        rays.push_back({ origin, direction, BENCHMARK_RAY_LENGTH });
+    }
+
+    std::vector<RaycastHit> hits;
+    std::vector<Actor*> nearby;
+    QueryFilter filter;
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    for (uint32_t batch = 0; batch < batches; batch++)
+    {
+        SpatialQuery::raycastBatch(broadphase, rays, filter, hits);
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    double rayMilliseconds = std::chrono::duration<double, std::milli>(end - start).count() / batches;
+
+    start = std::chrono::high_resolution_clock::now();
+
+    for (uint32_t batch = 0; batch < batches; batch++)
+    {
+        nearby.clear();
+        SpatialQuery::overlapSphere(broadphase, origin, 5.f, filter, nearby);
+    }
+
+    end = std::chrono::high_resolution_clock::now();
+    double overlapMicroseconds = std::chrono::duration<double, std::micro>(end - start).count() / batches;
+
+    uint32_t hitCount = 0;
+
+    for (const RaycastHit& hit : hits)
+    {
+        hitCount += hit.actor != nullptr;
+    }
+
+    printf("spatial queries over %u proxies: %u rays in %.3f ms (%u hit), 5 m sphere overlap in %.2f us (%zu actors)\n",
+           broadphase.getStats().proxies, BENCHMARK_RAY_BATCH, rayMilliseconds, hitCount, overlapMicroseconds, nearby.size());
+}
+
+
+// Ticks the world's physics over a set of actors the way World::update runs it. Trigger enters and
+// exits after the first tick are counted as flaps, nothing in the level moves in or out of a trigger.
+double DEBUG_RunLodTicks(std::vector<Actor*>& actors, SimulationLod& lod, uint32_t ticks, uint32_t& stepped, uint32_t& flaps, float& warmStarted)
+{
+    CollisionLayerMatrix layers;
+    Broadphase broadphase;
+    ContactSolver solver;
+    TriggerTracker triggers;
+
+    stepped = 0;
+    flaps = 0;
+
+    uint32_t contacts = 0;
+    uint32_t warmContacts = 0;
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    for (uint32_t tick = 0; tick < ticks; tick++)
+    {
+        lod.assign(actors, glm::vec3(0.f));
+        stepped += lod.getStats().stepped;
+
+        for (Actor* a : actors)
+        {
+            if (a->getSimulationScale() > 0.f)
+            {
+                a->update(PHYSICS_DELTA_TIME * a->getSimulationScale());
+            }
+        }
+
+        broadphase.build(actors, layers);
+        solver.solve(broadphase, PHYSICS_DELTA_TIME);
+
+        triggers.update(broadphase);
+        triggers.dispatch();
+
+        solver.integrate(actors, broadphase, layers, PHYSICS_DELTA_TIME);
+
+        if (tick > 0)
+        {
+            flaps += triggers.getStats().entered + triggers.getStats().exited;
+            contacts += solver.getStats().contacts;
+            warmContacts += solver.getStats().warmStarted;
+        }
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+
+    warmStarted = contacts > 0 ? static_cast<float>(warmContacts) / contacts : 0.f;
+
+    return std::chrono::duration<double, std::milli>(end - start).count() / ticks;
+}
+
+
+// A big level of crates at rest around the player, ticked with every actor at full rate and
+// then with simulation tiers. Reports the cost per tick and how far the crates sank, which
+// stays at the solver's slop if reduced ticking keeps them on the floor. A trigger volume
+// covers every crate, so reduced crates losing their overlap between steps shows up as flaps,
+// and losing their cached contacts as a lower warm started share.
+void DEBUG_BenchmarkSimulationLod(const Object& crate, uint32_t ticks)
+{
+    float size = (crate.boundingBox.max.y - crate.boundingBox.min.y) * BENCHMARK_CRATE_SCALE;
+    float extent = BENCHMARK_LOD_CRATES_PER_SIDE * BENCHMARK_LOD_SPACING;
+
+    printf("simulation lod, %u crates over %.0f m\n", BENCHMARK_LOD_CRATES_PER_SIDE * BENCHMARK_LOD_CRATES_PER_SIDE, extent);
+
+    for (bool enabled : { false, true })
+    {
+        std::vector<Actor> actors;
+        actors.reserve(BENCHMARK_LOD_CRATES_PER_SIDE * BENCHMARK_LOD_CRATES_PER_SIDE + 2);
+
+        // the crate mesh flattened into a floor under the whole square, top at 0
+        float floorScale = (extent + size) / (crate.boundingBox.max.x - crate.boundingBox.min.x);
+        float floorHalfHeight = (crate.boundingBox.max.y - crate.boundingBox.min.y) * 0.5f * BENCHMARK_CRATE_SCALE;
+        Transform floor = { glm::vec3(0.f, -floorHalfHeight, 0.f), glm::vec3(0.f), glm::vec3(floorScale, BENCHMARK_CRATE_SCALE, floorScale) };
+        actors.emplace_back(crate, floor);
+
+        // as wide as the floor and as tall as a crate, around every crate at once
+        Transform volume = { glm::vec3(0.f, size * 0.5f, 0.f), glm::vec3(0.f), glm::vec3(floorScale, BENCHMARK_CRATE_SCALE, floorScale) };
+        actors.emplace_back(crate, volume);
+
+        Collider trigger;
+        trigger.trigger = true;
+        actors.back().setCollider(trigger);
+
+        for (uint32_t x = 0; x < BENCHMARK_LOD_CRATES_PER_SIDE; x++)
+        {
+            for (uint32_t z = 0; z < BENCHMARK_LOD_CRATES_PER_SIDE; z++)
+            {
+                glm::vec3 location((x + 0.5f) * BENCHMARK_LOD_SPACING - extent * 0.5f, size * 0.5f, (z + 0.5f) * BENCHMARK_LOD_SPACING - extent * 0.5f);
+                Transform t = { location, glm::vec3(0.f), glm::vec3(BENCHMARK_CRATE_SCALE) };
+
+                actors.emplace_back(crate, t);
+                actors.back().setPhysicsEnabled(true);
+                actors.back().setCollider({ CS_OBB });
+            }
+        }
+
+        std::vector<Actor*> pointers;
+
+        for (Actor& a : actors)
+        {
+            pointers.push_back(&a);
+        }
+
+        SimulationLod lod;
+        lod.setEnabled(enabled);
+
+        uint32_t stepped;
+        uint32_t flaps;
+        float warmStarted;
+        double milliseconds = DEBUG_RunLodTicks(pointers, lod, ticks, stepped, flaps, warmStarted);
+
+        float deepest = 0.f;
+
+        // past the floor and the trigger volume
+        for (size_t i = 2; i < actors.size(); i++)
+        {
+            deepest = std::max(deepest, size * 0.5f - actors[i].getWorldLocation().y);
+        }
+
+        const SimulationLodStats& stats = lod.getStats();
+
+        printf("  tiers %s: %.3f ms/tick, %.0f actors stepped per tick, %u full, %u reduced, %u frozen, deepest sink %.4f, %u trigger flaps, %.0f%% contacts warm started\n",
+               enabled ? "on " : "off", milliseconds, static_cast<double>(stepped) / ticks, stats.full, stats.reduced, stats.frozen, deepest,
+               flaps, warmStarted * 100.f);
+    }
+}
+
+
+#endif
@@ -0,0 +1,213 @@
+#ifndef RENDERBENCHMARK_H
+#define RENDERBENCHMARK_H
+
+#include "RenderPipeline.h"
+#include <functional>
+#include <thread>
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+
+
+// draw counts the recording sweep is run at, the shipped level only has a handful of dynamic draws
+#define BENCHMARK_RECORD_DRAWS { 64, 256, 1024, 4096 }
+
+// the window alternates between its size and this fraction of it
+#define BENCHMARK_RESIZE_SCALE 0.75f
+#define BENCHMARK_FRAMES_PER_RESIZE 8
+
+// frames run after a latency mode or frames in flight change before latency is measured, so the previous queue drains
+#define BENCHMARK_LATENCY_SETTLE_FRAMES 30
+
+// shader variants compared against the default one, as dither steps, grain and time of day
+#define BENCHMARK_SHADER_VARIANTS { { 0, true, 2.5f }, { 6, false, 2.5f }, { 0, false, 2.5f }, { 6, true, -1.f } }
+
+
+void DEBUG_RunFrames(const std::function<void()>& frame, uint32_t frames)
+{
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        frame();
+    }
+}
+
+
+/**
+ * @brief Times scene draw recording with one recording thread up to as many as the renderer starts with.
+ *
+ * The last frame's draws are repeated up to each draw count, so the sweep shows both how recording
+ * scales with threads and the draw count below which splitting does not pay off. The thread count
+ * the renderer had is restored afterwards.
+ */
+void DEBUG_BenchmarkRecording(RenderPipeline& pipeline, uint32_t repeats)
+{
+    uint32_t previousThreads = pipeline.getRecordThreadCount();
+    uint32_t maxThreads = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+    printf("draw recording, %u repeats, up to %u threads, %u draws per thread minimum\n", repeats, maxThreads, MIN_DRAWS_PER_THREAD);
+
+    for (size_t draws : BENCHMARK_RECORD_DRAWS)
+    {
+        double single = 0.0;
+
+        printf("  %5zu draws:", draws);
+
+        for (uint32_t threads = 1; ; threads = std::min(threads * 2, maxThreads))
+        {
+            pipeline.setRecordThreadCount(threads);
+            double milliseconds = pipeline.timeRecording(draws, repeats);
+
+            if (threads == 1)
+            {
+                single = milliseconds;
+            }
+
+            printf("  %u: %.3f ms (%.2fx)", threads, milliseconds, milliseconds > 0.0 ? single / milliseconds : 0.0);
+
+            if (threads == maxThreads)
+            {
+                break;
+            }
+        }
+
+        printf("\n");
+    }
+
+    pipeline.setRecordThreadCount(previousThreads);
+}
+
+
+/**
+ * @brief Resizes the window back and forth and reports the worst frame time while the swap chain was recreated.
+ *
+ * A frame counts as a recreation frame if it recreated the swap chain or follows one, since the
+ * render graph is rebuilt when the next frame is recorded. The other frames give the steady cost
+ * to compare against. The window gets its original size back afterwards.
+ */
+void DEBUG_BenchmarkResize(GLFWwindow* window, RenderPipeline& pipeline, const std::function<void()>& frame, uint32_t resizes)
+{
+    int width, height;
+    glfwGetWindowSize(window, &width, &height);
+
+    uint32_t firstRecreate = pipeline.getRecreateCount();
+    uint32_t recreatedFrames = 0;
+    uint32_t steadyFrames = 0;
+    double worstRecreateFrame = 0.0;
+    double worstSteadyFrame = 0.0;
+    double steadyTotal = 0.0;
+
+    for (uint32_t i = 0; i <= resizes; i++)
+    {
+        float scale = (i % 2 == 0 && i < resizes) ? BENCHMARK_RESIZE_SCALE : 1.f;
+        glfwSetWindowSize(window, static_cast<int>(width * scale), static_cast<int>(height * scale));
+
+        bool followsRecreate = false;
+
+        for (uint32_t f = 0; f < BENCHMARK_FRAMES_PER_RESIZE; f++)
+        {
+            uint32_t recreates = pipeline.getRecreateCount();
+
+            auto start = std::chrono::high_resolution_clock::now();
+            frame();
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+            bool recreated = pipeline.getRecreateCount() != recreates;
+
+            if (recreated || followsRecreate)
+            {
+                worstRecreateFrame = std::max(worstRecreateFrame, elapsed.count());
+                recreatedFrames++;
+            }
+            else
+            {
+                worstSteadyFrame = std::max(worstSteadyFrame, elapsed.count());
+                steadyTotal += elapsed.count();
+                steadyFrames++;
+            }
+
+            followsRecreate = recreated;
+        }
+    }
+
+    printf("swap chain resize, %u resizes: %u recreations, worst recreation frame %.2f ms over %u frames, steady %.2f ms average, %.2f ms worst, worst recreate call %.2f ms\n",
+           resizes, pipeline.getRecreateCount() - firstRecreate, worstRecreateFrame, recreatedFrames,
+           steadyFrames > 0 ? steadyTotal / steadyFrames : 0.0, worstSteadyFrame, pipeline.getWorstRecreateTime());
+}
+
+
+/**
+ * @brief Runs each latency mode at every frames in flight count and reports its input to present latency.
+ *
+ * Latency runs from the input sample a frame simulated with until the frame is handed to
+ * presentation. The mode and frames in flight the renderer had are restored afterwards.
+ */
+void DEBUG_BenchmarkLatency(RenderPipeline& pipeline, const std::function<void()>& frame, uint32_t frames)
+{
+    LatencyMode previousMode = pipeline.getLatencyMode();
+    uint32_t previousFramesInFlight = pipeline.getFramesInFlight();
+    const char* names[] = { "throughput", "low latency", "uncapped" };
+
+    printf("input to present latency, %u frames per mode\n", frames);
+
+    for (LatencyMode mode : { LM_THROUGHPUT, LM_LOW_LATENCY, LM_UNCAPPED })
+    {
+        pipeline.setLatencyMode(mode);
+
+        for (uint32_t framesInFlight = 1; framesInFlight <= pipeline.getMaxFramesInFlight(); framesInFlight++)
+        {
+            pipeline.setFramesInFlight(framesInFlight);
+            DEBUG_RunFrames(frame, BENCHMARK_LATENCY_SETTLE_FRAMES);
+
+            pipeline.resetLatencyStats();
+            DEBUG_RunFrames(frame, frames);
+
+            printf("  %-11s, %u in flight: %.2f ms average, %.2f ms worst\n", names[mode], framesInFlight,
+                   pipeline.getInputLatency(), pipeline.getWorstInputLatency());
+        }
+    }
+
+    pipeline.setLatencyMode(previousMode);
+    pipeline.setFramesInFlight(previousFramesInFlight);
+}
+
+
+/**
+ * @brief Draws the level under the default shader variant and each benchmarked one, then prints the GPU time per variant.
+ *
+ * Frames are timed under the variant they were recorded with, so the first frames after a switch,
+ * which also build the variant's pipelines, are counted against it. The variant the renderer had
+ * is restored afterwards.
+ */
+void DEBUG_BenchmarkShaderVariants(RenderPipeline& pipeline, const std::function<void()>& frame, uint32_t frames)
+{
+    struct VariantSettings
+    {
+        uint32_t ditherSteps;
+        bool grain;
+        float timeOfDay;
+    };
+
+    ShaderVariant previousVariant = pipeline.getShaderVariant();
+
+    pipeline.setShaderVariant(ShaderVariant{});
+    DEBUG_RunFrames(frame, frames);
+
+    for (const VariantSettings& settings : std::initializer_list<VariantSettings> BENCHMARK_SHADER_VARIANTS)
+    {
+        ShaderVariant variant;
+        variant.ditherSteps = settings.ditherSteps;
+        variant.grain = settings.grain;
+        variant.timeOfDay = settings.timeOfDay;
+
+        pipeline.setShaderVariant(variant);
+        DEBUG_RunFrames(frame, frames);
+    }
+
+    printf("shader variants, %u frames each\n", frames);
+    pipeline.printVariantTimings();
+
+    pipeline.setShaderVariant(previousVariant);
+}
+
+
+#endif
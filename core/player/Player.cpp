@@ -1,4 +1,5 @@
 #include "Player.h"
+#include "CollisionConstants.h"
 
 #include <iostream>
 #define GLM_FORCE_RADIANS
@@ -12,9 +13,15 @@
 //#define RIGHT_VECTOR glm::vec3(1, 0, 0)
 
 
-Player::Player(const Object& o, const Transform& t) : Actor(o, t)
+Player::Player(const Object& o, const Transform& t) : Actor(o, t, CL_PLAYER)
 {
     setPhysicsEnabled(true);
+    setCollider({ CS_CAPSULE, PLAYER_COLLISION_RADIUS, PLAYER_COLLISION_HALF_HEIGHT });
+    
+    // the input sets the speed every tick, friction would only fight it
+    CollisionSurface surface;
+    surface.friction = 0.f;
+    setCollisionSurface(surface);
 }
 
 void Player::setViewMatrix(const glm::mat4& vm)
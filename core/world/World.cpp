@@ -1,6 +1,5 @@
 #include "World.h"
 #include "Frustum.h"
-#include "CollisionManager.h"
 #include <GLFW/glfw3.h>
 
 
@@ -18,8 +17,10 @@ World::~World()
     worldActors.clear();
 }
 
-void World::load(AudioManager* audioManager)
+void World::load(AudioManager* am)
 {
+    audioManager = am;
+    
     Transform t;
     Object o;
     
@@ -78,39 +79,71 @@ void World::load(AudioManager* audioManager)
     t = { glm::vec3(-3.f, -1.f, -4.f), glm::vec3(0.f, 0.f, 0.f), glm::vec3(5.f, 5.f, 5.f) };
     o = loadObject("res/models/big_floor.obj", "res/textures/floor/grass2.jpg");
     
-    createActor(o, t);
+    // level geometry collides as its triangles, the space under the arches is open
+    createActor(o, t)->setCollider({ CS_MESH });
     
     /*--------------*/
     
     
     o = loadObject("res/models/arch.obj", "res/textures/floor/cobblestone2.jpg");
     
-    createActor(o, t);
-    createActor(o, t)->addActorLocation(glm::vec3(0, 0, -8.5));
+    createActor(o, t)->setCollider({ CS_MESH });
+    
+    Actor* arch = createActor(o, t);
+    arch->addActorLocation(glm::vec3(0, 0, -8.5));
+    arch->setCollider({ CS_MESH });
     /*--------------*/
     
     
     for (Actor* actor : worldActors)
     {
         actor->setAudioManager(audioManager);
+        
+        // the crates collide as their own box, which stays tight when they are rotated
+        if (actor != player && actor->getPhysicsEnabled())
+        {
+            actor->setCollider({ CS_OBB });
+        }
     }
 }
 
 void World::update(const double deltaTime)
 {
-    // update actors
+    simulationLod.assign(worldActors, player->getWorldLocation());
+    
     for (Actor* actor : worldActors)
     {
-        if (actor->getActive())
+        actor->storePreviousLocation();
+    }
+    
+    // update actors, far ones less often with longer steps
+    for (Actor* actor : worldActors)
+    {
+        if (actor->getActive() && actor->getSimulationScale() > 0.f)
         {
-            collideWorldActors(player->getWorldLocation(), worldActors);
-            actor->update(deltaTime);
+            actor->update(deltaTime * actor->getSimulationScale());
         }
     }
     
-    collideWorldActors(player->getWorldLocation(), worldActors);
-    player->movePlayerWithInput();
+    // the build is the only write to the broadphase, queries made from collision callbacks still get in
+    {
+        std::unique_lock<std::shared_mutex> lock(queryMutex);
+        broadphase.build(worldActors, collisionLayers);
+    }
+    
+    contactSolver.solve(broadphase, deltaTime);
+    
+    triggerTracker.update(broadphase);
+    triggerTracker.dispatch();
+    
+    contactSolver.integrate(worldActors, broadphase, collisionLayers, deltaTime);
+    
 //    frustumCullActors(player, worldActors);
+    
+    // attached actors follow whatever their parents did this tick
+    sceneGraph.update();
+    
+    flushDestroyedActors();
 }
 
 Player* World::getPlayerAsRef()
@@ -129,3 +162,124 @@ Actor* World::createActor(const Object& obj, const Transform& transform)
     
     return worldActors.back();
 }
+
+Actor* World::spawnActor(const Object& obj, const Transform& transform)
+{
+    Actor* actor = createActor(obj, transform);
+    actor->setAudioManager(audioManager);
+    
+    return actor;
+}
+
+void World::destroyActor(Actor* actor)
+{
+    if (actor == player)
+    {
+        throw std::runtime_error("failed to destroy actor, the player cannot be despawned!");
+    }
+    
+    if (std::find(pendingDestroy.begin(), pendingDestroy.end(), actor) == pendingDestroy.end())
+    {
+        pendingDestroy.push_back(actor);
+    }
+    
+    // attached actors go with their parent
+    for (Actor* descendant : sceneGraph.getDescendants(actor))
+    {
+        if (std::find(pendingDestroy.begin(), pendingDestroy.end(), descendant) == pendingDestroy.end())
+        {
+            pendingDestroy.push_back(descendant);
+        }
+    }
+}
+
+void World::attachActor(Actor* child, Actor* parent)
+{
+    if (child == player)
+    {
+        throw std::runtime_error("failed to attach actor, the player cannot be attached!");
+    }
+    
+    child->setPhysicsEnabled(false);
+    child->removeCollisionPartners();
+    
+    sceneGraph.attach(child, parent);
+    sceneGraph.update();
+}
+
+void World::detachActor(Actor* child)
+{
+    sceneGraph.detach(child);
+    sceneGraph.update();
+}
+
+void World::flushDestroyedActors()
+{
+    if (pendingDestroy.empty())
+    {
+        return;
+    }
+    
+    // no query may hand out an actor while it is being deleted
+    std::unique_lock<std::shared_mutex> lock(queryMutex);
+    
+    for (Actor* actor : pendingDestroy)
+    {
+        auto it = std::find(worldActors.begin(), worldActors.end(), actor);
+        
+        if (it == worldActors.end())
+        {
+            continue;
+        }
+        
+        actor->removeCollisionPartners();
+        sceneGraph.remove(actor);
+        contactSolver.forget(actor);
+        broadphase.forget(actor);
+        triggerTracker.forget(actor);
+        worldActors.erase(it);
+        
+        despawnedActors.push_back({actor, actor->getMeshId()});
+        delete actor;
+    }
+    
+    pendingDestroy.clear();
+}
+
+bool World::raycast(const Ray& ray, RaycastHit& hit, const QueryFilter& filter) const
+{
+    std::shared_lock<std::shared_mutex> lock(queryMutex);
+    return SpatialQuery::raycast(broadphase, ray, filter, hit);
+}
+
+void World::raycastBatch(const std::vector<Ray>& rays, std::vector<RaycastHit>& hits, const QueryFilter& filter) const
+{
+    std::shared_lock<std::shared_mutex> lock(queryMutex);
+    SpatialQuery::raycastBatch(broadphase, rays, filter, hits);
+}
+
+void World::overlapSphere(const glm::vec3& center, float radius, std::vector<Actor*>& actors, const QueryFilter& filter) const
+{
+    std::shared_lock<std::shared_mutex> lock(queryMutex);
+    SpatialQuery::overlapSphere(broadphase, center, radius, filter, actors);
+}
+
+void World::overlapBox(const glm::vec3& min, const glm::vec3& max, std::vector<Actor*>& actors, const QueryFilter& filter) const
+{
+    std::shared_lock<std::shared_mutex> lock(queryMutex);
+    SpatialQuery::overlapBox(broadphase, min, max, filter, actors);
+}
+
+bool World::sweepBox(const glm::vec3& min, const glm::vec3& max, const glm::vec3& displacement, SweepHit& hit, const QueryFilter& filter) const
+{
+    std::shared_lock<std::shared_mutex> lock(queryMutex);
+    return SpatialQuery::sweepBox(broadphase, min, max, displacement, filter, hit);
+}
+
+std::vector<DespawnedActor> World::takeDespawnedActors()
+{
+    std::vector<DespawnedActor> despawned = std::move(despawnedActors);
+    despawnedActors.clear();
+    
+    return despawned;
+}
@@ -3,14 +3,46 @@
 
 #include "Actor.h"
 #include "Player.h"
+#include "SceneGraph.h"
+#include "SimulationLod.h"
+#include "Broadphase.h"
+#include "ContactSolver.h"
+#include "SpatialQuery.h"
+#include "TriggerTracker.h"
+#include "CollisionLayers.h"
 #include "AudioManager.h"
 
+#include <shared_mutex>
+
+
+// the pointer is only an identity here, the actor has already been deleted
+struct DespawnedActor
+{
+    const Actor* actor;
+    int32_t meshId;
+};
+
 
 class World {
 private:
     Player* player;
+    AudioManager* audioManager;
     std::vector<Actor*> worldActors;
     std::vector<const Object> worldObjects;
+    SceneGraph sceneGraph;
+    SimulationLod simulationLod;
+    
+    Broadphase broadphase;
+    ContactSolver contactSolver;
+    TriggerTracker triggerTracker;
+    CollisionLayerMatrix collisionLayers;
+    
+    // spatial queries read the broadphase under a shared lock, building it and deleting actors take it exclusively
+    mutable std::shared_mutex queryMutex;
+    
+    // destruction waits for the end of update so nothing iterating the actor list is invalidated
+    std::vector<Actor*> pendingDestroy;
+    std::vector<DespawnedActor> despawnedActors;
     
 public:
     World();
@@ -21,11 +53,37 @@ public:
     
     Player* getPlayerAsRef();
     
+    Actor* spawnActor(const Object& obj, const Transform& transform);
+    void destroyActor(Actor* actor);
+    
+    // the child stops simulating and follows the parent from where it is now
+    void attachActor(Actor* child, Actor* parent);
+    void detachActor(Actor* child);
+    
+    std::vector<DespawnedActor> takeDespawnedActors();
+    
     const std::vector<Actor*>& getWorldActors() const { return worldActors; }
     const std::vector<const Object>& getWorldObjects() const { return worldObjects; }
+    const SceneGraph& getSceneGraph() const { return sceneGraph; }
+    
+    // Spatial queries over the colliders as of the last physics tick, from any thread. Layer masks
+    // and trigger reporting come from the filter, the nearest hit is reported.
+    bool raycast(const Ray& ray, RaycastHit& hit, const QueryFilter& filter = QueryFilter()) const;
+    void raycastBatch(const std::vector<Ray>& rays, std::vector<RaycastHit>& hits, const QueryFilter& filter = QueryFilter()) const;
+    void overlapSphere(const glm::vec3& center, float radius, std::vector<Actor*>& actors, const QueryFilter& filter = QueryFilter()) const;
+    void overlapBox(const glm::vec3& min, const glm::vec3& max, std::vector<Actor*>& actors, const QueryFilter& filter = QueryFilter()) const;
+    bool sweepBox(const glm::vec3& min, const glm::vec3& max, const glm::vec3& displacement, SweepHit& hit,
+                  const QueryFilter& filter = QueryFilter()) const;
+    
+    CollisionLayerMatrix& getCollisionLayers() { return collisionLayers; }
+    const BroadphaseStats& getBroadphaseStats() const { return broadphase.getStats(); }
+    ContactSolver& getContactSolver() { return contactSolver; }
+    TriggerTracker& getTriggerTracker() { return triggerTracker; }
+    SimulationLod& getSimulationLod() { return simulationLod; }
     
 private:
     Actor* createActor(const Object& obj, const Transform& transform);
+    void flushDestroyedActors();
     
 };
 
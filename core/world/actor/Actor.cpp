@@ -1,4 +1,5 @@
 #include "Actor.h"
+#include "Physics.h"
 #include <GLFW/glfw3.h>
 //#include "Log.h"
 
@@ -7,28 +8,67 @@ Actor::Actor(const Object& o, const Transform& t)
 {
     obj = o;
     worldTransform = t;
+    previousLocation = t.worldLocation;
     cacheBoundingBox();
 }
 
-Actor::Actor(const Object& o, const Transform& t, const CollisionProfile& cp) : Actor(o, t)
+Actor::Actor(const Object& o, const Transform& t, const CollisionLayer layer) : Actor(o, t)
 {
-    collisionProfile = cp;
+    collisionLayer = layer;
 }
 
+// Gameplay and forces, the velocity it leaves is what the contact solver starts from
 void Actor::update(const double dt)
 {
     deltaTime = dt;
     
     if (physicsEnabled)
     {
-        gravitationalVelocity += gravitationalAcceleration;
+        // gravity was tuned per reference step, scaling it keeps any tick rate
+        float steps = dt / PHYSICS_REFERENCE_DELTA_TIME;
+        
+        gravitationalVelocity += gravitationalAcceleration * steps;
         actorVelocity = movementVelocity + glm::vec3(0, gravitationalVelocity, 0);
+    }
+}
+
+// Integrates the velocity the contact solver settled on
+void Actor::move(const double dt)
+{
+    if (physicsEnabled)
+    {
+        float steps = dt / PHYSICS_REFERENCE_DELTA_TIME;
         
-        addActorLocationContinuous(actorVelocity);
+        // contacts may have changed either part of the velocity
+        movementVelocity = glm::vec3(actorVelocity.x, 0.f, actorVelocity.z);
+        gravitationalVelocity = actorVelocity.y;
         
-        movementVelocity *= 0.8f;
+        glm::vec3 displacement = actorVelocity * static_cast<float>(dt);
         
-        actualActorVelocity = (worldTransform.worldLocation - lastWorldLocation) / deltaTime;
+        // a move past a good part of the actor could skip through something, the world sweeps it
+        const BoundingBox& box = getBoundingBox();
+        glm::vec3 size = box.max - box.min;
+        float threshold = std::min(size.x, std::min(size.y, size.z)) * CCD_MOTION_THRESHOLD;
+        
+        if (glm::dot(displacement, displacement) > threshold * threshold)
+        {
+            pendingDisplacement += displacement;
+        }
+        else
+        {
+            addActorLocation(displacement);
+        }
+        
+        movementVelocity *= std::pow(0.8f, steps);
+    }
+}
+
+// Measured from where the move ended up, so after the world has swept a fast mover
+void Actor::finishMove(const double dt)
+{
+    if (physicsEnabled)
+    {
+        actualActorVelocity = (worldTransform.worldLocation - lastWorldLocation) / static_cast<float>(dt);
         lastWorldLocation = worldTransform.worldLocation;
     }
     
@@ -41,21 +81,75 @@ void Actor::update(const double dt)
 void Actor::cacheBoundingBox()
 {
     cachedBoundingBox = calculateBoundingBox();
+    boundsDirty = false;
+}
+
+void Actor::markTransformDirty()
+{
+    matrixDirty = true;
+    boundsDirty = true;
+    transformVersion++;
+    renderVersion++;
+}
+
+// Only the scene graph calls this, after composing the parent's world matrix with ours
+void Actor::setAttachedMatrix(const glm::mat4& world, const Transform& decomposed)
+{
+    modelMatrix = world;
+    attachedTransform = decomposed;
+    matrixDirty = false;
+    boundsDirty = true;
+    renderVersion++;
 }
 
-const glm::mat4 Actor::getModelMatrix() const
+const glm::mat4 Actor::getLocalMatrix() const
 {
     glm::mat4 model = glm::mat4(1.f);
     
-    model = glm::translate(model, getWorldLocation());
+    model = glm::translate(model, worldTransform.worldLocation);
+    
+    model = glm::rotate(model, glm::radians(worldTransform.worldRotation.z), glm::vec3(0, 0, 1));
+    model = glm::rotate(model, glm::radians(worldTransform.worldRotation.y), glm::vec3(0, 1, 0));
+    model = glm::rotate(model, glm::radians(worldTransform.worldRotation.x), glm::vec3(1, 0, 0));
+    
+    return glm::scale(model, worldTransform.worldScale);
+}
+
+// Not safe to call concurrently while dirty. The renderer resolves every actor's matrix on the
+// main thread before its recording threads read it. An attached actor's matrix is whatever the
+// scene graph last propagated, local changes show up after its next update.
+const glm::mat4& Actor::getModelMatrix() const
+{
+    if (!matrixDirty || parent)
+    {
+        return modelMatrix;
+    }
+    
+    modelMatrix = getLocalMatrix();
+    matrixDirty = false;
     
-    model = glm::rotate(model, glm::radians(getWorldRotation().z), glm::vec3(0, 0, 1));
-    model = glm::rotate(model, glm::radians(getWorldRotation().y), glm::vec3(0, 1, 0));
-    model = glm::rotate(model, glm::radians(getWorldRotation().x), glm::vec3(1, 0, 0));
+    return modelMatrix;
+}
+
+// Only the location is blended, rotation and scale are the latest tick's. Same threading rules as
+// getModelMatrix.
+const glm::mat4 Actor::getRenderMatrix(const float alpha) const
+{
+    glm::mat4 render = getModelMatrix();
+    render[3] = glm::vec4(getRenderLocation(alpha), 1.f);
     
-    model = glm::scale(model, getWorldScale());
+    return render;
+}
+
+const BoundingBox& Actor::getBoundingBox() const
+{
+    if (boundsDirty)
+    {
+        cachedBoundingBox = calculateBoundingBox();
+        boundsDirty = false;
+    }
     
-    return model;
+    return cachedBoundingBox;
 }
 
 
@@ -90,21 +184,21 @@ const glm::vec3 Actor::getUpVector() const
 void Actor::setActorLocation(const glm::vec3& location)
 {
     worldTransform.worldLocation = location;
-    cacheBoundingBox();
+    markTransformDirty();
 }
 
 
 void Actor::setActorRotation(const glm::vec3& rotation)
 {
     worldTransform.worldRotation = rotation;
-    cacheBoundingBox();
+    markTransformDirty();
 }
 
 
 void Actor::setActorScale(const glm::vec3& scale)
 {
     worldTransform.worldScale = scale;
-    cacheBoundingBox();
+    markTransformDirty();
 }
 
 void Actor::addActorLocationContinuous(const glm::vec3& addLocation)
@@ -150,6 +244,11 @@ void Actor::setGravitationalVelocity(const float velocity)
 
 void Actor::setCulled(const bool occlude)
 {
+    if (isCulled != occlude)
+    {
+        renderVersion++;
+    }
+    
     isCulled = occlude;
 }
 
@@ -158,9 +257,14 @@ void Actor::setActive(const bool active)
     isActive = active;
 }
 
-void Actor::setCollisionProfile(const CollisionProfile& cp)
+void Actor::setCollisionLayer(const CollisionLayer layer)
+{
+    collisionLayer = layer;
+}
+
+void Actor::setCollider(const Collider& c)
 {
-    collisionProfile = cp;
+    collider = c;
 }
 
 void Actor::setCollisionSurface(const CollisionSurface& cs)
@@ -171,50 +275,151 @@ void Actor::setCollisionSurface(const CollisionSurface& cs)
 void Actor::setPhysicsEnabled(const bool enabled)
 {
     physicsEnabled = enabled;
+    renderVersion++;
 }
 
-void Actor::setAudioManager(AudioManager* am)
+void Actor::setMaterial(const uint16_t material)
 {
-    audioManager = am;
+    materialId = material;
+    renderVersion++;
 }
 
-const BoundingBox Actor::calculateBoundingBox() const
+void Actor::setMeshId(const int32_t id)
 {
-    BoundingBox box = obj.boundingBox;
-
-    glm::vec3 min = box.min;
-    glm::vec3 max = box.max;
+    meshId = id;
+}
 
-    std::vector<glm::vec3> corners = {
-        glm::vec3(min.x, min.y, min.z),
-        glm::vec3(max.x, min.y, min.z),
-        glm::vec3(min.x, max.y, min.z),
-        glm::vec3(max.x, max.y, min.z),
-        glm::vec3(min.x, min.y, max.z),
-        glm::vec3(max.x, min.y, max.z),
-        glm::vec3(min.x, max.y, max.z),
-        glm::vec3(max.x, max.y, max.z)
-    };
+void Actor::setLod(const uint8_t level)
+{
+    lod = level;
+}
 
-    glm::vec3 transformedMin(FLT_MAX);
-    glm::vec3 transformedMax(-FLT_MAX);
+void Actor::setAudioManager(AudioManager* am)
+{
+    audioManager = am;
+}
 
-    for (const auto& corner : corners)
+// Arvo's method: the box is kept as center and half extent, the center is transformed as a
+// point and each world extent is the local extents weighted by the absolute matrix entries.
+// Exact for the transformed corners, without building or visiting them.
+const BoundingBox Actor::calculateBoundingBox() const
+{
+    const glm::mat4& model = getModelMatrix();
+    
+    glm::vec3 center = (obj.boundingBox.min + obj.boundingBox.max) * 0.5f;
+    glm::vec3 extent = (obj.boundingBox.max - obj.boundingBox.min) * 0.5f;
+    
+    glm::vec3 worldCenter = glm::vec3(model[3]);
+    glm::vec3 worldExtent(0.f);
+    
+    for (int column = 0; column < 3; column++)
     {
-        glm::vec3 transformedCorner = glm::vec3(getModelMatrix() * glm::vec4(corner, 1.0f));
-
-        transformedMin = glm::min(transformedMin, transformedCorner);
-        transformedMax = glm::max(transformedMax, transformedCorner);
+        for (int row = 0; row < 3; row++)
+        {
+            worldCenter[row] += model[column][row] * center[column];
+            worldExtent[row] += std::abs(model[column][row]) * extent[column];
+        }
     }
-
+    
     BoundingBox transformedBox;
-    transformedBox.min = transformedMin;
-    transformedBox.max = transformedMax;
+    transformedBox.min = worldCenter - worldExtent;
+    transformedBox.max = worldCenter + worldExtent;
     
     return transformedBox;
 }
 
 
+// Places the collider with the cached model matrix, sizes left at 0 are fitted to the mesh's box
+const WorldCollider Actor::getWorldCollider() const
+{
+    const glm::mat4& model = getModelMatrix();
+    const BoundingBox& box = getBoundingBox();
+    
+    glm::vec3 localCenter = (obj.boundingBox.min + obj.boundingBox.max) * 0.5f;
+    glm::vec3 localExtent = (obj.boundingBox.max - obj.boundingBox.min) * 0.5f;
+    
+    WorldCollider c;
+    c.shape = collider.shape;
+    c.center = glm::vec3(model * glm::vec4(localCenter, 1.f));
+    
+    glm::vec3 scale;
+    
+    for (int axis = 0; axis < 3; axis++)
+    {
+        glm::vec3 column = glm::vec3(model[axis]);
+        scale[axis] = glm::length(column);
+        
+        if (scale[axis] > 0.f)
+        {
+            c.axes[axis] = column / scale[axis];
+        }
+    }
+    
+    c.halfExtents = localExtent * scale;
+    c.min = box.min;
+    c.max = box.max;
+    c.segmentStart = c.center;
+    c.segmentEnd = c.center;
+    
+    switch (collider.shape)
+    {
+        case CS_MESH:
+            if (!obj.bvhNodes.empty())
+            {
+                c.mesh = &obj;
+                c.model = model;
+                break;
+            }
+            
+            // a mesh without a hierarchy collides as its box
+            c.shape = CS_AABB;
+            [[fallthrough]];
+            
+        case CS_AABB:
+            c.center = (box.min + box.max) * 0.5f;
+            c.halfExtents = (box.max - box.min) * 0.5f;
+            c.axes[0] = glm::vec3(1, 0, 0);
+            c.axes[1] = glm::vec3(0, 1, 0);
+            c.axes[2] = glm::vec3(0, 0, 1);
+            break;
+            
+        case CS_OBB:
+            break;
+            
+        case CS_SPHERE:
+        {
+            float radius = collider.radius > 0.f ? collider.radius : std::max(localExtent.x, std::max(localExtent.y, localExtent.z));
+            
+            c.radius = radius * std::max(scale.x, std::max(scale.y, scale.z));
+            c.min = c.center - glm::vec3(c.radius);
+            c.max = c.center + glm::vec3(c.radius);
+            break;
+        }
+            
+        case CS_CAPSULE:
+        {
+            float radius = collider.radius > 0.f ? collider.radius : std::max(localExtent.x, localExtent.z);
+            float halfHeight = collider.halfHeight > 0.f ? collider.halfHeight : localExtent.y;
+            
+            c.radius = radius * std::max(scale.x, scale.z);
+            
+            glm::vec3 halfSegment = c.axes[1] * std::max(halfHeight * scale.y - c.radius, 0.f);
+            c.segmentStart = c.center - halfSegment;
+            c.segmentEnd = c.center + halfSegment;
+            
+            c.min = glm::min(c.segmentStart, c.segmentEnd) - glm::vec3(c.radius);
+            c.max = glm::max(c.segmentStart, c.segmentEnd) + glm::vec3(c.radius);
+            break;
+        }
+            
+        default:
+            break;
+    }
+    
+    return c;
+}
+
+
 const std::vector<glm::vec3> Actor::getBoundingBoxCorners() const
 {
     BoundingBox box = getBoundingBox();
@@ -245,6 +450,14 @@ const float Actor::getApproximateBoundingRadius() const
     return glm::max(max.x - min.x, glm::max(max.y - min.y, max.z - min.z)) / 2.0f;
 }
 
+glm::vec3 Actor::takePendingDisplacement()
+{
+    glm::vec3 displacement = pendingDisplacement;
+    pendingDisplacement = glm::vec3(0);
+    
+    return displacement;
+}
+
 void Actor::removeCollisionPartners()
 {
     for (auto& pair : collisionPartners)
@@ -259,3 +472,7 @@ void Actor::onActorCollision(Actor* otherActor, const DetailedCollisionResponse&
 {
     collisionPartners[otherActor] = collisionResult;
 }
+
+void Actor::onTriggerEvents(const std::vector<TriggerEvent>& /*events*/)
+{
+}
@@ -3,24 +3,45 @@
 
 #include "VulkanUtils.h"
 #include "CollisionData.h"
+#include "Physics.h"
 #include "AudioManager.h"
 
 
 class Actor {
+    friend class SceneGraph;
+    friend class SimulationLod;
+    
 private:
-    // Object
+    // Object, relative to the parent while attached
     Transform worldTransform;
     Object obj;
+    
+    // rebuilt on first use after the transform changes, so several moves in a tick cost one build
+    mutable glm::mat4 modelMatrix;
+    mutable bool matrixDirty = true;
+    mutable bool boundsDirty = true;
+    
+    // Hierarchy, attached actors get their matrix and its decomposition from the scene graph
+    Actor* parent = nullptr;
+    Transform attachedTransform = { glm::vec3(0), glm::vec3(0), glm::vec3(1) };
+    uint32_t transformVersion = 0;
+    
+    uint16_t materialId = 0;
+    int32_t meshId = -1;    // geometry heap handle, assigned by the renderer on first draw
+    uint8_t lod = 0;        // level of detail picked by the renderer last frame
 
     // Movement
     glm::vec3 actorVelocity = glm::vec3(0);
     glm::vec3 movementVelocity = glm::vec3(0);
     glm::vec3 lastWorldLocation = glm::vec3(0);
     glm::vec3 actualActorVelocity = glm::vec3(0);
+    glm::vec3 pendingDisplacement = glm::vec3(0);     // too fast to teleport, the world sweeps it
+    glm::vec3 previousLocation = glm::vec3(0);        // at the start of this tick, frames blend from it
 
     // Object collision data
-    BoundingBox cachedBoundingBox;
-    CollisionProfile collisionProfile = CollisionProfile::CW_DEFAULT;
+    mutable BoundingBox cachedBoundingBox;
+    CollisionLayer collisionLayer = CL_DEFAULT;
+    Collider collider;
     CollisionSurface collisionSurface;
 
     // Physics
@@ -28,12 +49,24 @@ private:
     float deltaTime = 0.f;
     float gravitationalVelocity = 0;
     float gravitationalAcceleration = -0.3;
+    
+    // Simulation level of detail, this tick's step is the tick's length times simulationScale
+    SimulationTier simulationTier = ST_FULL;
+    float simulationScale = 1.f;        // 0 on ticks the actor is not stepped
+    uint8_t simulationPhase = 0;        // tick within the reduced interval this actor steps on
+    uint8_t ticksSinceStep = 0;
 
     // State flags
     bool isCulled = false;
     bool isActive = true;
     bool activityOverride = false;
     
+    // Bumped whenever anything baked into a cached draw changes
+    uint32_t renderVersion = 0;
+    
+    void markTransformDirty();
+    void setAttachedMatrix(const glm::mat4& world, const Transform& decomposed);
+    
 protected:
     AudioManager* audioManager;
     
@@ -41,45 +74,70 @@ protected:
     
 public:
     Actor(const Object& o, const Transform& t);
-    Actor(const Object& o, const Transform& t, const CollisionProfile& cp);
+    Actor(const Object& o, const Transform& t, const CollisionLayer layer);
     virtual ~Actor() = default;
     
     virtual void update(const double deltaTime);
+    void move(const double deltaTime);
+    void finishMove(const double deltaTime);
     
     
     // Getters
-    const glm::vec3& getWorldLocation() const { return worldTransform.worldLocation; }
-    const glm::vec3& getWorldRotation() const { return worldTransform.worldRotation; }
-    const glm::vec3& getWorldScale() const { return worldTransform.worldScale; }
+    const glm::vec3& getWorldLocation() const { return parent ? attachedTransform.worldLocation : worldTransform.worldLocation; }
+    const glm::vec3& getWorldRotation() const { return parent ? attachedTransform.worldRotation : worldTransform.worldRotation; }
+    const glm::vec3& getWorldScale() const { return parent ? attachedTransform.worldScale : worldTransform.worldScale; }
+    
+    // the transform the setters work on, relative to the parent while attached
+    const Transform& getLocalTransform() const { return worldTransform; }
+    const glm::mat4 getLocalMatrix() const;
     
     const glm::vec3& getMovementVelocity() const { return movementVelocity; }
     const glm::vec3& getActorVelocity() const { return actorVelocity; }
     const glm::vec3& getActualActorVelocity() const { return actualActorVelocity; }
     const float getGravitationalVelocity() const { return gravitationalVelocity; }
+    const glm::vec3& getPendingDisplacement() const { return pendingDisplacement; }
+    
+    const glm::mat4& getModelMatrix() const;
     
-    const glm::mat4 getModelMatrix() const;
+    // between ticks, alpha is how far the next tick is
+    void storePreviousLocation() { previousLocation = getWorldLocation(); }
+    const glm::vec3 getRenderLocation(const float alpha) const { return glm::mix(previousLocation, getWorldLocation(), alpha); }
+    const glm::mat4 getRenderMatrix(const float alpha) const;
+    
+    Actor* getParent() const { return parent; }
+    const uint32_t getTransformVersion() const { return transformVersion; }
     
     const glm::vec3 getForwardVector() const;
     const glm::vec3 getRightVector() const;
     const glm::vec3 getUpVector() const;
     
     const Object& getObject() const { return obj; }
+    const uint16_t getMaterial() const { return materialId; }
     
     void cacheBoundingBox();
-    const BoundingBox& getBoundingBox() const { return cachedBoundingBox; }
+    const BoundingBox& getBoundingBox() const;
     const BoundingBox calculateBoundingBox() const;
     
     const std::vector<glm::vec3> getBoundingBoxCorners() const;
     const float getApproximateBoundingRadius() const;
     
-    const CollisionProfile& getCollisionProfile() const { return collisionProfile; }
+    const CollisionLayer getCollisionLayer() const { return collisionLayer; }
+    const Collider& getCollider() const { return collider; }
+    const WorldCollider getWorldCollider() const;
     const CollisionSurface& getCollisionSurface() const { return collisionSurface; }
     
     const bool getPhysicsEnabled() const { return physicsEnabled; }
     
+    const SimulationTier getSimulationTier() const { return simulationTier; }
+    const float getSimulationScale() const { return simulationScale; }
+    
     const bool getCulled() const { return isCulled; }
     const bool getActive() const { return isActive; }
     
+    const uint32_t getRenderVersion() const { return renderVersion; }
+    const int32_t getMeshId() const { return meshId; }
+    const uint8_t getLod() const { return lod; }
+    
     const bool getIsInAir() const { return abs(gravitationalVelocity) > 0.01f; }
     
     
@@ -99,10 +157,14 @@ public:
     void setCulled(const bool occlude);
     void setActive(const bool active);
     
-    void setCollisionProfile(const CollisionProfile& cp);
+    void setCollisionLayer(const CollisionLayer layer);
+    void setCollider(const Collider& c);
     void setCollisionSurface(const CollisionSurface& cs);
     
     void setPhysicsEnabled(const bool enabled);
+    void setMaterial(const uint16_t material);
+    void setMeshId(const int32_t id);
+    void setLod(const uint8_t level);
     
     void setGravitationalAcceleration(const float acceleration);
     void setGravitationalVelocity(const float velocity);
@@ -111,8 +173,14 @@ public:
     
     void removeCollisionPartners();
     
+    // hands over the move update() left for a sweep
+    glm::vec3 takePendingDisplacement();
+    
     // Event Hooks
     virtual void onActorCollision(Actor* otherActor, const DetailedCollisionResponse& collisionResult);
+    
+    // every trigger overlap this actor entered, stayed in or left this tick, never called empty
+    virtual void onTriggerEvents(const std::vector<TriggerEvent>& events);
 };
 
 #endif
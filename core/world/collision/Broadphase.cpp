@@ -0,0 +1,157 @@
+#include "Broadphase.h"
+
+#include <algorithm>
+#include <cfloat>
+
+
+Broadphase::Broadphase()
+{
+}
+
+
+void Broadphase::build(const std::vector<Actor*>& actors, const CollisionLayerMatrix& layers)
+{
+    proxies.clear();
+    pairs.clear();
+    actorOrder.assign(actors.size(), NO_PROXY);
+
+    stats = {};
+
+    for (size_t i = 0; i < actors.size(); i++)
+    {
+        Actor* a = actors[i];
+        uint32_t layer = a->getCollisionLayer();
+
+        if (!a->getActive() || layers.getMask(layer) == 0)
+        {
+            continue;
+        }
+
+        BroadphaseProxy proxy;
+        proxy.actor = a;
+        proxy.collider = a->getWorldCollider();
+        proxy.layerBit = 1u << layer;
+        proxy.layerMask = layers.getMask(layer);
+        proxy.dynamic = a->getPhysicsEnabled() && a->getSimulationScale() > 0.f;
+        proxy.simulating = a->getPhysicsEnabled();
+        proxy.trigger = (layers.getTriggerLayers() & proxy.layerBit) || a->getCollider().trigger;
+
+        actorOrder[i] = proxies.size();
+        proxies.push_back(proxy);
+    }
+
+    stats.proxies = proxies.size();
+
+    sortProxies(actors.size());
+
+    for (size_t s = 0; s < sorted.size(); s++)
+    {
+        uint32_t i = actorOrder[sorted[s]];
+
+        if (i == NO_PROXY)
+        {
+            break;
+        }
+
+        const BroadphaseProxy& a = proxies[i];
+
+        for (size_t t = s + 1; t < sorted.size(); t++)
+        {
+            uint32_t j = actorOrder[sorted[t]];
+
+            if (j == NO_PROXY || proxies[j].collider.min.x > a.collider.max.x)
+            {
+                break;
+            }
+
+            const BroadphaseProxy& b = proxies[j];
+            stats.overlapsTested++;
+
+            if (!(a.layerMask & b.layerBit))
+            {
+                stats.filtered++;
+                continue;
+            }
+
+            bool trigger = a.trigger || b.trigger;
+
+            // an unstepped actor has not moved, but its trigger overlaps must not end until it does
+            if (!(trigger ? a.simulating || b.simulating : a.dynamic || b.dynamic))
+            {
+                continue;
+            }
+
+            if (a.collider.min.y > b.collider.max.y || b.collider.min.y > a.collider.max.y ||
+                a.collider.min.z > b.collider.max.z || b.collider.min.z > a.collider.max.z)
+            {
+                continue;
+            }
+
+            pairs.push_back({ std::min(i, j), std::max(i, j), trigger });
+        }
+    }
+
+    // resolve in the order of the actor list, as the exhaustive loop did
+    std::sort(pairs.begin(), pairs.end(), [](const BroadphasePair& x, const BroadphasePair& y) {
+        return x.a != y.a ? x.a < y.a : x.b < y.b;
+    });
+
+    stats.pairs = pairs.size();
+}
+
+
+void Broadphase::query(const glm::vec3& min, const glm::vec3& max, uint32_t layerMask, std::vector<uint32_t>& hits) const
+{
+    visit(min, max, layerMask, [&](uint32_t proxy) {
+        hits.push_back(proxy);
+    });
+}
+
+
+void Broadphase::forget(const Actor* actor)
+{
+    for (BroadphaseProxy& proxy : proxies)
+    {
+        if (proxy.actor == actor)
+        {
+            proxy.layerBit = 0;
+            proxy.layerMask = 0;
+        }
+    }
+}
+
+
+// Insertion sort of the persistent order, nearly sorted from last tick so close to linear.
+// Actors without a proxy sink to the end.
+void Broadphase::sortProxies(size_t actorCount)
+{
+    if (sorted.size() != actorCount)
+    {
+        sorted.resize(actorCount);
+
+        for (size_t i = 0; i < actorCount; i++)
+        {
+            sorted[i] = i;
+        }
+    }
+
+    auto key = [this](uint32_t slot) {
+        uint32_t proxy = actorOrder[slot];
+        return proxy == NO_PROXY ? FLT_MAX : proxies[proxy].collider.min.x;
+    };
+
+    for (size_t i = 1; i < sorted.size(); i++)
+    {
+        uint32_t slot = sorted[i];
+        float value = key(slot);
+        size_t j = i;
+
+        while (j > 0 && key(sorted[j - 1]) > value)
+        {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+
+        sorted[j] = slot;
+    }
+}
@@ -0,0 +1,117 @@
+#ifndef BROADPHASE_H
+#define BROADPHASE_H
+
+#include "Actor.h"
+#include "CollisionLayers.h"
+
+
+#define NO_PROXY UINT32_MAX
+
+
+// everything the pair filter needs, copied out of the actor so the sweep never touches it
+struct BroadphaseProxy
+{
+    Actor* actor;
+    WorldCollider collider;     // min and max are what the sweep sorts and overlaps
+    uint32_t layerBit;
+    uint32_t layerMask;         // layers this proxy interacts with
+    bool dynamic;               // physics enabled and stepped this tick
+    bool simulating;            // physics enabled, stepped this tick or not
+    bool trigger;
+};
+
+
+// proxy indices, a is always the earlier actor in the world's list
+struct BroadphasePair
+{
+    uint32_t a;
+    uint32_t b;
+    bool trigger;
+};
+
+
+struct BroadphaseStats
+{
+    uint32_t proxies = 0;
+    uint32_t overlapsTested = 0;    // pairs the sweep found overlapping on x
+    uint32_t filtered = 0;          // of those, rejected by the layer mask
+    uint32_t pairs = 0;
+};
+
+
+/**
+ * @class Broadphase
+ * @brief Sweep and prune over the actors' collider bounds, producing the pairs worth a narrowphase.
+ *
+ * Proxies are rebuilt from the actor list on every build, with the layer bit and interaction
+ * mask baked in. Actors whose layer interacts with nothing never get a proxy, and a pair needs
+ * one actor the simulation level of detail is stepping this tick, or for a trigger pair one with
+ * physics at all, so overlaps hold between a reduced actor's steps. The sort order
+ * along x is kept between builds, so the insertion sort only fixes up what moved. During the
+ * sweep the layer AND runs before any other test, a filtered pair costs no bounds reads.
+ */
+class Broadphase {
+private:
+    std::vector<BroadphaseProxy> proxies;
+    std::vector<uint32_t> actorOrder;       // proxy index of each actor slot, -1 without a proxy
+    std::vector<uint32_t> sorted;           // actor slots, by collider.min.x
+    std::vector<BroadphasePair> pairs;
+
+    BroadphaseStats stats;
+
+public:
+    Broadphase();
+
+    void build(const std::vector<Actor*>& actors, const CollisionLayerMatrix& layers);
+
+    // proxies whose bounds overlap the box and whose layer is in layerMask, as of the last build
+    void query(const glm::vec3& min, const glm::vec3& max, uint32_t layerMask, std::vector<uint32_t>& hits) const;
+
+    // as query, handing each proxy index to visit instead of collecting them
+    template <typename Visit>
+    void visit(const glm::vec3& min, const glm::vec3& max, uint32_t layerMask, Visit visit) const;
+
+    // takes a deleted actor's proxy out of every query until the next build
+    void forget(const Actor* actor);
+
+    const std::vector<BroadphasePair>& getPairs() const { return pairs; }
+    const BroadphaseProxy& getProxy(uint32_t proxy) const { return proxies[proxy]; }
+    const BroadphaseStats& getStats() const { return stats; }
+
+private:
+    void sortProxies(size_t actorCount);
+};
+
+
+// the sorted order ends the walk at the first proxy starting past the box
+template <typename Visit>
+void Broadphase::visit(const glm::vec3& min, const glm::vec3& max, uint32_t layerMask, Visit visit) const
+{
+    for (uint32_t slot : sorted)
+    {
+        uint32_t i = actorOrder[slot];
+
+        if (i == NO_PROXY || proxies[i].collider.min.x > max.x)
+        {
+            break;
+        }
+
+        const BroadphaseProxy& proxy = proxies[i];
+
+        if (!(layerMask & proxy.layerBit))
+        {
+            continue;
+        }
+
+        if (proxy.collider.max.x < min.x ||
+            proxy.collider.min.y > max.y || proxy.collider.max.y < min.y ||
+            proxy.collider.min.z > max.z || proxy.collider.max.z < min.z)
+        {
+            continue;
+        }
+
+        visit(i);
+    }
+}
+
+#endif
@@ -2,11 +2,11 @@
 #define COLLISIONCONSTANTS_H
 
 
-#define PLAYER_CULL_COLLISION_DISTANCE 15.f
+// object space, fitted to the barrel the player is drawn as
+#define PLAYER_COLLISION_RADIUS 0.1f
+#define PLAYER_COLLISION_HALF_HEIGHT 0.13f
 
-#define PLAYER_COLLISION_RADIUS 0.12f
-#define PLAYER_COLLISION_HALF_HEIGHT 0.12f
-
-#define PENETRATION_DEPTH_FORCE 1.01f
+// penetration the contact solver leaves alone, so resting contacts stay touching
+#define CONTACT_SLOP 0.0045f
 
 #endif
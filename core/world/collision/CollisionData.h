@@ -2,22 +2,119 @@
 #define COLLISIONDATA_H
 
 
+#define COLLISION_LAYER_COUNT 32
+
+
+struct Object;
+class Actor;
+
+
+/**
+ * @enum CollisionLayer
+ * @brief The layer an actor collides on, one of COLLISION_LAYER_COUNT.
+ *
+ * Which layers touch each other is decided by the world's CollisionLayerMatrix, so layers
+ * only name a category. The unnamed ones are free for gameplay code to give a meaning and
+ * a name to.
+ */
+enum CollisionLayer
+{
+    CL_DEFAULT = 0,
+    CL_PLAYER = 1,
+    CL_STATIC = 2,
+    CL_DYNAMIC = 3,
+    CL_DEBRIS = 4,          // ignores other debris
+    CL_TRIGGER = 5,         // reports overlaps, never pushes
+    CL_PROJECTILE = 6,
+    CL_PICKUP = 7,
+    CL_CUSTOM = 8           // first of the layers left to gameplay code
+};
+
+/**
+ * @enum ColliderShape
+ * @brief The shape an actor collides as, each pair of shapes has its own narrowphase kernel.
+ */
+enum ColliderShape
+{
+    CS_AABB = 0,            // the world-space box around the mesh, grows as the actor rotates
+    CS_SPHERE = 1,
+    CS_CAPSULE = 2,         // upright along the actor's local y
+    CS_OBB = 3,             // the mesh's box, rotated with the actor
+    CS_MESH = 4,            // the mesh's own triangles through its BVH, for static level geometry
+    CS_COUNT = 5
+};
+
+/**
+ * @struct Collider
+ * @brief An actor's collision shape, in object space around the center of the mesh's box.
+ *
+ * Sizes are scaled with the actor. A size left at 0 is fitted to the mesh's box.
+ */
+struct Collider
+{
+    ColliderShape shape = CS_AABB;
+    float radius = 0.f;
+    float halfHeight = 0.f;     // capsule, half the full height including the caps
+    bool trigger = false;       // reports enter and exit like a trigger layer, never pushes
+};
+
 /**
- * @enum CollisionProfile
- * @brief Enum representing different collision profiles for game entities.
+ * @struct WorldCollider
+ * @brief A collider placed in the world, the only input the narrowphase kernels read.
  *
- * This enum defines various collision profiles used in the game to categorize
- * entities based on their interaction types. These profiles help to manage
- * how different types of game entities interact and collide with each other.
- * The enum values can be combined using bitwise operations to create custom
- * profiles for more complex collision handling.
+ * Every shape fills center, axes and halfExtents with its box, so any shape can also be
+ * treated as an oriented box. min and max bound the shape itself.
+ */
+struct WorldCollider
+{
+    ColliderShape shape = CS_AABB;
+    glm::vec3 center = glm::vec3(0);
+    glm::vec3 axes[3] = { glm::vec3(1, 0, 0), glm::vec3(0, 1, 0), glm::vec3(0, 0, 1) };
+    glm::vec3 halfExtents = glm::vec3(0);
+    glm::vec3 min = glm::vec3(0);
+    glm::vec3 max = glm::vec3(0);
+    
+    // sphere and capsule, a sphere's segment is its center
+    glm::vec3 segmentStart = glm::vec3(0);
+    glm::vec3 segmentEnd = glm::vec3(0);
+    float radius = 0.f;
+    
+    // mesh, the actor's object is read in place so it must outlive the collider. The model matrix is
+    // copied when the collider is built, queries off the main thread never see it being rebuilt.
+    // Translating a mesh collider moves only its bounds.
+    const Object* mesh = nullptr;
+    glm::mat4 model = glm::mat4(1.f);
+    
+    void translate(const glm::vec3& offset)
+    {
+        center += offset;
+        min += offset;
+        max += offset;
+        segmentStart += offset;
+        segmentEnd += offset;
+    }
+};
+
+/**
+ * @enum TriggerEventType
+ * @brief What happened to an overlap involving a trigger since the last tick.
+ */
+enum TriggerEventType
+{
+    TE_ENTER = 0,
+    TE_STAY = 1,            // only reported when the world's trigger tracker is asked to
+    TE_EXIT = 2
+};
+
+/**
+ * @struct TriggerEvent
+ * @brief One change to an actor's trigger overlaps, delivered with the rest of its tick's batch.
  */
-enum CollisionProfile
+struct TriggerEvent
 {
-    CW_NONE = 0,
-    CW_PLAYER = (1 << 0),
-    CW_ACTOR = (1 << 1),
-    CW_DEFAULT = (CW_PLAYER | CW_ACTOR)
+    Actor* other;
+    TriggerEventType type;
+    bool otherDestroyed = false;    // exit because other was deleted, the pointer is only an identity
 };
 
 /**
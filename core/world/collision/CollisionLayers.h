@@ -0,0 +1,86 @@
+#ifndef COLLISIONLAYERS_H
+#define COLLISIONLAYERS_H
+
+#include "CollisionData.h"
+
+#include <string>
+#include <stdint.h>
+
+
+/**
+ * @class CollisionLayerMatrix
+ * @brief Symmetric table of which collision layers interact.
+ *
+ * Each layer keeps a mask of the layers it touches, set in both directions at once, so
+ * deciding a pair is a single AND of one layer's mask with the other's bit. Trigger layers
+ * still interact but only report overlaps, nothing on them is pushed.
+ */
+class CollisionLayerMatrix {
+private:
+    uint32_t masks[COLLISION_LAYER_COUNT];
+    uint32_t triggerLayers = 0;
+    std::string names[COLLISION_LAYER_COUNT];
+
+public:
+    CollisionLayerMatrix()
+    {
+        for (uint32_t layer = 0; layer < COLLISION_LAYER_COUNT; layer++)
+        {
+            masks[layer] = ~0u;
+            names[layer] = "layer " + std::to_string(layer);
+        }
+
+        names[CL_DEFAULT] = "default";
+        names[CL_PLAYER] = "player";
+        names[CL_STATIC] = "static";
+        names[CL_DYNAMIC] = "dynamic";
+        names[CL_DEBRIS] = "debris";
+        names[CL_TRIGGER] = "trigger";
+        names[CL_PROJECTILE] = "projectile";
+        names[CL_PICKUP] = "pickup";
+
+        setInteraction(CL_DEBRIS, CL_DEBRIS, false);
+        setTrigger(CL_TRIGGER, true);
+    }
+
+    void setInteraction(uint32_t a, uint32_t b, bool interacts)
+    {
+        if (a >= COLLISION_LAYER_COUNT || b >= COLLISION_LAYER_COUNT)
+        {
+            throw std::runtime_error("failed to set collision interaction, layer out of range!");
+        }
+
+        if (interacts)
+        {
+            masks[a] |= (1u << b);
+            masks[b] |= (1u << a);
+        }
+        else
+        {
+            masks[a] &= ~(1u << b);
+            masks[b] &= ~(1u << a);
+        }
+    }
+
+    void setTrigger(uint32_t layer, bool trigger)
+    {
+        if (trigger)
+        {
+            triggerLayers |= (1u << layer);
+        }
+        else
+        {
+            triggerLayers &= ~(1u << layer);
+        }
+    }
+
+    void setName(uint32_t layer, const std::string& name) { names[layer] = name; }
+
+    const uint32_t getMask(uint32_t layer) const { return masks[layer]; }
+    const uint32_t getTriggerLayers() const { return triggerLayers; }
+    const std::string& getName(uint32_t layer) const { return names[layer]; }
+
+    const bool interacts(uint32_t a, uint32_t b) const { return masks[a] & (1u << b); }
+};
+
+#endif
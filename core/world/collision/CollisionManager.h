@@ -4,126 +4,101 @@
 #include "Log.h"
 #include "Actor.h"
 #include "Player.h"
-#include "CollisionUtils.h"
 #include "CollisionData.h"
 #include "CollisionConstants.h"
+#include "Broadphase.h"
+#include "Narrowphase.h"
+#include "SpatialQuery.h"
+#include "Physics.h"
 
 
+// Narrowphase only, layers, activity and distance were settled when the broadphase built the pair.
+// Both responses describe the same contact, each from its own actor's side.
 bool doesActorCollideWithActor(
-    const glm::vec3& playerLocation,
-    const Actor& actorA,
-    const Actor& actorB,
+    const BroadphaseProxy& proxyA,
+    const BroadphaseProxy& proxyB,
     DetailedCollisionResponse& collisionResultA,
     DetailedCollisionResponse& collisionResultB
 )
 {
-    if (&actorA == &actorB)
+    if (!collideColliders(proxyA.collider, proxyB.collider, collisionResultA.penetrationInfo))
     {
         return false;
     }
     
-    if (!actorA.getPhysicsEnabled() && !actorB.getPhysicsEnabled())
-    {
-        return false;
-    }
+    const Actor& actorA = *proxyA.actor;
+    const Actor& actorB = *proxyB.actor;
     
-    if (!collisionProfileEnabled(actorA, CW_ACTOR) ||
-        !collisionProfileEnabled(actorB, CW_ACTOR))
-    {
-        return false;
-    }
+    collisionResultA.collisionSurface = actorB.getCollisionSurface();
+    collisionResultA.collisionPoint = actorA.getWorldLocation();
+    collisionResultA.impactVelocity = actorA.getActualActorVelocity();
     
-    if (!inDistanceForCollisionCheck(playerLocation, actorA) &&
-        !inDistanceForCollisionCheck(playerLocation, actorB))
-    {
-        return false;
-    }
-
-    const BoundingBox aBox = actorA.getBoundingBox();
-    const BoundingBox bBox = actorB.getBoundingBox();
+    collisionResultB.penetrationInfo.collisionNormal = -collisionResultA.penetrationInfo.collisionNormal;
+    collisionResultB.penetrationInfo.penetrationDepth = collisionResultA.penetrationInfo.penetrationDepth;
+    collisionResultB.collisionSurface = actorA.getCollisionSurface();
+    collisionResultB.collisionPoint = actorB.getWorldLocation();
+    collisionResultB.impactVelocity = actorB.getActualActorVelocity();
     
-    if (isBoxInBoundingBox(aBox.min, aBox.max, bBox.min, bBox.max, collisionResultA.penetrationInfo))
-    {
-        collisionResultA.collisionSurface = actorB.getCollisionSurface();
-        collisionResultA.collisionPoint = actorA.getWorldLocation();
-        collisionResultA.impactVelocity = actorA.getActualActorVelocity();
-        
-        if (isBoxInBoundingBox(bBox.min, bBox.max, aBox.min, aBox.max, collisionResultB.penetrationInfo))
-        {
-            collisionResultB.collisionSurface = actorA.getCollisionSurface();
-            collisionResultB.collisionPoint = actorB.getWorldLocation();
-            collisionResultB.impactVelocity = actorB.getActualActorVelocity();
-        }
-        
-        return true;
-    }
-    
-    return false;
+    return true;
 }
 
 /**
- * @brief Checks for collisions between the player and all actors in the world.
+ * @brief Moves an actor through the world without passing through anything solid.
  *
- * This function iterates through a list of world actors and checks for collisions
- * between the player and each actor. If a collision is detected, it updates the
- * position of both actors based on their collision results.
+ * The actor's bounds are swept along the move against the broadphase, and it stops at the first
+ * time of impact. What is left of the move slides along the surface hit, for up to
+ * CCD_MAX_SUBSTEPS impacts. Landing on something stops the fall as a resting contact would.
+ * Trigger layers never block.
  *
- * @param playerLocation The current location of the player.
- * @param worldActors A vector of actors in the world to check for collisions.
+ * @param actor The actor to move, it should not be in the broadphase's pairs being resolved.
+ * @param displacement The whole move for this tick.
+ * @param broadphase Built this tick, the proxies are what is swept against.
+ * @param layers Which collision layers block the actor.
  */
-void collideWorldActors(
-    const glm::vec3& playerLocation,
-    std::vector<Actor*>& worldActors
+void sweepActor(
+    Actor& actor,
+    glm::vec3 displacement,
+    const Broadphase& broadphase,
+    const CollisionLayerMatrix& layers
 )
 {
-    DetailedCollisionResponse collisionResultA;
-    DetailedCollisionResponse collisionResultB;
+    WorldCollider collider = actor.getWorldCollider();
     
-    for (size_t i = 0; i < worldActors.size(); i++)
+    QueryFilter filter;
+    filter.layerMask = layers.getMask(actor.getCollisionLayer()) & ~layers.getTriggerLayers();
+    filter.ignore = &actor;
+    
+    for (uint32_t step = 0; step < CCD_MAX_SUBSTEPS; step++)
     {
-        Actor& actorA = *worldActors[i];
+        if (glm::dot(displacement, displacement) <= 0.f)
+        {
+            break;
+        }
+        
+        SweepHit hit;
+        SpatialQuery::sweepBox(broadphase, collider.min, collider.max, displacement, filter, hit);
+        
+        float firstImpact = hit.timeOfImpact;
+        glm::vec3 firstNormal = hit.normal;
         
-        for (size_t j = 0; j < worldActors.size(); j++)
+        glm::vec3 move = displacement * firstImpact;
+        
+        actor.addActorLocation(move);
+        collider.translate(move);
+        
+        if (firstImpact >= 1.f)
         {
-            Actor& actorB = *worldActors[j];
-            
-            if (&actorA == &actorB)
-            {
-                continue;
-            }
-            
-            if (doesActorCollideWithActor(playerLocation, actorA, actorB, collisionResultA, collisionResultB))
-            {
-                if (!actorA.getPhysicsEnabled())
-                {
-                    continue;
-                }
-                
-                if (actorB.getPhysicsEnabled())
-                {
-                    actorA.addActorLocation((collisionResultA.penetrationInfo.penetrationDepth / 2.f) *
-                                            collisionResultA.penetrationInfo.collisionNormal);
-                    actorB.addActorLocation((collisionResultB.penetrationInfo.penetrationDepth / 2.f) *
-                                            collisionResultB.penetrationInfo.collisionNormal);
-                }
-                else
-                {
-                    actorA.addActorLocation((collisionResultA.penetrationInfo.penetrationDepth) *
-                                            collisionResultA.penetrationInfo.collisionNormal);
-                }
-                
-                actorA.onActorCollision(&actorB, collisionResultA);
-                actorB.onActorCollision(&actorA, collisionResultB);
-
-                if (collisionResultA.penetrationInfo.collisionNormal.y > 0.f)
-                {
-                    if (actorA.getGravitationalVelocity() < 0.f)
-                    {
-                        actorA.setGravitationalVelocity(0.f);
-                    }
-                }
-            }
+            break;
         }
+        
+        if (firstNormal.y > 0.f && actor.getGravitationalVelocity() < 0.f)
+        {
+            actor.setGravitationalVelocity(0.f);
+        }
+        
+        // slide, whatever pushed into the surface is dropped
+        displacement -= move;
+        displacement -= firstNormal * glm::dot(displacement, firstNormal);
     }
 }
 
@@ -6,6 +6,7 @@
 #include <glm/glm.hpp>
 #include "CollisionData.h"
 #include "CollisionConstants.h"
+#include <cfloat>
 
 
 #define X_AXIS glm::vec3(1, 0, 0)
@@ -16,27 +17,6 @@
 using namespace std;
 
 
-bool collisionProfileEnabled(
-    const Actor& actor,
-    CollisionProfile profile
-)
-{
-    return actor.getCollisionProfile() & profile;
-}
-
-
-bool inDistanceForCollisionCheck(
-    const glm::vec3 playerLocation,
-    const Actor& actor
-)
-{
-    if (!actor.getActive())
-        return false;
-    
-    return glm::distance(playerLocation, actor.getWorldLocation()) < (actor.getApproximateBoundingRadius() + PLAYER_CULL_COLLISION_DISTANCE);
-}
-
-
 void calculateBoundingBoxCollisionNormal(
     const glm::vec3 worldLocation,
     const glm::vec3 min,
@@ -130,22 +110,14 @@ bool isBoxInBoundingBox(
         return false;
     }
     
-    cout << penetrationDepth << endl;
-    
-    // FIX MAGIC NUMBER - gravitational_velocity * delta_time
-    if (penetrationDepth < 0.0045f)
-    {
-        return false;
-    }
-    
-    
-    collisionResult.penetrationDepth = (penetrationDepth) * PENETRATION_DEPTH_FORCE;
+    collisionResult.penetrationDepth = penetrationDepth;
     collisionResult.collisionNormal = penetrationAxis;
     
     return true;
 }
 
 
+// Closest point on the box to the sphere's center, a center inside the box leaves by the nearest face
 bool isSphereInBoundingBox(
     const glm::vec3& sphereOrigin,
     const glm::vec3& min,
@@ -154,24 +126,34 @@ bool isSphereInBoundingBox(
     const float radius
 )
 {
-    if (sphereOrigin.x >= min.x - radius && sphereOrigin.x <= max.x + radius &&
-        sphereOrigin.y >= min.y - radius && sphereOrigin.y <= max.y + radius &&
-        sphereOrigin.z >= min.z - radius && sphereOrigin.z <= max.z + radius)
+    glm::vec3 closest = glm::clamp(sphereOrigin, min, max);
+    glm::vec3 offset = sphereOrigin - closest;
+    float distanceSquared = glm::dot(offset, offset);
+    
+    if (distanceSquared > radius * radius)
     {
-        float penetrationDepth = FLT_MAX;
-        glm::vec3 penetrationAxis;
-        
-        calculatePenetration(X_AXIS, sphereOrigin.x - radius, sphereOrigin.x + radius, min.x, max.x, penetrationDepth, penetrationAxis);
-        calculatePenetration(Y_AXIS, sphereOrigin.y - radius, sphereOrigin.y + radius, min.y, max.y, penetrationDepth, penetrationAxis);
-        calculatePenetration(Z_AXIS, sphereOrigin.z - radius, sphereOrigin.z + radius, min.z, max.z, penetrationDepth, penetrationAxis);
+        return false;
+    }
+    
+    if (distanceSquared > 0.f)
+    {
+        float distance = std::sqrt(distanceSquared);
         
-        calculateBoundingBoxCollisionNormal(sphereOrigin, min, max, collisionResult.collisionNormal);
-        collisionResult.penetrationDepth = penetrationDepth * PENETRATION_DEPTH_FORCE;
+        collisionResult.collisionNormal = offset / distance;
+        collisionResult.penetrationDepth = radius - distance;
         
         return true;
     }
     
-    return false;
+    glm::vec3 deltaMin = sphereOrigin - min;
+    glm::vec3 deltaMax = max - sphereOrigin;
+    
+    calculateBoundingBoxCollisionNormal(sphereOrigin, min, max, collisionResult.collisionNormal);
+    
+    float faceDistance = std::min(std::min(std::min(deltaMin.x, deltaMax.x), std::min(deltaMin.y, deltaMax.y)), std::min(deltaMin.z, deltaMax.z));
+    collisionResult.penetrationDepth = faceDistance + radius;
+    
+    return true;
 }
 
 bool isCapsuleInBoundingBox(
@@ -188,7 +170,13 @@ bool isCapsuleInBoundingBox(
     glm::vec3 capsuleStart = capsuleOrigin - orientationHeight;
     glm::vec3 capsuleDirection = 2.f * orientationHeight;
     
-    float t = glm::clamp(glm::dot(glm::clamp(capsuleOrigin, min, max) - capsuleStart, capsuleDirection) / glm::dot(capsuleDirection, capsuleDirection), 0.0f, 1.0f);
+    float lengthSquared = glm::dot(capsuleDirection, capsuleDirection);
+    float t = 0.f;
+    
+    if (lengthSquared > 0.f)
+    {
+        t = glm::clamp(glm::dot(glm::clamp(capsuleOrigin, min, max) - capsuleStart, capsuleDirection) / lengthSquared, 0.0f, 1.0f);
+    }
     
     if (isSphereInBoundingBox(capsuleStart + t * capsuleDirection, min, max, collisionResult, radius))
     {
@@ -198,5 +186,4 @@ bool isCapsuleInBoundingBox(
     return false;
 }
 
-
 #endif
@@ -0,0 +1,235 @@
+#include "ContactSolver.h"
+#include "CollisionManager.h"
+
+
+ContactSolver::ContactSolver()
+{
+}
+
+
+// as the broadphase decides which proxies are dynamic
+static bool isStepped(const Actor* actor)
+{
+    return actor->getPhysicsEnabled() && actor->getSimulationScale() > 0.f;
+}
+
+
+void ContactSolver::solve(const Broadphase& broadphase, const double deltaTime)
+{
+    stats.contacts = 0;
+    stats.warmStarted = 0;
+    stats.maxPenetration = 0.f;
+    stats.residuals.clear();
+
+    buildContacts(broadphase, deltaTime);
+
+    for (Contact& contact : contacts)
+    {
+        applyImpulse(contact, contact.normal * contact.normalImpulse +
+                              contact.tangents[0] * contact.tangentImpulses[0] +
+                              contact.tangents[1] * contact.tangentImpulses[1]);
+    }
+
+    for (uint32_t iteration = 0; iteration < iterations; iteration++)
+    {
+        float residual = 0.f;
+
+        for (Contact& contact : contacts)
+        {
+            SolverBody& a = bodies[contact.a];
+            SolverBody& b = bodies[contact.b];
+
+            // friction first, bounded by the normal impulse found so far
+            float limit = contact.friction * contact.normalImpulse;
+
+            for (int t = 0; t < 2; t++)
+            {
+                float velocity = glm::dot(a.velocity - b.velocity, contact.tangents[t]);
+                float previous = contact.tangentImpulses[t];
+
+                contact.tangentImpulses[t] = glm::clamp(previous - velocity * contact.mass, -limit, limit);
+
+                float change = contact.tangentImpulses[t] - previous;
+                applyImpulse(contact, contact.tangents[t] * change);
+                residual += std::abs(change);
+            }
+
+            float velocity = glm::dot(a.velocity - b.velocity, contact.normal);
+            float previous = contact.normalImpulse;
+
+            contact.normalImpulse = std::max(previous + (contact.bias - velocity) * contact.mass, 0.f);
+
+            float change = contact.normalImpulse - previous;
+            applyImpulse(contact, contact.normal * change);
+            residual += std::abs(change);
+        }
+
+        stats.residuals.push_back(residual);
+    }
+
+    for (const SolverBody& body : bodies)
+    {
+        if (body.inverseMass > 0.f)
+        {
+            body.actor->setActorVelocity(body.velocity);
+        }
+    }
+
+    // pairs with neither actor stepped were not solved this tick, their impulses wait for the next step
+    for (auto it = cache.begin(); it != cache.end();)
+    {
+        const Actor* a = it->first.first;
+        const Actor* b = it->first.second;
+
+        if (a->getActive() && b->getActive() && !isStepped(a) && !isStepped(b))
+        {
+            it++;
+        }
+        else
+        {
+            it = cache.erase(it);
+        }
+    }
+
+    for (const Contact& contact : contacts)
+    {
+        CachedImpulse cached;
+        cached.normal = contact.normal;
+        cached.normalImpulse = contact.normalImpulse;
+        cached.tangentImpulses[0] = contact.tangentImpulses[0];
+        cached.tangentImpulses[1] = contact.tangentImpulses[1];
+
+        cache[{ bodies[contact.a].actor, bodies[contact.b].actor }] = cached;
+    }
+}
+
+
+void ContactSolver::buildContacts(const Broadphase& broadphase, const double deltaTime)
+{
+    bodies.clear();
+    contacts.clear();
+
+    for (uint32_t i = 0; i < broadphase.getStats().proxies; i++)
+    {
+        const BroadphaseProxy& proxy = broadphase.getProxy(i);
+
+        if (proxy.dynamic)
+        {
+            bodies.push_back({ proxy.actor, proxy.actor->getActorVelocity(), 1.f, static_cast<float>(deltaTime) * proxy.actor->getSimulationScale() });
+        }
+        else
+        {
+            bodies.push_back({ proxy.actor, glm::vec3(0), 0.f, 0.f });
+        }
+    }
+
+    DetailedCollisionResponse collisionResultA;
+    DetailedCollisionResponse collisionResultB;
+
+    for (const BroadphasePair& pair : broadphase.getPairs())
+    {
+        // overlaps with triggers are the trigger tracker's
+        if (pair.trigger)
+        {
+            continue;
+        }
+
+        const BroadphaseProxy& proxyA = broadphase.getProxy(pair.a);
+        const BroadphaseProxy& proxyB = broadphase.getProxy(pair.b);
+
+        if (!doesActorCollideWithActor(proxyA, proxyB, collisionResultA, collisionResultB))
+        {
+            continue;
+        }
+
+        proxyA.actor->onActorCollision(proxyB.actor, collisionResultA);
+        proxyB.actor->onActorCollision(proxyA.actor, collisionResultB);
+
+        Contact contact;
+        contact.a = pair.a;
+        contact.b = pair.b;
+        contact.normal = collisionResultA.penetrationInfo.collisionNormal;
+        contact.depth = collisionResultA.penetrationInfo.penetrationDepth;
+        contact.friction = std::sqrt(proxyA.actor->getCollisionSurface().friction * proxyB.actor->getCollisionSurface().friction);
+
+        // over the longer of the two steps, the one the velocity is integrated for
+        float step = std::max(bodies[pair.a].step, bodies[pair.b].step);
+
+        contact.bias = CONTACT_BAUMGARTE / step * std::max(contact.depth - CONTACT_SLOP, 0.f);
+        contact.mass = 1.f / (bodies[pair.a].inverseMass + bodies[pair.b].inverseMass);
+
+        // a fixed basis per normal, so cached tangent impulses mean the same thing next tick
+        glm::vec3 n = contact.normal;
+        glm::vec3 tangent = std::abs(n.x) >= 0.57735f ? glm::vec3(n.y, -n.x, 0.f) : glm::vec3(0.f, n.z, -n.y);
+
+        contact.tangents[0] = glm::normalize(tangent);
+        contact.tangents[1] = glm::cross(n, contact.tangents[0]);
+
+        auto cached = cache.find({ proxyA.actor, proxyB.actor });
+
+        if (warmStarting && cached != cache.end() && glm::dot(cached->second.normal, n) > CONTACT_MATCH_COSINE)
+        {
+            contact.normalImpulse = cached->second.normalImpulse;
+            contact.tangentImpulses[0] = cached->second.tangentImpulses[0];
+            contact.tangentImpulses[1] = cached->second.tangentImpulses[1];
+
+            stats.warmStarted++;
+        }
+
+        stats.maxPenetration = std::max(stats.maxPenetration, contact.depth);
+        contacts.push_back(contact);
+    }
+
+    stats.contacts = contacts.size();
+}
+
+
+void ContactSolver::applyImpulse(const Contact& contact, const glm::vec3& impulse)
+{
+    SolverBody& a = bodies[contact.a];
+    SolverBody& b = bodies[contact.b];
+
+    a.velocity += impulse * a.inverseMass;
+    b.velocity -= impulse * b.inverseMass;
+}
+
+
+void ContactSolver::integrate(const std::vector<Actor*>& actors, const Broadphase& broadphase, const CollisionLayerMatrix& layers,
+                              const double deltaTime)
+{
+    for (Actor* actor : actors)
+    {
+        if (!actor->getActive() || actor->getSimulationScale() <= 0.f)
+        {
+            continue;
+        }
+
+        double step = deltaTime * actor->getSimulationScale();
+
+        actor->move(step);
+
+        // fast movers leave their move to be swept against what the broadphase saw this tick
+        if (glm::dot(actor->getPendingDisplacement(), actor->getPendingDisplacement()) > 0.f)
+        {
+            sweepActor(*actor, actor->takePendingDisplacement(), broadphase, layers);
+        }
+
+        actor->finishMove(step);
+    }
+}
+
+
+void ContactSolver::forget(const Actor* actor)
+{
+    for (auto it = cache.begin(); it != cache.end();)
+    {
+        if (it->first.first == actor || it->first.second == actor)
+        {
+            it = cache.erase(it);
+        }
+        else
+        {
+            it++;
+        }
+    }
+}
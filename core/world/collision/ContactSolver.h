@@ -0,0 +1,119 @@
+#ifndef CONTACTSOLVER_H
+#define CONTACTSOLVER_H
+
+#include "Broadphase.h"
+#include "CollisionLayers.h"
+
+#include <unordered_map>
+
+
+#define CONTACT_SOLVER_ITERATIONS 8
+
+// fraction of the penetration past CONTACT_SLOP fed back into the contact's target velocity
+#define CONTACT_BAUMGARTE 0.2f
+
+// a cached impulse is only reused while the contact normal stays within this cosine
+#define CONTACT_MATCH_COSINE 0.9f
+
+
+// one point of contact between two bodies, the normal moves a out of b
+struct Contact
+{
+    uint32_t a;
+    uint32_t b;
+    glm::vec3 normal;
+    glm::vec3 tangents[2];
+    float depth;
+    float friction;
+    float bias;                 // separating velocity asked for to remove the penetration
+    float mass;                 // effective mass along any direction, bodies do not rotate
+
+    // accumulated over the iterations and carried into the next tick
+    float normalImpulse = 0.f;
+    float tangentImpulses[2] = { 0.f, 0.f };
+};
+
+
+struct CachedImpulse
+{
+    glm::vec3 normal;
+    float normalImpulse;
+    float tangentImpulses[2];
+};
+
+
+struct SolverBody
+{
+    Actor* actor;
+    glm::vec3 velocity;
+    float inverseMass;          // 0 for anything not simulating, every simulating actor weighs the same
+    float step;                 // this tick's length times the actor's simulation scale, 0 when not stepped
+};
+
+
+struct ContactPairHash
+{
+    size_t operator()(const std::pair<const Actor*, const Actor*>& pair) const
+    {
+        return std::hash<const Actor*>()(pair.first) * 31 + std::hash<const Actor*>()(pair.second);
+    }
+};
+
+
+struct ContactSolverStats
+{
+    uint32_t contacts = 0;
+    uint32_t warmStarted = 0;
+    float maxPenetration = 0.f;
+    std::vector<float> residuals;   // total impulse change per iteration, falls as the solve converges
+};
+
+
+/**
+ * @class ContactSolver
+ * @brief Sequential impulse solver over the tick's contacts, warm started from the last tick's.
+ *
+ * Contacts come from the broadphase pairs through the narrowphase. Each iteration walks the
+ * contacts once, first clamping friction to the Coulomb cone of the normal impulse so far, then
+ * driving the normal velocity to the Baumgarte bias with an accumulated impulse that never
+ * pulls. Accumulated impulses are cached per actor pair and applied up front next tick while
+ * the normal has not turned much, so a resting stack starts from last tick's answer instead of
+ * rediscovering it. Pairs with neither actor stepped keep their cached impulse until they are.
+ */
+class ContactSolver {
+private:
+    std::vector<SolverBody> bodies;     // one per broadphase proxy, same indices
+    std::vector<Contact> contacts;
+    std::unordered_map<std::pair<const Actor*, const Actor*>, CachedImpulse, ContactPairHash> cache;
+
+    uint32_t iterations = CONTACT_SOLVER_ITERATIONS;
+    bool warmStarting = true;
+
+    ContactSolverStats stats;
+
+public:
+    ContactSolver();
+
+    // Finds this tick's contacts in the built broadphase, reports them to the actors and solves
+    // their velocities. Expects every actor's update to have run.
+    void solve(const Broadphase& broadphase, const double deltaTime);
+
+    // moves every actor stepped this tick by its solved velocity, sweeping the fast ones against the broadphase
+    void integrate(const std::vector<Actor*>& actors, const Broadphase& broadphase, const CollisionLayerMatrix& layers,
+                   const double deltaTime);
+
+    // drops the cached contacts of an actor about to be deleted
+    void forget(const Actor* actor);
+
+    void setIterations(uint32_t count) { iterations = count; }
+    void setWarmStarting(bool enabled) { warmStarting = enabled; }
+
+    const uint32_t getIterations() const { return iterations; }
+    const ContactSolverStats& getStats() const { return stats; }
+
+private:
+    void buildContacts(const Broadphase& broadphase, const double deltaTime);
+    void applyImpulse(const Contact& contact, const glm::vec3& impulse);
+};
+
+#endif
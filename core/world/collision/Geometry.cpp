@@ -0,0 +1,480 @@
+#include "Geometry.h"
+
+#include <algorithm>
+#include <cfloat>
+
+
+glm::vec3 closestPointOnSegment(const glm::vec3& start, const glm::vec3& end, const glm::vec3& point)
+{
+    glm::vec3 segment = end - start;
+    float lengthSquared = glm::dot(segment, segment);
+
+    if (lengthSquared <= 0.f)
+    {
+        return start;
+    }
+
+    return start + segment * glm::clamp(glm::dot(point - start, segment) / lengthSquared, 0.f, 1.f);
+}
+
+
+void closestPointsOnSegments(
+    const glm::vec3& startA,
+    const glm::vec3& endA,
+    const glm::vec3& startB,
+    const glm::vec3& endB,
+    glm::vec3& pointA,
+    glm::vec3& pointB
+)
+{
+    glm::vec3 d1 = endA - startA;
+    glm::vec3 d2 = endB - startB;
+    glm::vec3 r = startA - startB;
+
+    float a = glm::dot(d1, d1);
+    float e = glm::dot(d2, d2);
+    float f = glm::dot(d2, r);
+
+    float s = 0.f;
+    float t = 0.f;
+
+    if (a <= 0.f && e <= 0.f)
+    {
+        pointA = startA;
+        pointB = startB;
+        return;
+    }
+
+    if (a <= 0.f)
+    {
+        t = glm::clamp(f / e, 0.f, 1.f);
+    }
+    else
+    {
+        float c = glm::dot(d1, r);
+
+        if (e <= 0.f)
+        {
+            s = glm::clamp(-c / a, 0.f, 1.f);
+        }
+        else
+        {
+            float b = glm::dot(d1, d2);
+            float denominator = a * e - b * b;
+
+            if (denominator > 0.f)
+            {
+                s = glm::clamp((b * f - c * e) / denominator, 0.f, 1.f);
+            }
+
+            t = (b * s + f) / e;
+
+            if (t < 0.f)
+            {
+                t = 0.f;
+                s = glm::clamp(-c / a, 0.f, 1.f);
+            }
+            else if (t > 1.f)
+            {
+                t = 1.f;
+                s = glm::clamp((b - c) / a, 0.f, 1.f);
+            }
+        }
+    }
+
+    pointA = startA + d1 * s;
+    pointB = startB + d2 * t;
+}
+
+glm::vec3 closestPointOnTriangle(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const glm::vec3& point)
+{
+    glm::vec3 ab = b - a;
+    glm::vec3 ac = c - a;
+    glm::vec3 ap = point - a;
+
+    float d1 = glm::dot(ab, ap);
+    float d2 = glm::dot(ac, ap);
+
+    if (d1 <= 0.f && d2 <= 0.f)
+    {
+        return a;
+    }
+
+    glm::vec3 bp = point - b;
+    float d3 = glm::dot(ab, bp);
+    float d4 = glm::dot(ac, bp);
+
+    if (d3 >= 0.f && d4 <= d3)
+    {
+        return b;
+    }
+
+    float vc = d1 * d4 - d3 * d2;
+
+    if (vc <= 0.f && d1 >= 0.f && d3 <= 0.f)
+    {
+        return a + ab * (d1 / (d1 - d3));
+    }
+
+    glm::vec3 cp = point - c;
+    float d5 = glm::dot(ab, cp);
+    float d6 = glm::dot(ac, cp);
+
+    if (d6 >= 0.f && d5 <= d6)
+    {
+        return c;
+    }
+
+    float vb = d5 * d2 - d1 * d6;
+
+    if (vb <= 0.f && d2 >= 0.f && d6 <= 0.f)
+    {
+        return a + ac * (d2 / (d2 - d6));
+    }
+
+    float va = d3 * d6 - d5 * d4;
+
+    if (va <= 0.f && (d4 - d3) >= 0.f && (d5 - d6) >= 0.f)
+    {
+        return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+    }
+
+    float denominator = 1.f / (va + vb + vc);
+
+    return a + ab * (vb * denominator) + ac * (vc * denominator);
+}
+
+
+void closestPointsOnSegmentAndTriangle(
+    const glm::vec3& start,
+    const glm::vec3& end,
+    const glm::vec3& a,
+    const glm::vec3& b,
+    const glm::vec3& c,
+    glm::vec3& segmentPoint,
+    glm::vec3& trianglePoint
+)
+{
+    glm::vec3 normal = glm::cross(b - a, c - a);
+    glm::vec3 segment = end - start;
+    float facing = glm::dot(normal, segment);
+
+    // the segment passing through the triangle's plane inside the triangle
+    if (facing != 0.f)
+    {
+        float t = glm::dot(normal, a - start) / facing;
+
+        if (t >= 0.f && t <= 1.f)
+        {
+            glm::vec3 crossing = start + segment * t;
+
+            if (glm::dot(glm::cross(b - a, crossing - a), normal) >= 0.f &&
+                glm::dot(glm::cross(c - b, crossing - b), normal) >= 0.f &&
+                glm::dot(glm::cross(a - c, crossing - c), normal) >= 0.f)
+            {
+                segmentPoint = crossing;
+                trianglePoint = crossing;
+                return;
+            }
+        }
+    }
+
+    // otherwise the closest pair has an end of the segment or lies on an edge of the triangle
+    float bestDistance = FLT_MAX;
+
+    auto consider = [&](const glm::vec3& onSegment, const glm::vec3& onTriangle) {
+        glm::vec3 offset = onSegment - onTriangle;
+        float distance = glm::dot(offset, offset);
+
+        if (distance < bestDistance)
+        {
+            bestDistance = distance;
+            segmentPoint = onSegment;
+            trianglePoint = onTriangle;
+        }
+    };
+
+    consider(start, closestPointOnTriangle(a, b, c, start));
+    consider(end, closestPointOnTriangle(a, b, c, end));
+
+    const glm::vec3* corners[3] = { &a, &b, &c };
+
+    for (int edge = 0; edge < 3; edge++)
+    {
+        glm::vec3 onSegment;
+        glm::vec3 onEdge;
+
+        closestPointsOnSegments(start, end, *corners[edge], *corners[(edge + 1) % 3], onSegment, onEdge);
+        consider(onSegment, onEdge);
+    }
+}
+
+
+bool sweepBoxAgainstBox(
+    const glm::vec3& amin,
+    const glm::vec3& amax,
+    const glm::vec3& displacement,
+    const glm::vec3& bmin,
+    const glm::vec3& bmax,
+    float& timeOfImpact,
+    glm::vec3& collisionNormal
+)
+{
+    float entry = -FLT_MAX;
+    float exit = FLT_MAX;
+    int entryAxis = -1;
+    
+    for (int axis = 0; axis < 3; axis++)
+    {
+        if (displacement[axis] == 0.f)
+        {
+            if (amax[axis] <= bmin[axis] || amin[axis] >= bmax[axis])
+            {
+                return false;
+            }
+            
+            continue;
+        }
+        
+        float t0 = (bmin[axis] - amax[axis]) / displacement[axis];
+        float t1 = (bmax[axis] - amin[axis]) / displacement[axis];
+        
+        if (t0 > t1)
+        {
+            std::swap(t0, t1);
+        }
+        
+        if (t0 > entry)
+        {
+            entry = t0;
+            entryAxis = axis;
+        }
+        
+        exit = std::min(exit, t1);
+        
+        if (entry > exit)
+        {
+            return false;
+        }
+    }
+    
+    if (entryAxis < 0 || entry < 0.f || entry > 1.f)
+    {
+        return false;
+    }
+    
+    collisionNormal = glm::vec3(0);
+    collisionNormal[entryAxis] = displacement[entryAxis] > 0.f ? -1.f : 1.f;
+    timeOfImpact = entry;
+    
+    return true;
+}
+
+
+bool intersectRayBox(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& min, const glm::vec3& max,
+                     float maxDistance, float& distance, glm::vec3& normal)
+{
+    float entry = 0.f;
+    float exit = maxDistance;
+    int entryAxis = -1;
+    float entrySide = 0.f;
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        if (direction[axis] == 0.f)
+        {
+            if (origin[axis] < min[axis] || origin[axis] > max[axis])
+            {
+                return false;
+            }
+
+            continue;
+        }
+
+        float inverse = 1.f / direction[axis];
+        float t0 = (min[axis] - origin[axis]) * inverse;
+        float t1 = (max[axis] - origin[axis]) * inverse;
+
+        if (t0 > t1)
+        {
+            std::swap(t0, t1);
+        }
+
+        if (t0 > entry)
+        {
+            entry = t0;
+            entryAxis = axis;
+            entrySide = direction[axis] > 0.f ? -1.f : 1.f;
+        }
+
+        exit = std::min(exit, t1);
+
+        if (entry > exit)
+        {
+            return false;
+        }
+    }
+
+    distance = entry;
+    normal = -direction;
+
+    if (entryAxis >= 0)
+    {
+        normal = glm::vec3(0);
+        normal[entryAxis] = entrySide;
+    }
+
+    return true;
+}
+
+
+bool intersectRaySphere(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& center, float radius,
+                        float maxDistance, float& distance, glm::vec3& normal)
+{
+    glm::vec3 offset = origin - center;
+    float b = glm::dot(offset, direction);
+    float c = glm::dot(offset, offset) - radius * radius;
+
+    if (c <= 0.f)
+    {
+        distance = 0.f;
+        normal = -direction;
+        return true;
+    }
+
+    // outside and pointing away
+    if (b > 0.f)
+    {
+        return false;
+    }
+
+    float discriminant = b * b - c;
+
+    if (discriminant < 0.f)
+    {
+        return false;
+    }
+
+    distance = -b - std::sqrt(discriminant);
+
+    if (distance > maxDistance)
+    {
+        return false;
+    }
+
+    normal = (offset + direction * distance) / radius;
+    return true;
+}
+
+
+bool intersectRayCapsule(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& start, const glm::vec3& end,
+                         float radius, float maxDistance, float& distance, glm::vec3& normal)
+{
+    glm::vec3 closest = closestPointOnSegment(start, end, origin);
+
+    if (glm::dot(origin - closest, origin - closest) <= radius * radius)
+    {
+        distance = 0.f;
+        normal = -direction;
+        return true;
+    }
+
+    bool hit = false;
+    float capDistance;
+    glm::vec3 capNormal;
+
+    for (const glm::vec3* cap : { &start, &end })
+    {
+        if (intersectRaySphere(origin, direction, *cap, radius, maxDistance, capDistance, capNormal) && (!hit || capDistance < distance))
+        {
+            distance = capDistance;
+            normal = capNormal;
+            hit = true;
+        }
+    }
+
+    glm::vec3 segment = end - start;
+    float length = glm::length(segment);
+
+    if (length <= 0.f)
+    {
+        return hit;
+    }
+
+    // the infinite cylinder, with the axis projected out of the ray
+    glm::vec3 axis = segment / length;
+    glm::vec3 offset = origin - start;
+    glm::vec3 offsetAcross = offset - axis * glm::dot(offset, axis);
+    glm::vec3 directionAcross = direction - axis * glm::dot(direction, axis);
+
+    float a = glm::dot(directionAcross, directionAcross);
+    float b = glm::dot(offsetAcross, directionAcross);
+    float c = glm::dot(offsetAcross, offsetAcross) - radius * radius;
+    float discriminant = b * b - a * c;
+
+    if (a <= 1e-8f || discriminant < 0.f)
+    {
+        return hit;
+    }
+
+    float t = (-b - std::sqrt(discriminant)) / a;
+    float along = glm::dot(offset + direction * t, axis);
+
+    if (t >= 0.f && t <= maxDistance && along >= 0.f && along <= length && (!hit || t < distance))
+    {
+        distance = t;
+        normal = (offsetAcross + directionAcross * t) / radius;
+        hit = true;
+    }
+
+    return hit;
+}
+
+
+bool intersectRayTriangle(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& a, const glm::vec3& b,
+                          const glm::vec3& c, float maxDistance, float& distance, glm::vec3& normal)
+{
+    glm::vec3 ab = b - a;
+    glm::vec3 ac = c - a;
+    glm::vec3 p = glm::cross(direction, ac);
+    float determinant = glm::dot(ab, p);
+
+    if (std::abs(determinant) < 1e-12f)
+    {
+        return false;
+    }
+
+    float inverse = 1.f / determinant;
+    glm::vec3 offset = origin - a;
+    float u = glm::dot(offset, p) * inverse;
+
+    if (u < 0.f || u > 1.f)
+    {
+        return false;
+    }
+
+    glm::vec3 q = glm::cross(offset, ab);
+    float v = glm::dot(direction, q) * inverse;
+
+    if (v < 0.f || u + v > 1.f)
+    {
+        return false;
+    }
+
+    float t = glm::dot(ac, q) * inverse;
+
+    if (t < 0.f || t > maxDistance)
+    {
+        return false;
+    }
+
+    distance = t;
+    normal = glm::normalize(glm::cross(ab, ac));
+
+    if (glm::dot(normal, direction) > 0.f)
+    {
+        normal = -normal;
+    }
+
+    return true;
+}
@@ -0,0 +1,67 @@
+#ifndef GEOMETRY_H
+#define GEOMETRY_H
+
+#include <glm/glm.hpp>
+
+
+// The closest point and sweep queries shared by the narrowphase kernels and the mesh collider.
+// Defined once in Geometry.cpp, unlike the kernels they can be called from any translation unit.
+
+glm::vec3 closestPointOnSegment(const glm::vec3& start, const glm::vec3& end, const glm::vec3& point);
+
+// Closest points between two segments, from Ericson's Real-Time Collision Detection 5.1.9
+void closestPointsOnSegments(
+    const glm::vec3& startA,
+    const glm::vec3& endA,
+    const glm::vec3& startB,
+    const glm::vec3& endB,
+    glm::vec3& pointA,
+    glm::vec3& pointB
+);
+
+// Closest point on triangle abc, by Voronoi region, from Ericson 5.1.5
+glm::vec3 closestPointOnTriangle(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const glm::vec3& point);
+
+// Closest points between a segment and triangle abc, both the same point where the segment crosses it
+void closestPointsOnSegmentAndTriangle(
+    const glm::vec3& start,
+    const glm::vec3& end,
+    const glm::vec3& a,
+    const glm::vec3& b,
+    const glm::vec3& c,
+    glm::vec3& segmentPoint,
+    glm::vec3& trianglePoint
+);
+
+// Slab test of box a moving by displacement against the still box b. Gives the fraction of the
+// move at first contact and the normal of the face hit. Boxes already overlapping are left to
+// the discrete narrowphase.
+bool sweepBoxAgainstBox(
+    const glm::vec3& amin,
+    const glm::vec3& amax,
+    const glm::vec3& displacement,
+    const glm::vec3& bmin,
+    const glm::vec3& bmax,
+    float& timeOfImpact,
+    glm::vec3& collisionNormal
+);
+
+// Ray casts give the distance along a unit direction to where the ray enters the shape and the
+// surface normal there. A ray starting inside enters at 0, facing back along the ray.
+
+// slab test, the normal is the face entered through
+bool intersectRayBox(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& min, const glm::vec3& max,
+                     float maxDistance, float& distance, glm::vec3& normal);
+
+bool intersectRaySphere(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& center, float radius,
+                        float maxDistance, float& distance, glm::vec3& normal);
+
+// the two end spheres and the cylinder between them, nearest wins
+bool intersectRayCapsule(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& start, const glm::vec3& end,
+                         float radius, float maxDistance, float& distance, glm::vec3& normal);
+
+// Moller-Trumbore, both faces hit, the normal faces the ray
+bool intersectRayTriangle(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& a, const glm::vec3& b,
+                          const glm::vec3& c, float maxDistance, float& distance, glm::vec3& normal);
+
+#endif
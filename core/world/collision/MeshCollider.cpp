@@ -0,0 +1,391 @@
+#include "MeshCollider.h"
+#include "Geometry.h"
+#include "MeshCooker.h"
+
+#include <cfloat>
+
+
+// bounds of a box after an affine transform, from Arvo's Graphics Gems method
+static void transformBox(const glm::mat4& transform, const glm::vec3& min, const glm::vec3& max, glm::vec3& outMin, glm::vec3& outMax)
+{
+    glm::vec3 center = glm::vec3(transform * glm::vec4((min + max) * 0.5f, 1.f));
+    glm::vec3 extent = (max - min) * 0.5f;
+    glm::vec3 reach;
+
+    for (int row = 0; row < 3; row++)
+    {
+        reach[row] = std::abs(transform[0][row]) * extent.x + std::abs(transform[1][row]) * extent.y + std::abs(transform[2][row]) * extent.z;
+    }
+
+    outMin = center - reach;
+    outMax = center + reach;
+}
+
+
+template <typename Visit>
+void MeshCollider::traverse(const WorldCollider& mesh, const glm::vec3& min, const glm::vec3& max, Visit visit)
+{
+    const std::vector<BvhNode>& nodes = mesh.mesh->bvhNodes;
+
+    if (nodes.empty())
+    {
+        return;
+    }
+
+    glm::vec3 localMin;
+    glm::vec3 localMax;
+    transformBox(glm::inverse(mesh.model), min, max, localMin, localMax);
+
+    // the cooker stops splitting at BVH_MAX_DEPTH, and each level leaves at most one sibling waiting
+    uint32_t stack[BVH_MAX_DEPTH + 1];
+    uint32_t size = 0;
+
+    stack[size++] = 0;
+
+    while (size > 0)
+    {
+        const BvhNode& node = nodes[stack[--size]];
+
+        // bitwise ors, all six compares run without a branch between them
+        bool outside = (node.min.x > localMax.x) | (node.max.x < localMin.x) |
+                       (node.min.y > localMax.y) | (node.max.y < localMin.y) |
+                       (node.min.z > localMax.z) | (node.max.z < localMin.z);
+
+        if (outside)
+        {
+            continue;
+        }
+
+        if (node.count > 0)
+        {
+            for (uint32_t i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++)
+            {
+                visit(mesh.mesh->bvhTriangles[i]);
+            }
+
+            continue;
+        }
+
+        stack[size++] = node.leftOrFirst + 1;
+        stack[size++] = node.leftOrFirst;
+    }
+}
+
+
+void MeshCollider::getTriangle(const WorldCollider& mesh, uint32_t triangle, glm::vec3 (&corners)[3])
+{
+    const Object& object = *mesh.mesh;
+
+    for (int k = 0; k < 3; k++)
+    {
+        corners[k] = glm::vec3(mesh.model * glm::vec4(object.vertices[object.indices[triangle * 3 + k]].pos, 1.f));
+    }
+}
+
+
+void MeshCollider::query(const WorldCollider& mesh, const glm::vec3& min, const glm::vec3& max, std::vector<uint32_t>& triangles)
+{
+    traverse(mesh, min, max, [&](uint32_t triangle) {
+        triangles.push_back(triangle);
+    });
+}
+
+
+bool MeshCollider::collideBox(const WorldCollider& box, const WorldCollider& mesh, BasicCollisionResponse& contact)
+{
+    bool hit = false;
+
+    traverse(mesh, box.min, box.max, [&](uint32_t triangle) {
+        glm::vec3 corners[3];
+        BasicCollisionResponse candidate;
+
+        getTriangle(mesh, triangle, corners);
+
+        if (collideBoxTriangle(box, corners, candidate) && (!hit || candidate.penetrationDepth > contact.penetrationDepth))
+        {
+            contact = candidate;
+            hit = true;
+        }
+    });
+
+    return hit;
+}
+
+
+bool MeshCollider::collideCapsule(const WorldCollider& capsule, const WorldCollider& mesh, BasicCollisionResponse& contact)
+{
+    bool hit = false;
+
+    traverse(mesh, capsule.min, capsule.max, [&](uint32_t triangle) {
+        glm::vec3 corners[3];
+        BasicCollisionResponse candidate;
+
+        getTriangle(mesh, triangle, corners);
+
+        if (collideCapsuleTriangle(capsule, corners, candidate) && (!hit || candidate.penetrationDepth > contact.penetrationDepth))
+        {
+            contact = candidate;
+            hit = true;
+        }
+    });
+
+    return hit;
+}
+
+
+bool MeshCollider::sweepBox(const glm::vec3& min, const glm::vec3& max, const glm::vec3& displacement,
+                            const WorldCollider& mesh, float& timeOfImpact, glm::vec3& collisionNormal)
+{
+    bool hit = false;
+
+    glm::vec3 sweptMin = glm::min(min, min + displacement);
+    glm::vec3 sweptMax = glm::max(max, max + displacement);
+
+    traverse(mesh, sweptMin, sweptMax, [&](uint32_t triangle) {
+        glm::vec3 corners[3];
+        getTriangle(mesh, triangle, corners);
+
+        glm::vec3 triangleMin = glm::min(corners[0], glm::min(corners[1], corners[2]));
+        glm::vec3 triangleMax = glm::max(corners[0], glm::max(corners[1], corners[2]));
+
+        float impact;
+        glm::vec3 normal;
+
+        if (sweepBoxAgainstBox(min, max, displacement, triangleMin, triangleMax, impact, normal) && (!hit || impact < timeOfImpact))
+        {
+            timeOfImpact = impact;
+            collisionNormal = normal;
+            hit = true;
+        }
+    });
+
+    return hit;
+}
+
+
+// where a ray enters a node's bounds, FLT_MAX if it misses them before limit
+static float enterNode(const BvhNode& node, const glm::vec3& origin, const glm::vec3& inverseDirection, float limit)
+{
+    glm::vec3 t0 = (node.min - origin) * inverseDirection;
+    glm::vec3 t1 = (node.max - origin) * inverseDirection;
+    glm::vec3 near = glm::min(t0, t1);
+    glm::vec3 far = glm::max(t0, t1);
+
+    float entry = std::max(std::max(near.x, near.y), std::max(near.z, 0.f));
+    float exit = std::min(std::min(far.x, far.y), std::min(far.z, limit));
+
+    return entry <= exit ? entry : FLT_MAX;
+}
+
+
+// The walk is in object space, where the parameter along the ray is the same as in world space
+// as long as the direction is carried over unnormalized. Triangles are hit in world space.
+bool MeshCollider::raycast(const WorldCollider& mesh, const glm::vec3& origin, const glm::vec3& direction, float maxDistance,
+                           float& distance, glm::vec3& normal)
+{
+    const std::vector<BvhNode>& nodes = mesh.mesh->bvhNodes;
+
+    if (nodes.empty())
+    {
+        return false;
+    }
+
+    glm::mat4 inverseModel = glm::inverse(mesh.model);
+    glm::vec3 localOrigin = glm::vec3(inverseModel * glm::vec4(origin, 1.f));
+    glm::vec3 localDirection = glm::vec3(inverseModel * glm::vec4(direction, 0.f));
+    glm::vec3 inverseDirection = 1.f / localDirection;
+
+    bool hit = false;
+    float best = maxDistance;
+
+    uint32_t stack[BVH_MAX_DEPTH + 1];
+    uint32_t size = 0;
+
+    if (enterNode(nodes[0], localOrigin, inverseDirection, best) != FLT_MAX)
+    {
+        stack[size++] = 0;
+    }
+
+    while (size > 0)
+    {
+        const BvhNode& node = nodes[stack[--size]];
+
+        if (node.count > 0)
+        {
+            for (uint32_t i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++)
+            {
+                glm::vec3 corners[3];
+                float t;
+                glm::vec3 n;
+
+                getTriangle(mesh, mesh.mesh->bvhTriangles[i], corners);
+
+                if (intersectRayTriangle(origin, direction, corners[0], corners[1], corners[2], best, t, n))
+                {
+                    best = t;
+                    normal = n;
+                    hit = true;
+                }
+            }
+
+            continue;
+        }
+
+        uint32_t near = node.leftOrFirst;
+        uint32_t far = node.leftOrFirst + 1;
+        float nearEntry = enterNode(nodes[near], localOrigin, inverseDirection, best);
+        float farEntry = enterNode(nodes[far], localOrigin, inverseDirection, best);
+
+        if (farEntry < nearEntry)
+        {
+            std::swap(near, far);
+            std::swap(nearEntry, farEntry);
+        }
+
+        // the nearer child goes on top, the farther one may be past the best hit by the time it is popped
+        if (farEntry != FLT_MAX)
+        {
+            stack[size++] = far;
+        }
+
+        if (nearEntry != FLT_MAX)
+        {
+            stack[size++] = near;
+        }
+    }
+
+    distance = best;
+    return hit;
+}
+
+
+// Separating axis test over the box's 3 faces, the triangle's face and the 9 edge cross products.
+// The contact is the axis of least overlap, pointing the way that overlap is undone.
+bool MeshCollider::collideBoxTriangle(const WorldCollider& box, const glm::vec3 (&triangle)[3], BasicCollisionResponse& contact)
+{
+    glm::vec3 edges[3] = { triangle[1] - triangle[0], triangle[2] - triangle[1], triangle[0] - triangle[2] };
+
+    float bestOverlap = FLT_MAX;
+    glm::vec3 bestAxis(0, 1, 0);
+
+    auto separated = [&](glm::vec3 axis) {
+        float lengthSquared = glm::dot(axis, axis);
+
+        if (lengthSquared < 1e-8f)
+        {
+            return false;
+        }
+
+        axis /= std::sqrt(lengthSquared);
+
+        float center = glm::dot(box.center, axis);
+        float reach = 0.f;
+
+        for (int i = 0; i < 3; i++)
+        {
+            reach += std::abs(glm::dot(box.axes[i], axis)) * box.halfExtents[i];
+        }
+
+        float p0 = glm::dot(triangle[0], axis);
+        float p1 = glm::dot(triangle[1], axis);
+        float p2 = glm::dot(triangle[2], axis);
+
+        float triangleMin = std::min(p0, std::min(p1, p2));
+        float triangleMax = std::max(p0, std::max(p1, p2));
+
+        float pushPositive = triangleMax - (center - reach);
+        float pushNegative = (center + reach) - triangleMin;
+
+        if (pushPositive < 0.f || pushNegative < 0.f)
+        {
+            return true;
+        }
+
+        if (pushPositive < bestOverlap)
+        {
+            bestOverlap = pushPositive;
+            bestAxis = axis;
+        }
+
+        if (pushNegative < bestOverlap)
+        {
+            bestOverlap = pushNegative;
+            bestAxis = -axis;
+        }
+
+        return false;
+    };
+
+    if (separated(glm::cross(edges[0], edges[1])))
+    {
+        return false;
+    }
+
+    for (int i = 0; i < 3; i++)
+    {
+        if (separated(box.axes[i]))
+        {
+            return false;
+        }
+    }
+
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            if (separated(glm::cross(box.axes[i], edges[j])))
+            {
+                return false;
+            }
+        }
+    }
+
+    contact.collisionNormal = bestAxis;
+    contact.penetrationDepth = bestOverlap;
+
+    return true;
+}
+
+
+bool MeshCollider::collideCapsuleTriangle(const WorldCollider& capsule, const glm::vec3 (&triangle)[3], BasicCollisionResponse& contact)
+{
+    glm::vec3 onSegment;
+    glm::vec3 onTriangle;
+
+    closestPointsOnSegmentAndTriangle(capsule.segmentStart, capsule.segmentEnd, triangle[0], triangle[1], triangle[2], onSegment, onTriangle);
+
+    glm::vec3 offset = onSegment - onTriangle;
+    float distanceSquared = glm::dot(offset, offset);
+
+    if (distanceSquared > capsule.radius * capsule.radius)
+    {
+        return false;
+    }
+
+    float distance = std::sqrt(distanceSquared);
+
+    if (distance > 0.f)
+    {
+        contact.collisionNormal = offset / distance;
+        contact.penetrationDepth = capsule.radius - distance;
+        return true;
+    }
+
+    // the segment passes through the triangle, push out the side its middle is on by the deeper end
+    glm::vec3 normal = glm::cross(triangle[1] - triangle[0], triangle[2] - triangle[0]);
+    float length = glm::length(normal);
+
+    normal = length > 0.f ? normal / length : glm::vec3(0, 1, 0);
+
+    if (glm::dot((capsule.segmentStart + capsule.segmentEnd) * 0.5f - triangle[0], normal) < 0.f)
+    {
+        normal = -normal;
+    }
+
+    float behind = std::min(glm::dot(capsule.segmentStart - triangle[0], normal), glm::dot(capsule.segmentEnd - triangle[0], normal));
+
+    contact.collisionNormal = normal;
+    contact.penetrationDepth = capsule.radius - std::min(behind, 0.f);
+
+    return true;
+}
@@ -0,0 +1,47 @@
+#ifndef MESHCOLLIDER_H
+#define MESHCOLLIDER_H
+
+#include "VulkanUtils.h"
+#include "CollisionData.h"
+
+
+/**
+ * @class MeshCollider
+ * @brief Collision of boxes, spheres and capsules with a static mesh's triangles, through its BVH.
+ *
+ * The mover's bounds are taken into the mesh's object space and the cooked BVH is walked with a
+ * fixed stack, testing a node's bounds against the query with one branchless compare per
+ * axis. Only triangles under overlapping leaves are brought into world space and tested, and the
+ * deepest contact among them is the one reported. Contact normals move the mover out of the mesh.
+ */
+class MeshCollider {
+public:
+    // box is read as its oriented box, so AABBs and OBBs both work
+    static bool collideBox(const WorldCollider& box, const WorldCollider& mesh, BasicCollisionResponse& contact);
+
+    // a sphere is a capsule whose segment is its center
+    static bool collideCapsule(const WorldCollider& capsule, const WorldCollider& mesh, BasicCollisionResponse& contact);
+
+    // as sweepBoxAgainstBox, against the bounds of each triangle the sweep could reach
+    static bool sweepBox(const glm::vec3& min, const glm::vec3& max, const glm::vec3& displacement,
+                         const WorldCollider& mesh, float& timeOfImpact, glm::vec3& collisionNormal);
+
+    // nearest triangle hit along a unit direction, children are visited nearest first and skipped past the best hit
+    static bool raycast(const WorldCollider& mesh, const glm::vec3& origin, const glm::vec3& direction, float maxDistance,
+                        float& distance, glm::vec3& normal);
+
+    // the per triangle tests, in world space
+    static bool collideBoxTriangle(const WorldCollider& box, const glm::vec3 (&triangle)[3], BasicCollisionResponse& contact);
+    static bool collideCapsuleTriangle(const WorldCollider& capsule, const glm::vec3 (&triangle)[3], BasicCollisionResponse& contact);
+
+    static void getTriangle(const WorldCollider& mesh, uint32_t triangle, glm::vec3 (&corners)[3]);
+
+    // triangles under the leaves overlapping a world-space box, a triangle may be listed that does not touch it
+    static void query(const WorldCollider& mesh, const glm::vec3& min, const glm::vec3& max, std::vector<uint32_t>& triangles);
+
+private:
+    template <typename Visit>
+    static void traverse(const WorldCollider& mesh, const glm::vec3& min, const glm::vec3& max, Visit visit);
+};
+
+#endif
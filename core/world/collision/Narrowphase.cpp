@@ -0,0 +1,247 @@
+#include "Narrowphase.h"
+#include "CollisionUtils.h"
+#include "Geometry.h"
+#include "MeshCollider.h"
+#include <cfloat>
+
+
+glm::vec3 toColliderSpace(const WorldCollider& box, const glm::vec3& point)
+{
+    glm::vec3 offset = point - box.center;
+
+    return glm::vec3(glm::dot(offset, box.axes[0]), glm::dot(offset, box.axes[1]), glm::dot(offset, box.axes[2]));
+}
+
+
+glm::vec3 fromColliderSpace(const WorldCollider& box, const glm::vec3& direction)
+{
+    return box.axes[0] * direction.x + box.axes[1] * direction.y + box.axes[2] * direction.z;
+}
+
+
+bool isSphereInSphere(
+    const glm::vec3& centerA,
+    const float radiusA,
+    const glm::vec3& centerB,
+    const float radiusB,
+    BasicCollisionResponse& contact
+)
+{
+    glm::vec3 offset = centerA - centerB;
+    float distanceSquared = glm::dot(offset, offset);
+    float reach = radiusA + radiusB;
+
+    if (distanceSquared > reach * reach)
+    {
+        return false;
+    }
+
+    float distance = std::sqrt(distanceSquared);
+
+    // concentric, push straight up
+    contact.collisionNormal = distance > 0.f ? offset / distance : glm::vec3(0, 1, 0);
+    contact.penetrationDepth = reach - distance;
+
+    return true;
+}
+
+
+/*-------------------------------------------------*/
+
+
+bool collideAabbAabb(const WorldCollider& a, const WorldCollider& b, BasicCollisionResponse& contact)
+{
+    return isBoxInBoundingBox(a.min, a.max, b.min, b.max, contact);
+}
+
+
+bool collideSphereAabb(const WorldCollider& a, const WorldCollider& b, BasicCollisionResponse& contact)
+{
+    return isSphereInBoundingBox(a.center, b.min, b.max, contact, a.radius);
+}
+
+
+bool collideCapsuleAabb(const WorldCollider& a, const WorldCollider& b, BasicCollisionResponse& contact)
+{
+    glm::vec3 origin = (a.segmentStart + a.segmentEnd) * 0.5f;
+
+    return isCapsuleInBoundingBox(origin, a.axes[1], b.min, b.max, contact, glm::length(a.segmentEnd - origin), a.radius);
+}
+
+
+bool collideSphereSphere(const WorldCollider& a, const WorldCollider& b, BasicCollisionResponse& contact)
+{
+    return isSphereInSphere(a.center, a.radius, b.center, b.radius, contact);
+}
+
+
+bool collideSphereCapsule(const WorldCollider& a, const WorldCollider& b, BasicCollisionResponse& contact)
+{
+    return isSphereInSphere(a.center, a.radius, closestPointOnSegment(b.segmentStart, b.segmentEnd, a.center), b.radius, contact);
+}
+
+
+bool collideCapsuleCapsule(const WorldCollider& a, const WorldCollider& b, BasicCollisionResponse& contact)
+{
+    glm::vec3 pointA;
+    glm::vec3 pointB;
+
+    closestPointsOnSegments(a.segmentStart, a.segmentEnd, b.segmentStart, b.segmentEnd, pointA, pointB);
+
+    return isSphereInSphere(pointA, a.radius, pointB, b.radius, contact);
+}
+
+
+// the sphere and capsule against OBB kernels run the AABB ones in the box's frame
+bool collideSphereObb(const WorldCollider& a, const WorldCollider& b, BasicCollisionResponse& contact)
+{
+    if (!isSphereInBoundingBox(toColliderSpace(b, a.center), -b.halfExtents, b.halfExtents, contact, a.radius))
+    {
+        return false;
+    }
+
+    contact.collisionNormal = fromColliderSpace(b, contact.collisionNormal);
+    return true;
+}
+
+
+bool collideCapsuleObb(const WorldCollider& a, const WorldCollider& b, BasicCollisionResponse& contact)
+{
+    glm::vec3 start = toColliderSpace(b, a.segmentStart);
+    glm::vec3 end = toColliderSpace(b, a.segmentEnd);
+    glm::vec3 origin = (start + end) * 0.5f;
+    float halfHeight = glm::length(end - origin);
+    glm::vec3 orientation = halfHeight > 0.f ? (end - origin) / halfHeight : glm::vec3(0, 1, 0);
+
+    if (!isCapsuleInBoundingBox(origin, orientation, -b.halfExtents, b.halfExtents, contact, halfHeight, a.radius))
+    {
+        return false;
+    }
+
+    contact.collisionNormal = fromColliderSpace(b, contact.collisionNormal);
+    return true;
+}
+
+
+// Separating axis test over the 3 + 3 face normals and 9 edge cross products, the contact is the
+// axis of least overlap. Any shape's box works here, which is how AABBs meet OBBs.
+bool collideObbObb(const WorldCollider& a, const WorldCollider& b, BasicCollisionResponse& contact)
+{
+    glm::vec3 offset = a.center - b.center;
+    float bestOverlap = FLT_MAX;
+    glm::vec3 bestAxis(0, 1, 0);
+
+    auto separated = [&](glm::vec3 axis) {
+        float lengthSquared = glm::dot(axis, axis);
+
+        // edges that are parallel give no axis, the face axes cover that case
+        if (lengthSquared < 1e-8f)
+        {
+            return false;
+        }
+
+        axis /= std::sqrt(lengthSquared);
+
+        float projectedA = 0.f;
+        float projectedB = 0.f;
+
+        for (int i = 0; i < 3; i++)
+        {
+            projectedA += std::abs(glm::dot(a.axes[i], axis)) * a.halfExtents[i];
+            projectedB += std::abs(glm::dot(b.axes[i], axis)) * b.halfExtents[i];
+        }
+
+        float distance = glm::dot(offset, axis);
+        float overlap = projectedA + projectedB - std::abs(distance);
+
+        if (overlap < 0.f)
+        {
+            return true;
+        }
+
+        if (overlap < bestOverlap)
+        {
+            bestOverlap = overlap;
+            bestAxis = distance < 0.f ? -axis : axis;
+        }
+
+        return false;
+    };
+
+    for (int i = 0; i < 3; i++)
+    {
+        if (separated(a.axes[i]) || separated(b.axes[i]))
+        {
+            return false;
+        }
+    }
+
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            if (separated(glm::cross(a.axes[i], b.axes[j])))
+            {
+                return false;
+            }
+        }
+    }
+
+    contact.collisionNormal = bestAxis;
+    contact.penetrationDepth = bestOverlap;
+
+    return true;
+}
+
+
+bool collideBoxMesh(const WorldCollider& a, const WorldCollider& b, BasicCollisionResponse& contact)
+{
+    return MeshCollider::collideBox(a, b, contact);
+}
+
+
+bool collideCapsuleMesh(const WorldCollider& a, const WorldCollider& b, BasicCollisionResponse& contact)
+{
+    return MeshCollider::collideCapsule(a, b, contact);
+}
+
+
+// a mesh is only ever met by the shapes that move, two meshes never collide, this fills the table's corner
+bool collideMeshMesh(const WorldCollider& /*a*/, const WorldCollider& /*b*/, BasicCollisionResponse& /*contact*/)
+{
+    return false;
+}
+
+
+// runs the kernel with the shapes swapped and turns the contact around
+template <NarrowphaseKernel kernel>
+bool collideFlipped(const WorldCollider& a, const WorldCollider& b, BasicCollisionResponse& contact)
+{
+    if (!kernel(b, a, contact))
+    {
+        return false;
+    }
+
+    contact.collisionNormal = -contact.collisionNormal;
+    return true;
+}
+
+
+/*-------------------------------------------------*/
+
+
+// indexed [a.shape][b.shape], in ColliderShape order
+const NarrowphaseKernel narrowphaseKernels[CS_COUNT][CS_COUNT] = {
+    { collideAabbAabb, collideFlipped<collideSphereAabb>, collideFlipped<collideCapsuleAabb>, collideObbObb, collideBoxMesh },
+    { collideSphereAabb, collideSphereSphere, collideSphereCapsule, collideSphereObb, collideCapsuleMesh },
+    { collideCapsuleAabb, collideFlipped<collideSphereCapsule>, collideCapsuleCapsule, collideCapsuleObb, collideCapsuleMesh },
+    { collideObbObb, collideFlipped<collideSphereObb>, collideFlipped<collideCapsuleObb>, collideObbObb, collideBoxMesh },
+    { collideFlipped<collideBoxMesh>, collideFlipped<collideCapsuleMesh>, collideFlipped<collideCapsuleMesh>, collideFlipped<collideBoxMesh>, collideMeshMesh }
+};
+
+
+// dispatches a pair of colliders to its kernel, the contact has the raw penetration depth
+bool collideColliders(const WorldCollider& a, const WorldCollider& b, BasicCollisionResponse& contact)
+{
+    return narrowphaseKernels[a.shape][b.shape](a, b, contact);
+}
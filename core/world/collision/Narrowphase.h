@@ -0,0 +1,17 @@
+#ifndef NARROWPHASE_H
+#define NARROWPHASE_H
+
+#include <glm/glm.hpp>
+#include "CollisionData.h"
+
+
+// Every kernel fills a contact whose normal moves a out of b, with the raw penetration depth.
+// They read nothing but the two colliders and allocate nothing, so a list of pairs can be run
+// through them in any order or in parallel.
+typedef bool (*NarrowphaseKernel)(const WorldCollider& a, const WorldCollider& b, BasicCollisionResponse& contact);
+
+
+// dispatches a pair of colliders to its kernel, the contact has the raw penetration depth
+bool collideColliders(const WorldCollider& a, const WorldCollider& b, BasicCollisionResponse& contact);
+
+#endif
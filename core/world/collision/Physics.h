@@ -2,6 +2,37 @@
 #define PHYSICS_H
 
 
+// fixed simulation step, continuous collision keeps fast movers from tunnelling at this rate
+#define PHYSICS_DELTA_TIME (1.0 / 30.0)
+
+// the step gravity and damping were tuned at, both are applied per step of this length
+#define PHYSICS_REFERENCE_DELTA_TIME 0.016
+
+// a move longer than this fraction of the actor's smallest extent is swept instead of teleported
+#define CCD_MOTION_THRESHOLD 0.5f
+
+// slides after the first impact within one step
+#define CCD_MAX_SUBSTEPS 4
+
+// Simulation tiers by distance from the player. Reduced actors step once every
+// SIM_REDUCED_INTERVAL ticks by the time gone since their last step. An actor only drops a tier
+// once it is SIM_TIER_HYSTERESIS past the boundary it came in over.
+#define SIM_FULL_DISTANCE 15.f
+#define SIM_REDUCED_DISTANCE 40.f
+#define SIM_REDUCED_INTERVAL 4
+#define SIM_TIER_HYSTERESIS 2.f
+
+
+/**
+ * @enum SimulationTier
+ * @brief How often an actor is simulated, assigned each tick by the world's SimulationLod.
+ */
+enum SimulationTier
+{
+    ST_FULL = 0,            // every tick
+    ST_REDUCED = 1,         // every SIM_REDUCED_INTERVAL ticks, with a step that long
+    ST_FROZEN = 2           // not at all, collides as if static and keeps its velocity for later
+};
 
 
 #endif
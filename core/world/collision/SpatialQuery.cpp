@@ -0,0 +1,189 @@
+#include "SpatialQuery.h"
+#include "Narrowphase.h"
+#include "Geometry.h"
+#include "MeshCollider.h"
+
+
+bool SpatialQuery::accepts(const BroadphaseProxy& proxy, const QueryFilter& filter)
+{
+    return proxy.actor != filter.ignore && (filter.triggers || !proxy.trigger);
+}
+
+
+bool SpatialQuery::raycast(const Broadphase& broadphase, const Ray& ray, const QueryFilter& filter, RaycastHit& hit)
+{
+    hit = RaycastHit();
+
+    float length = glm::length(ray.direction);
+
+    if (length <= 0.f)
+    {
+        return false;
+    }
+
+    glm::vec3 direction = ray.direction / length;
+    glm::vec3 end = ray.origin + direction * ray.maxDistance;
+    float best = ray.maxDistance;
+
+    broadphase.visit(glm::min(ray.origin, end), glm::max(ray.origin, end), filter.layerMask, [&](uint32_t i) {
+        const BroadphaseProxy& proxy = broadphase.getProxy(i);
+        float distance;
+        glm::vec3 normal;
+
+        if (!accepts(proxy, filter))
+        {
+            return;
+        }
+
+        // the bounds first, most candidates of a long ray's box are nowhere near the ray itself
+        if (!intersectRayBox(ray.origin, direction, proxy.collider.min, proxy.collider.max, best, distance, normal))
+        {
+            return;
+        }
+
+        if (raycastCollider(proxy.collider, ray.origin, direction, best, distance, normal))
+        {
+            best = distance;
+
+            hit.actor = proxy.actor;
+            hit.distance = distance;
+            hit.normal = normal;
+            hit.point = ray.origin + direction * distance;
+        }
+    });
+
+    return hit.actor != nullptr;
+}
+
+
+void SpatialQuery::raycastBatch(const Broadphase& broadphase, const std::vector<Ray>& rays, const QueryFilter& filter, std::vector<RaycastHit>& hits)
+{
+    hits.resize(rays.size());
+
+    for (size_t i = 0; i < rays.size(); i++)
+    {
+        raycast(broadphase, rays[i], filter, hits[i]);
+    }
+}
+
+
+bool SpatialQuery::raycastCollider(const WorldCollider& collider, const glm::vec3& origin, const glm::vec3& direction, float maxDistance,
+                                   float& distance, glm::vec3& normal)
+{
+    switch (collider.shape)
+    {
+        case CS_AABB:
+            return intersectRayBox(origin, direction, collider.min, collider.max, maxDistance, distance, normal);
+            
+        case CS_SPHERE:
+            return intersectRaySphere(origin, direction, collider.center, collider.radius, maxDistance, distance, normal);
+            
+        case CS_CAPSULE:
+            return intersectRayCapsule(origin, direction, collider.segmentStart, collider.segmentEnd, collider.radius, maxDistance, distance, normal);
+            
+        case CS_MESH:
+            return MeshCollider::raycast(collider, origin, direction, maxDistance, distance, normal);
+            
+        default:
+            break;
+    }
+
+    // an oriented box is an AABB in its own frame
+    glm::vec3 offset = origin - collider.center;
+    glm::vec3 localOrigin;
+    glm::vec3 localDirection;
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        localOrigin[axis] = glm::dot(offset, collider.axes[axis]);
+        localDirection[axis] = glm::dot(direction, collider.axes[axis]);
+    }
+
+    if (!intersectRayBox(localOrigin, localDirection, -collider.halfExtents, collider.halfExtents, maxDistance, distance, normal))
+    {
+        return false;
+    }
+
+    normal = collider.axes[0] * normal.x + collider.axes[1] * normal.y + collider.axes[2] * normal.z;
+    return true;
+}
+
+
+void SpatialQuery::overlap(const Broadphase& broadphase, const WorldCollider& shape, const QueryFilter& filter, std::vector<Actor*>& actors)
+{
+    BasicCollisionResponse contact;
+
+    broadphase.visit(shape.min, shape.max, filter.layerMask, [&](uint32_t i) {
+        const BroadphaseProxy& proxy = broadphase.getProxy(i);
+
+        if (accepts(proxy, filter) && collideColliders(shape, proxy.collider, contact))
+        {
+            actors.push_back(proxy.actor);
+        }
+    });
+}
+
+
+void SpatialQuery::overlapSphere(const Broadphase& broadphase, const glm::vec3& center, float radius, const QueryFilter& filter, std::vector<Actor*>& actors)
+{
+    WorldCollider sphere;
+    sphere.shape = CS_SPHERE;
+    sphere.center = center;
+    sphere.halfExtents = glm::vec3(radius);
+    sphere.min = center - glm::vec3(radius);
+    sphere.max = center + glm::vec3(radius);
+    sphere.segmentStart = center;
+    sphere.segmentEnd = center;
+    sphere.radius = radius;
+
+    overlap(broadphase, sphere, filter, actors);
+}
+
+
+void SpatialQuery::overlapBox(const Broadphase& broadphase, const glm::vec3& min, const glm::vec3& max, const QueryFilter& filter, std::vector<Actor*>& actors)
+{
+    WorldCollider box;
+    box.shape = CS_AABB;
+    box.center = (min + max) * 0.5f;
+    box.halfExtents = (max - min) * 0.5f;
+    box.min = min;
+    box.max = max;
+    box.segmentStart = box.center;
+    box.segmentEnd = box.center;
+
+    overlap(broadphase, box, filter, actors);
+}
+
+
+bool SpatialQuery::sweepBox(const Broadphase& broadphase, const glm::vec3& min, const glm::vec3& max, const glm::vec3& displacement,
+                            const QueryFilter& filter, SweepHit& hit)
+{
+    hit = SweepHit();
+
+    glm::vec3 sweptMin = glm::min(min, min + displacement);
+    glm::vec3 sweptMax = glm::max(max, max + displacement);
+
+    broadphase.visit(sweptMin, sweptMax, filter.layerMask, [&](uint32_t i) {
+        const BroadphaseProxy& proxy = broadphase.getProxy(i);
+        float timeOfImpact;
+        glm::vec3 normal;
+
+        if (!accepts(proxy, filter))
+        {
+            return;
+        }
+
+        bool impact = proxy.collider.shape == CS_MESH ?
+            MeshCollider::sweepBox(min, max, displacement, proxy.collider, timeOfImpact, normal) :
+            sweepBoxAgainstBox(min, max, displacement, proxy.collider.min, proxy.collider.max, timeOfImpact, normal);
+
+        if (impact && timeOfImpact < hit.timeOfImpact)
+        {
+            hit.actor = proxy.actor;
+            hit.normal = normal;
+            hit.timeOfImpact = timeOfImpact;
+        }
+    });
+
+    return hit.actor != nullptr;
+}
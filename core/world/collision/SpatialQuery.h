@@ -0,0 +1,77 @@
+#ifndef SPATIALQUERY_H
+#define SPATIALQUERY_H
+
+#include "Broadphase.h"
+
+
+#define QUERY_ALL_LAYERS UINT32_MAX
+
+
+// which proxies a query may report
+struct QueryFilter
+{
+    uint32_t layerMask = QUERY_ALL_LAYERS;
+    bool triggers = false;          // trigger layers only report when asked for
+    const Actor* ignore = nullptr;
+};
+
+
+struct Ray
+{
+    glm::vec3 origin;
+    glm::vec3 direction;            // normalized by the query
+    float maxDistance;
+};
+
+
+struct RaycastHit
+{
+    Actor* actor = nullptr;         // null when nothing was hit
+    glm::vec3 point = glm::vec3(0);
+    glm::vec3 normal = glm::vec3(0);
+    float distance = 0.f;
+};
+
+
+struct SweepHit
+{
+    Actor* actor = nullptr;
+    glm::vec3 normal = glm::vec3(0);
+    float timeOfImpact = 1.f;       // fraction of the displacement before first contact
+};
+
+
+/**
+ * @class SpatialQuery
+ * @brief Raycasts, overlaps and box sweeps over the colliders in a built broadphase.
+ *
+ * The broadphase's sorted proxies and layer bits cull the candidates, the shape tests are the
+ * narrowphase's and the mesh BVH's, so queries see exactly what collision sees as of the last
+ * build. Nothing here writes to the broadphase, any number of queries may run at once as long
+ * as no build does.
+ */
+class SpatialQuery {
+public:
+    // nearest hit along the ray
+    static bool raycast(const Broadphase& broadphase, const Ray& ray, const QueryFilter& filter, RaycastHit& hit);
+
+    // one hit per ray, in order, each ray walks the broadphase on its own
+    static void raycastBatch(const Broadphase& broadphase, const std::vector<Ray>& rays, const QueryFilter& filter, std::vector<RaycastHit>& hits);
+
+    static void overlapSphere(const Broadphase& broadphase, const glm::vec3& center, float radius, const QueryFilter& filter, std::vector<Actor*>& actors);
+    static void overlapBox(const Broadphase& broadphase, const glm::vec3& min, const glm::vec3& max, const QueryFilter& filter, std::vector<Actor*>& actors);
+
+    // first impact of a box moved by displacement, the box is not tested where it starts
+    static bool sweepBox(const Broadphase& broadphase, const glm::vec3& min, const glm::vec3& max, const glm::vec3& displacement,
+                         const QueryFilter& filter, SweepHit& hit);
+
+    // a ray against one collider, direction of unit length
+    static bool raycastCollider(const WorldCollider& collider, const glm::vec3& origin, const glm::vec3& direction, float maxDistance,
+                                float& distance, glm::vec3& normal);
+
+private:
+    static void overlap(const Broadphase& broadphase, const WorldCollider& shape, const QueryFilter& filter, std::vector<Actor*>& actors);
+    static bool accepts(const BroadphaseProxy& proxy, const QueryFilter& filter);
+};
+
+#endif
@@ -0,0 +1,137 @@
+#include "TriggerTracker.h"
+#include "Narrowphase.h"
+
+#include <algorithm>
+
+
+TriggerTracker::TriggerTracker()
+{
+}
+
+
+void TriggerTracker::update(const Broadphase& broadphase)
+{
+    current.clear();
+    
+    BasicCollisionResponse contact;
+    
+    for (const BroadphasePair& pair : broadphase.getPairs())
+    {
+        if (!pair.trigger)
+        {
+            continue;
+        }
+        
+        const BroadphaseProxy& proxyA = broadphase.getProxy(pair.a);
+        const BroadphaseProxy& proxyB = broadphase.getProxy(pair.b);
+        
+        if (collideColliders(proxyA.collider, proxyB.collider, contact))
+        {
+            current.push_back(std::minmax(proxyA.actor, proxyB.actor));
+        }
+    }
+    
+    std::sort(current.begin(), current.end());
+    
+    stats.entered = 0;
+    stats.exited = 0;
+    
+    auto queue = [this](const std::pair<Actor*, Actor*>& pair, TriggerEventType type) {
+        events.push_back({ pair.first, { pair.second, type } });
+        events.push_back({ pair.second, { pair.first, type } });
+    };
+    
+    // both lists are sorted, so one merge finds what was added and what went away
+    size_t i = 0;
+    size_t j = 0;
+    
+    while (i < overlaps.size() || j < current.size())
+    {
+        if (j == current.size() || (i < overlaps.size() && overlaps[i] < current[j]))
+        {
+            queue(overlaps[i++], TE_EXIT);
+            stats.exited++;
+        }
+        else if (i == overlaps.size() || current[j] < overlaps[i])
+        {
+            queue(current[j++], TE_ENTER);
+            stats.entered++;
+        }
+        else
+        {
+            if (reportStay)
+            {
+                queue(current[j], TE_STAY);
+            }
+            
+            i++;
+            j++;
+        }
+    }
+    
+    overlaps.swap(current);
+    stats.overlaps = overlaps.size();
+}
+
+
+void TriggerTracker::dispatch()
+{
+    if (events.empty())
+    {
+        return;
+    }
+    
+    // stable, so each actor sees its events in the order they were found
+    std::stable_sort(events.begin(), events.end(), [](const std::pair<Actor*, TriggerEvent>& a, const std::pair<Actor*, TriggerEvent>& b) {
+        return a.first < b.first;
+    });
+    
+    // a handler may destroy actors, which only queues them, so the list stays valid throughout
+    for (size_t first = 0; first < events.size();)
+    {
+        Actor* receiver = events[first].first;
+        size_t last = first;
+        
+        batch.clear();
+        
+        while (last < events.size() && events[last].first == receiver)
+        {
+            batch.push_back(events[last++].second);
+        }
+        
+        receiver->onTriggerEvents(batch);
+        first = last;
+    }
+    
+    events.clear();
+}
+
+
+void TriggerTracker::forget(const Actor* actor)
+{
+    events.erase(std::remove_if(events.begin(), events.end(), [actor](const std::pair<Actor*, TriggerEvent>& event) {
+        return event.first == actor;
+    }), events.end());
+    
+    for (std::pair<Actor*, TriggerEvent>& event : events)
+    {
+        if (event.second.other == actor)
+        {
+            event.second.otherDestroyed = true;
+        }
+    }
+    
+    for (auto it = overlaps.begin(); it != overlaps.end();)
+    {
+        if (it->first != actor && it->second != actor)
+        {
+            it++;
+            continue;
+        }
+        
+        Actor* partner = it->first == actor ? it->second : it->first;
+        
+        events.push_back({ partner, { it->first == actor ? it->first : it->second, TE_EXIT, true } });
+        it = overlaps.erase(it);
+    }
+}
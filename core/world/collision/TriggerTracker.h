@@ -0,0 +1,57 @@
+#ifndef TRIGGERTRACKER_H
+#define TRIGGERTRACKER_H
+
+#include "Broadphase.h"
+
+
+struct TriggerStats
+{
+    uint32_t overlaps = 0;      // trigger pairs overlapping after this tick
+    uint32_t entered = 0;
+    uint32_t exited = 0;
+};
+
+
+/**
+ * @class TriggerTracker
+ * @brief Enter, stay and exit events for triggers, from the difference between two ticks' overlaps.
+ *
+ * The broadphase already finds every pair involving a trigger, whether from a trigger layer or
+ * a trigger collider. Those whose shapes overlap are kept as a sorted list of actor pairs, and
+ * each tick's list is merged against the last one, so the only per-tick work past the
+ * broadphase is one walk over the overlapping pairs. Events are queued for both actors of a pair
+ * and handed to each actor in one batch. Stay events are off by default, without them the events
+ * delivered scale with what changed.
+ */
+class TriggerTracker {
+private:
+    std::vector<std::pair<Actor*, Actor*>> overlaps;    // last tick's, sorted, lower address first
+    std::vector<std::pair<Actor*, Actor*>> current;
+    
+    // receiver and event, grouped by receiver when dispatched
+    std::vector<std::pair<Actor*, TriggerEvent>> events;
+    std::vector<TriggerEvent> batch;
+    
+    bool reportStay = false;
+    
+    TriggerStats stats;
+
+public:
+    TriggerTracker();
+
+    // diffs the built broadphase's trigger pairs against the last tick's and queues the events
+    void update(const Broadphase& broadphase);
+
+    // calls onTriggerEvents once on every actor with queued events
+    void dispatch();
+
+    // ends a deleted actor's overlaps, its partners get an exit on the next dispatch
+    void forget(const Actor* actor);
+
+    void setReportStay(bool enabled) { reportStay = enabled; }
+    
+    const bool getReportStay() const { return reportStay; }
+    const TriggerStats& getStats() const { return stats; }
+};
+
+#endif
@@ -0,0 +1,252 @@
+#include "SceneGraph.h"
+
+#include <algorithm>
+
+
+SceneGraph::SceneGraph()
+{
+}
+
+
+void SceneGraph::attach(Actor* child, Actor* parent)
+{
+    for (const Actor* a = parent; a != nullptr; a = a->parent)
+    {
+        if (a == child)
+        {
+            throw std::runtime_error("failed to attach actor, it would become its own ancestor!");
+        }
+    }
+
+    // both matrices have to be current to work out where the child sits relative to the parent,
+    // actors that are not attached yet keep their own
+    if (child->parent || parent->parent)
+    {
+        update();
+    }
+
+    glm::mat4 local = glm::inverse(parent->getModelMatrix()) * child->getModelMatrix();
+
+    child->parent = parent;
+    child->worldTransform = decomposeMatrix(local);
+    child->markTransformDirty();
+
+    for (Actor* a : { parent, child })
+    {
+        if (std::find(actors.begin(), actors.end(), a) == actors.end())
+        {
+            actors.push_back(a);
+        }
+    }
+
+    orderDirty = true;
+}
+
+
+void SceneGraph::detach(Actor* child)
+{
+    if (child->parent == nullptr)
+    {
+        return;
+    }
+
+    update();
+
+    child->parent = nullptr;
+    child->worldTransform = child->attachedTransform;
+    child->markTransformDirty();
+
+    orderDirty = true;
+}
+
+
+void SceneGraph::remove(Actor* actor)
+{
+    std::vector<Actor*> children;
+
+    for (Actor* a : actors)
+    {
+        if (a->parent == actor)
+        {
+            children.push_back(a);
+        }
+    }
+
+    for (Actor* child : children)
+    {
+        detach(child);
+    }
+
+    auto it = std::find(actors.begin(), actors.end(), actor);
+
+    if (it == actors.end())
+    {
+        return;
+    }
+
+    actor->parent = nullptr;
+    actors.erase(it);
+
+    orderDirty = true;
+}
+
+
+// Sorts the nodes by depth and resolves parent pointers to indices. Roots nothing is attached to
+// any more are dropped, and every node is recomputed by the next update.
+void SceneGraph::rebuildOrder()
+{
+    std::unordered_map<const Actor*, uint32_t> childCounts;
+
+    for (const Actor* a : actors)
+    {
+        if (a->parent)
+        {
+            childCounts[a->parent]++;
+        }
+    }
+
+    std::vector<std::pair<uint32_t, Actor*>> order;
+    order.reserve(actors.size());
+
+    stats.depth = 0;
+
+    for (Actor* a : actors)
+    {
+        if (a->parent == nullptr && childCounts.find(a) == childCounts.end())
+        {
+            continue;
+        }
+
+        uint32_t depth = 0;
+
+        for (const Actor* p = a->parent; p != nullptr; p = p->parent)
+        {
+            depth++;
+        }
+
+        stats.depth = std::max(stats.depth, depth);
+        order.push_back({ depth, a });
+    }
+
+    std::stable_sort(order.begin(), order.end(), [](const std::pair<uint32_t, Actor*>& a, const std::pair<uint32_t, Actor*>& b) {
+        return a.first < b.first;
+    });
+
+    size_t count = order.size();
+
+    actors.resize(count);
+    parents.resize(count);
+    worldMatrices.resize(count);
+    versions.resize(count);
+    changed.resize(count);
+
+    nodeIndex.clear();
+
+    for (size_t i = 0; i < count; i++)
+    {
+        actors[i] = order[i].second;
+        nodeIndex[actors[i]] = i;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        Actor* a = actors[i];
+
+        parents[i] = a->parent ? nodeIndex[a->parent] : -1;
+        versions[i] = a->transformVersion - 1;
+        changed[i] = false;
+    }
+
+    stats.nodes = count;
+    orderDirty = false;
+}
+
+
+void SceneGraph::update()
+{
+    if (orderDirty)
+    {
+        rebuildOrder();
+    }
+
+    stats.updated = 0;
+
+    for (size_t i = 0; i < actors.size(); i++)
+    {
+        Actor* a = actors[i];
+        int32_t p = parents[i];
+
+        bool moved = a->transformVersion != versions[i] || (p >= 0 && changed[p]);
+        changed[i] = moved;
+
+        if (!moved)
+        {
+            continue;
+        }
+
+        versions[i] = a->transformVersion;
+        stats.updated++;
+
+        if (p < 0)
+        {
+            worldMatrices[i] = a->getModelMatrix();
+            continue;
+        }
+
+        worldMatrices[i] = worldMatrices[p] * a->getLocalMatrix();
+        a->setAttachedMatrix(worldMatrices[i], decomposeMatrix(worldMatrices[i]));
+    }
+}
+
+
+std::vector<Actor*> SceneGraph::getDescendants(const Actor* actor)
+{
+    if (orderDirty)
+    {
+        rebuildOrder();
+    }
+
+    std::vector<Actor*> descendants;
+    auto it = nodeIndex.find(actor);
+
+    if (it == nodeIndex.end())
+    {
+        return descendants;
+    }
+
+    // children always sit after their parent, so one sweep from the node finds the whole subtree
+    std::vector<uint8_t> inSubtree(actors.size(), false);
+    inSubtree[it->second] = true;
+
+    for (size_t i = it->second + 1; i < actors.size(); i++)
+    {
+        if (parents[i] >= 0 && inSubtree[parents[i]])
+        {
+            inSubtree[i] = true;
+            descendants.push_back(actors[i]);
+        }
+    }
+
+    return descendants;
+}
+
+
+// Splits a matrix built as translate * rotate(z, y, x) * scale back into a transform. Shear from
+// non-uniform scale under a rotated parent cannot be represented and is dropped.
+Transform SceneGraph::decomposeMatrix(const glm::mat4& matrix)
+{
+    Transform t;
+
+    t.worldLocation = glm::vec3(matrix[3]);
+    t.worldScale = glm::vec3(glm::length(glm::vec3(matrix[0])), glm::length(glm::vec3(matrix[1])), glm::length(glm::vec3(matrix[2])));
+
+    glm::vec3 x = glm::vec3(matrix[0]) / t.worldScale.x;
+    glm::vec3 y = glm::vec3(matrix[1]) / t.worldScale.y;
+    glm::vec3 z = glm::vec3(matrix[2]) / t.worldScale.z;
+
+    t.worldRotation.x = glm::degrees(std::atan2(y.z, z.z));
+    t.worldRotation.y = glm::degrees(std::asin(glm::clamp(-x.z, -1.f, 1.f)));
+    t.worldRotation.z = glm::degrees(std::atan2(x.y, x.x));
+
+    return t;
+}
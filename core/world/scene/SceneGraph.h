@@ -0,0 +1,64 @@
+#ifndef SCENEGRAPH_H
+#define SCENEGRAPH_H
+
+#include "Actor.h"
+
+#include <unordered_map>
+
+
+struct SceneGraphStats
+{
+    uint32_t nodes = 0;
+    uint32_t depth = 0;         // levels below the roots
+    uint32_t updated = 0;       // nodes recomputed by the last update
+};
+
+
+/**
+ * @class SceneGraph
+ * @brief Parent/child attachments between actors, propagated in one linear pass.
+ *
+ * Only actors that take part in an attachment are nodes. They are kept in arrays sorted by depth,
+ * so every parent comes before its children and an update is a single forward sweep. A node is
+ * recomputed only when its own transform version moved or its parent was recomputed earlier in
+ * the same sweep, untouched subtrees cost one flag test per node. Roots keep their usual lazy
+ * matrix, attached actors are handed their world matrix, which marks their bounds dirty.
+ */
+class SceneGraph {
+private:
+    // structure of arrays, index order is depth order
+    std::vector<Actor*> actors;
+    std::vector<int32_t> parents;
+    std::vector<glm::mat4> worldMatrices;
+    std::vector<uint32_t> versions;         // transform version each node was last computed at
+    std::vector<uint8_t> changed;
+
+    std::unordered_map<const Actor*, uint32_t> nodeIndex;
+
+    bool orderDirty = false;
+    SceneGraphStats stats;
+
+public:
+    SceneGraph();
+
+    // The child keeps its world placement, its transform becomes relative to the parent.
+    void attach(Actor* child, Actor* parent);
+    void detach(Actor* child);
+
+    // drops an actor that is about to be deleted, its children must already be gone or detached
+    void remove(Actor* actor);
+
+    void update();
+
+    // every actor attached below this one, parents before their children
+    std::vector<Actor*> getDescendants(const Actor* actor);
+
+    const SceneGraphStats& getStats() const { return stats; }
+
+private:
+    void rebuildOrder();
+
+    static Transform decomposeMatrix(const glm::mat4& matrix);
+};
+
+#endif
@@ -0,0 +1,107 @@
+#include "SimulationLod.h"
+
+#include <stdexcept>
+
+
+SimulationLod::SimulationLod()
+{
+}
+
+
+void SimulationLod::setDistances(float full, float reduced)
+{
+    if (full < 0.f || reduced < full)
+    {
+        throw std::runtime_error("failed to set simulation distances, the reduced tier must start past the full one!");
+    }
+    
+    fullDistance = full;
+    reducedDistance = reduced;
+}
+
+
+void SimulationLod::setReducedInterval(uint32_t ticks)
+{
+    // the phase and tick count are kept in a byte on the actor
+    if (ticks == 0 || ticks > UINT8_MAX)
+    {
+        throw std::runtime_error("failed to set reduced simulation interval, it must be from 1 to 255 ticks!");
+    }
+    
+    reducedInterval = ticks;
+}
+
+
+void SimulationLod::assign(const std::vector<Actor*>& actors, const glm::vec3& playerLocation)
+{
+    stats = {};
+    tick++;
+    
+    // squared once, an actor is in a tier inside its entry distance and stays until past its exit
+    float fullEnter = fullDistance * fullDistance;
+    float fullExit = (fullDistance + SIM_TIER_HYSTERESIS) * (fullDistance + SIM_TIER_HYSTERESIS);
+    float reducedEnter = reducedDistance * reducedDistance;
+    float reducedExit = (reducedDistance + SIM_TIER_HYSTERESIS) * (reducedDistance + SIM_TIER_HYSTERESIS);
+    
+    for (Actor* a : actors)
+    {
+        glm::vec3 offset = a->getWorldLocation() - playerLocation;
+        float distanceSquared = glm::dot(offset, offset);
+        
+        SimulationTier tier = ST_FROZEN;
+        
+        if (!enabled || distanceSquared < fullEnter || (a->simulationTier == ST_FULL && distanceSquared < fullExit))
+        {
+            tier = ST_FULL;
+        }
+        else if (distanceSquared < reducedEnter || (a->simulationTier != ST_FROZEN && distanceSquared < reducedExit))
+        {
+            tier = ST_REDUCED;
+        }
+        
+        // the count restarts on entering, from full that is the tick after the last step, from frozen the time frozen is dropped
+        if (tier == ST_REDUCED && a->simulationTier != ST_REDUCED)
+        {
+            a->simulationPhase = nextPhase++ % reducedInterval;
+            a->ticksSinceStep = 0;
+        }
+        
+        a->simulationTier = tier;
+        
+        switch (tier)
+        {
+            case ST_FULL:
+                a->simulationScale = 1.f;
+                a->ticksSinceStep = 0;
+                stats.full++;
+                break;
+                
+            case ST_REDUCED:
+                a->ticksSinceStep++;
+                
+                if (tick % reducedInterval == a->simulationPhase % reducedInterval)
+                {
+                    a->simulationScale = a->ticksSinceStep;
+                    a->ticksSinceStep = 0;
+                }
+                else
+                {
+                    a->simulationScale = 0.f;
+                }
+                
+                stats.reduced++;
+                break;
+                
+            case ST_FROZEN:
+                a->simulationScale = 0.f;
+                a->ticksSinceStep = 0;
+                stats.frozen++;
+                break;
+        }
+        
+        if (a->simulationScale > 0.f)
+        {
+            stats.stepped++;
+        }
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef SIMULATIONLOD_H
+#define SIMULATIONLOD_H
+
+#include "Actor.h"
+
+
+struct SimulationLodStats
+{
+    uint32_t full = 0;
+    uint32_t reduced = 0;
+    uint32_t frozen = 0;
+    uint32_t stepped = 0;       // actors simulated this tick, whatever their tier
+};
+
+
+/**
+ * @class SimulationLod
+ * @brief Picks each actor's simulation tier and this tick's step in one pass over the actors.
+ *
+ * Tiers go by distance from the player, with a hysteresis band so an actor on a boundary does
+ * not flicker between two. Reduced actors are spread evenly over the ticks of their interval by
+ * the phase they get on entering the tier, and step by however many ticks have passed since
+ * they last did, so no simulated time is lost or doubled on a tier change. Time spent frozen is
+ * dropped. An actor that is not stepped this tick is static to the broadphase and the solver.
+ */
+class SimulationLod {
+private:
+    float fullDistance = SIM_FULL_DISTANCE;
+    float reducedDistance = SIM_REDUCED_DISTANCE;
+    uint32_t reducedInterval = SIM_REDUCED_INTERVAL;
+    
+    uint32_t tick = 0;
+    uint32_t nextPhase = 0;
+    bool enabled = true;
+    
+    SimulationLodStats stats;
+
+public:
+    SimulationLod();
+
+    void assign(const std::vector<Actor*>& actors, const glm::vec3& playerLocation);
+
+    void setDistances(float full, float reduced);
+    void setReducedInterval(uint32_t ticks);
+
+    // disabled, every actor is stepped every tick as before tiers existed
+    void setEnabled(bool e) { enabled = e; }
+    
+    const bool getEnabled() const { return enabled; }
+    const SimulationLodStats& getStats() const { return stats; }
+};
+
+#endif
@@ -1,6 +1,32 @@
 #include "Game.h"
 #include "AudioManager.h"
 
+// build with -DCOOK_MESHES for the cook step, which writes the cooked mesh of every model named
+// on the command line next to it and exits instead of running the game
+#ifdef COOK_MESHES
+#include "MeshCooker.h"
+
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            MeshCooker::cookFile(argv[i]);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    
+    return EXIT_SUCCESS;
+}
+
+#else
+
 
 int main()
 {
@@ -18,3 +44,5 @@ int main()
 
     return EXIT_SUCCESS;
 }
+
+#endif
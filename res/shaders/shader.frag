@@ -1,9 +1,11 @@
 #version 450
 
-#define MAX_TEXTURES 4
-#define DITHER_STEPS 6
-
-#define GRAIN true
+// Specialization constants, MaterialCache fills them per shader variant. Branches on them
+// are removed once the pipeline is built, so disabled features cost nothing.
+layout(constant_id = 0) const int MAX_TEXTURES = 4;
+layout(constant_id = 1) const int DITHER_STEPS = 6;     // 0 disables dithering
+layout(constant_id = 2) const bool GRAIN = true;
+layout(constant_id = 3) const float TIME_OF_DAY = 2.5f; // negative follows the clock
 
 
 const float threshold4x4[16] = float[16](
@@ -40,7 +42,8 @@ const vec3 dayColor = vec3(1.f, 1.f, 1.f);
 const vec3 nightColor = normalize(vec3(1, 1, 1));
 
 void main() {
-    float timeOfDay = /*mod((time / 120.f), 1.f)*/ 2.5f;
+    // with a fixed time of day the sun math folds to constants when the variant is built
+    float timeOfDay = TIME_OF_DAY < 0.0 ? mod((time / 120.f), 1.f) : TIME_OF_DAY;
     float sunAngle = timeOfDay * 2;
     
     vec3 lightDir = normalize(vec3(sin(sunAngle), cos(sunAngle), cos(sunAngle)));
@@ -54,7 +57,12 @@ void main() {
     float distanceFactor = clamp(distance(fragPos.xz, cameraPos.xz) * 0.16f, 0.0, 1.0);
     diffuse *= 1.f - distanceFactor;
     
-    vec3 finalColor = bayerDither4x4(diffuse * 2, gl_FragCoord.xy);
+    vec3 finalColor = diffuse * 2;
+    
+    if (DITHER_STEPS > 0)
+    {
+        finalColor = bayerDither4x4(finalColor, gl_FragCoord.xy);
+    }
     
     float grain = 0.01f;
     
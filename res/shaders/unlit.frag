@@ -0,0 +1,23 @@
+#version 450
+
+// specialization constant, MaterialCache sizes it to the loaded textures
+layout(constant_id = 0) const int MAX_TEXTURES = 4;
+
+
+layout(set = 0, binding = 1) uniform sampler texSampler;
+layout(set = 0, binding = 2) uniform texture2D textures[MAX_TEXTURES];
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec3 fragPos;
+layout(location = 2) in vec3 cameraPos;
+layout(location = 3) flat in uint texIndex;
+layout(location = 4) in vec2 fragTexCoord;
+layout(location = 5) in float time;
+
+layout(location = 0) out vec4 outColor;
+
+
+// HUD elements, no lighting or distance fade, blended over the scene
+void main() {
+    outColor = texture(sampler2D(textures[texIndex], texSampler), fragTexCoord);
+}